@@ -0,0 +1,431 @@
+#pragma once
+#include "uTypedef.h"
+#include <fcntl.h>
+#include <unistd.h>
+#include <dirent.h>
+#include <sys/stat.h>
+
+// CRC-32 (IEEE 802.3, nibble table) =======
+
+inline dtypes::uint32 crc32(const void *_data, size_t _n)
+{
+    static const dtypes::uint32 table[16] = {
+        0x00000000, 0x1DB71064, 0x3B6E20C8, 0x26D930AC, 0x76DC4190, 0x6B6B51F4, 0x4DB26158, 0x5005713C,
+        0xEDB88320, 0xF00F9344, 0xD6D6A3E8, 0xCB61B38C, 0x9B64C2B0, 0x86D3D2D4, 0xA00AE278, 0xBDBDF21C};
+    const uint8_t *bytes = static_cast<const uint8_t *>(_data);
+    dtypes::uint32 crc = 0xFFFFFFFF;
+    for (size_t i = 0; i < _n; i++)
+    {
+        crc = table[(crc ^ bytes[i]) & 0x0f] ^ (crc >> 4);
+        crc = table[(crc ^ (bytes[i] >> 4)) & 0x0f] ^ (crc >> 4);
+    }
+    return ~crc;
+}
+
+// flash log records =======
+
+/**
+ * @brief one reading in 32 bytes, sealed with a CRC (a torn write at power loss fails the check)
+ */
+struct TflashRecord
+{
+    static constexpr dtypes::uint8 OFFLINE = 1 << 0; // logged while the cloud was not connected
+    static constexpr dtypes::uint8 UPTIME = 1 << 1;  // time is seconds since boot (the clock was not set yet)
+
+    dtypes::uint32 seq;  // record number (continues across segments and restarts)
+    dtypes::uint32 time; // unix time (or uptime, see UPTIME)
+    dtypes::uint16 boot; // boot counter (which restart the uptime belongs to)
+    dtypes::uint16 speed_rpm;
+    dtypes::float32 od;
+    dtypes::float32 odSd;
+    dtypes::float32 temperature_C;
+    dtypes::uint16 power_cV; // supply voltage in 1/100 V
+    dtypes::uint8 flags;
+    dtypes::uint8 reserved;
+    dtypes::uint32 crc;
+
+    void seal()
+    {
+        crc = crc32(this, offsetof(TflashRecord, crc));
+    }
+
+    bool valid() const
+    {
+        return crc == crc32(this, offsetof(TflashRecord, crc));
+    }
+};
+static_assert(sizeof(TflashRecord) == 32, "flash log records are 32 bytes");
+
+// flash log =======
+
+/**
+ * @brief append-only log of records in fixed-size segment files on the flash file system (LittleFS)
+ * - records are only ever appended (and synced), full segments are never written again
+ * - the oldest segment is deleted once maxSegments are in use, so flash use (and wear) is bounded
+ * - the segment table (first record number and time of each segment) is the index: a record is found
+ *   by number with one seek and by time with a binary search in one segment
+ * - on mount, a torn or corrupt tail of the newest segment (power cut mid-write) is cut off
+ */
+class TflashLog
+{
+
+public:
+    static constexpr dtypes::uint16 recordsPerSegment = 512; // 16 kB segments
+    static constexpr dtypes::uint8 maxSegments = 32;         // 512 kB of flash at most
+
+    struct Tsegment
+    {
+        dtypes::uint32 id;
+        dtypes::uint32 firstSeq;
+        dtypes::uint32 firstTime; // first unix time in the segment (0 = none yet)
+        dtypes::uint16 count;
+    };
+
+    // segment file name
+    static constexpr dtypes::uint8 pathSize = 24;
+    static void segmentPath(char (&_path)[pathSize], dtypes::uint32 _id)
+    {
+        snprintf(_path, sizeof(_path), "%s/s%08x", Fdir, static_cast<unsigned int>(_id));
+    }
+
+private:
+    static constexpr const char *Fdir = "/log";
+    static constexpr const char *FbootFile = "/log/boot";
+    static constexpr const char *FseqFile = "/log/next"; // next record number when the segments don't tell (e.g. after erase)
+
+    Tsegment Fsegments[maxSegments]; // oldest first
+    dtypes::uint8 FsegmentsN = 0;
+    dtypes::uint32 FnextSeq = 0;
+    dtypes::uint16 Fboot = 0;
+    bool Fmounted = false;
+
+    // read records from a segment (returns the number read)
+    dtypes::uint16 readSegment(const Tsegment &_segment, dtypes::uint16 _index, TflashRecord *_records, dtypes::uint16 _n) const
+    {
+        char path[pathSize];
+        segmentPath(path, _segment.id);
+        int fd = open(path, O_RDONLY);
+        if (fd < 0)
+            return 0;
+        ssize_t bytes = -1;
+        if (lseek(fd, _index * sizeof(TflashRecord), SEEK_SET) >= 0)
+            bytes = ::read(fd, _records, _n * sizeof(TflashRecord));
+        close(fd);
+        return (bytes > 0) ? bytes / sizeof(TflashRecord) : 0;
+    }
+
+    // first valid record of a segment (returns its index, count if there is none)
+    dtypes::uint16 firstValid(const Tsegment &_segment, TflashRecord &_record) const
+    {
+        for (dtypes::uint16 i = 0; i < _segment.count; i++)
+        {
+            if (readSegment(_segment, i, &_record, 1) == 1 && _record.valid())
+                return i;
+        }
+        return _segment.count;
+    }
+
+    // segment that holds a record number
+    const Tsegment *segmentOf(dtypes::uint32 _seq) const
+    {
+        dtypes::int16 lo = 0, hi = FsegmentsN - 1;
+        while (lo <= hi)
+        {
+            dtypes::int16 mid = (lo + hi) / 2;
+            const Tsegment &s = Fsegments[mid];
+            if (_seq < s.firstSeq)
+                hi = mid - 1;
+            else if (_seq >= s.firstSeq + s.count)
+                lo = mid + 1;
+            else
+                return &s;
+        }
+        return nullptr;
+    }
+
+    // start a new segment (deleting the oldest if all are in use)
+    bool rotate()
+    {
+        if (FsegmentsN == maxSegments)
+        {
+            char path[pathSize];
+            segmentPath(path, Fsegments[0].id);
+            unlink(path);
+            memmove(Fsegments, Fsegments + 1, (FsegmentsN - 1) * sizeof(Tsegment));
+            FsegmentsN--;
+        }
+        dtypes::uint32 id = (FsegmentsN > 0) ? Fsegments[FsegmentsN - 1].id + 1 : 1;
+        Fsegments[FsegmentsN++] = {id, FnextSeq, 0, 0};
+        writeValue(FseqFile, FnextSeq);
+        return true;
+    }
+
+    // cut a torn or corrupt tail off the newest segment, returns the records (or partial record) dropped
+    dtypes::uint16 repairTail()
+    {
+        if (FsegmentsN == 0)
+            return 0;
+        Tsegment &last = Fsegments[FsegmentsN - 1];
+        char path[pathSize];
+        segmentPath(path, last.id);
+        struct stat info;
+        if (stat(path, &info) != 0)
+            return 0;
+        dtypes::uint16 dropped = (info.st_size % sizeof(TflashRecord)) ? 1 : 0;
+        TflashRecord record;
+        while (last.count > 0 && !(readSegment(last, last.count - 1, &record, 1) == 1 && record.valid() && record.seq == last.firstSeq + last.count - 1))
+        {
+            last.count--;
+            dropped++;
+        }
+        if (dropped > 0)
+            truncate(path, last.count * sizeof(TflashRecord));
+        return dropped;
+    }
+
+public:
+    /**
+     * @brief build the segment table from the files and repair the newest segment
+     * @return false if the file system is not available
+     */
+    bool mount(dtypes::uint16 &_repaired)
+    {
+        _repaired = 0;
+        mkdir(Fdir, 0777); // fails if it exists
+
+        // boot counter
+        dtypes::uint32 boot = 0;
+        readValue(FbootFile, boot);
+        Fboot = boot + 1;
+        writeValue(FbootFile, Fboot);
+
+        // segment files (ids in ascending order)
+        DIR *dir = opendir(Fdir);
+        if (dir == nullptr)
+            return false;
+        FsegmentsN = 0;
+        while (struct dirent *entry = readdir(dir))
+        {
+            if (entry->d_name[0] != 's')
+                continue;
+            dtypes::uint32 id = strtoul(entry->d_name + 1, nullptr, 16);
+            if (FsegmentsN == maxSegments)
+            {
+                // more than we keep (e.g. maxSegments got smaller), let go of the oldest
+                char path[pathSize];
+                segmentPath(path, (id < Fsegments[0].id) ? id : Fsegments[0].id);
+                unlink(path);
+                if (id < Fsegments[0].id)
+                    continue;
+                memmove(Fsegments, Fsegments + 1, (FsegmentsN - 1) * sizeof(Tsegment));
+                FsegmentsN--;
+            }
+            dtypes::uint8 i = FsegmentsN++;
+            while (i > 0 && Fsegments[i - 1].id > id)
+            {
+                Fsegments[i] = Fsegments[i - 1];
+                i--;
+            }
+            Fsegments[i] = {id, 0, 0, 0};
+        }
+        closedir(dir);
+
+        // index: first record of each segment (numbered from the first readable one), the number of records from the file size
+        for (dtypes::uint8 i = 0; i < FsegmentsN;)
+        {
+            Tsegment &s = Fsegments[i];
+            char path[pathSize];
+            segmentPath(path, s.id);
+            struct stat info;
+            s.count = (stat(path, &info) == 0) ? info.st_size / sizeof(TflashRecord) : 0;
+            TflashRecord first;
+            dtypes::uint16 index = firstValid(s, first);
+            if (index < s.count)
+            {
+                s.firstSeq = first.seq - index;
+                s.firstTime = (first.flags & TflashRecord::UPTIME) ? 0 : first.time;
+            }
+            else if (i > 0)
+                s.firstSeq = Fsegments[i - 1].firstSeq + Fsegments[i - 1].count;
+            else
+            {
+                // nothing readable in the oldest segment and nothing before it to number it from, let it go
+                unlink(path);
+                _repaired += s.count;
+                memmove(Fsegments, Fsegments + 1, (FsegmentsN - 1) * sizeof(Tsegment));
+                FsegmentsN--;
+                continue;
+            }
+            i++;
+        }
+        _repaired += repairTail();
+        FnextSeq = (FsegmentsN > 0) ? Fsegments[FsegmentsN - 1].firstSeq + Fsegments[FsegmentsN - 1].count : 0;
+
+        // record numbers never go back (a cursor kept from before the log was emptied stays valid)
+        dtypes::uint32 seq = 0;
+        if (readValue(FseqFile, seq) && seq > FnextSeq)
+            FnextSeq = seq;
+        Fmounted = true;
+        return true;
+    }
+
+    /**
+     * @brief append a record (numbered, sealed and synced to flash)
+     * @return bytes written (0 if it failed)
+     */
+    dtypes::uint16 append(TflashRecord &_record)
+    {
+        if (!Fmounted)
+            return 0;
+        if (FsegmentsN == 0 || Fsegments[FsegmentsN - 1].count >= recordsPerSegment)
+            rotate();
+        Tsegment &last = Fsegments[FsegmentsN - 1];
+        _record.seq = FnextSeq;
+        _record.boot = Fboot;
+        _record.reserved = 0;
+        _record.seal();
+
+        char path[pathSize];
+        segmentPath(path, last.id);
+        int fd = open(path, O_WRONLY | O_CREAT | O_APPEND, 0666);
+        if (fd < 0)
+            return 0;
+        bool ok = (::write(fd, &_record, sizeof(_record)) == sizeof(_record)) && fsync(fd) == 0;
+        close(fd);
+        if (!ok)
+        {
+            // don't leave a partial record behind
+            repairTail();
+            return 0;
+        }
+        if (last.firstTime == 0 && !(_record.flags & TflashRecord::UPTIME))
+            last.firstTime = _record.time;
+        last.count++;
+        FnextSeq++;
+        return sizeof(_record);
+    }
+
+    /**
+     * @brief read consecutive records starting at a record number (stops at the end of its segment)
+     * @return records read (only valid records are returned)
+     */
+    dtypes::uint16 read(dtypes::uint32 _seq, TflashRecord *_records, dtypes::uint16 _n) const
+    {
+        const Tsegment *s = segmentOf(_seq);
+        if (s == nullptr)
+            return 0;
+        dtypes::uint16 index = _seq - s->firstSeq;
+        if (_n > s->count - index)
+            _n = s->count - index;
+        dtypes::uint16 n = readSegment(*s, index, _records, _n);
+        for (dtypes::uint16 i = 0; i < n; i++)
+            if (!_records[i].valid() || _records[i].seq != _seq + i)
+                return i;
+        return n;
+    }
+
+    /**
+     * @brief first record logged at or after a unix time (nextSeq() if there is none)
+     * (records logged before the clock was set are treated as earlier)
+     */
+    dtypes::uint32 find(dtypes::uint32 _time) const
+    {
+        // index: last segment starting at or before _time
+        dtypes::int16 i = -1;
+        for (dtypes::uint8 j = 0; j < FsegmentsN; j++)
+        {
+            if (Fsegments[j].firstTime != 0 && Fsegments[j].firstTime > _time)
+                break;
+            if (Fsegments[j].firstTime != 0)
+                i = j;
+        }
+        if (i < 0)
+            return oldestSeq();
+
+        // binary search in the segment (it can only be the next segment's first record otherwise)
+        const Tsegment &s = Fsegments[i];
+        dtypes::uint16 lo = 0, hi = s.count;
+        TflashRecord record;
+        while (lo < hi)
+        {
+            dtypes::uint16 mid = (lo + hi) / 2;
+            if (readSegment(s, mid, &record, 1) == 1 && record.valid() && !(record.flags & TflashRecord::UPTIME) && record.time >= _time)
+                hi = mid;
+            else
+                lo = mid + 1;
+        }
+        return s.firstSeq + lo;
+    }
+
+    // drop all records (numbering continues where it was)
+    void erase()
+    {
+        for (dtypes::uint8 i = 0; i < FsegmentsN; i++)
+        {
+            char path[pathSize];
+            segmentPath(path, Fsegments[i].id);
+            unlink(path);
+        }
+        FsegmentsN = 0;
+        writeValue(FseqFile, FnextSeq);
+    }
+
+    bool mounted() const
+    {
+        return Fmounted;
+    }
+
+    dtypes::uint32 oldestSeq() const
+    {
+        return (FsegmentsN > 0) ? Fsegments[0].firstSeq : FnextSeq;
+    }
+
+    dtypes::uint32 nextSeq() const
+    {
+        return FnextSeq;
+    }
+
+    dtypes::uint8 segments() const
+    {
+        return FsegmentsN;
+    }
+
+    // i-th segment (0 = oldest)
+    const Tsegment &segment(dtypes::uint8 _i) const
+    {
+        return Fsegments[_i];
+    }
+
+    dtypes::uint16 boot() const
+    {
+        return Fboot;
+    }
+
+    // small values (e.g. a cursor) in their own file, written to a temporary file first and renamed
+    // so a power cut leaves either the old or the new value
+    static bool readValue(const char *_path, dtypes::uint32 &_value)
+    {
+        dtypes::uint32 data[2];
+        int fd = open(_path, O_RDONLY);
+        if (fd < 0)
+            return false;
+        bool ok = ::read(fd, data, sizeof(data)) == sizeof(data) && data[1] == crc32(data, sizeof(data[0]));
+        close(fd);
+        if (ok)
+            _value = data[0];
+        return ok;
+    }
+
+    static bool writeValue(const char *_path, dtypes::uint32 _value)
+    {
+        char tmp[pathSize + 4];
+        snprintf(tmp, sizeof(tmp), "%s.tmp", _path);
+        dtypes::uint32 data[2] = {_value, crc32(&_value, sizeof(_value))};
+        int fd = open(tmp, O_WRONLY | O_CREAT | O_TRUNC, 0666);
+        if (fd < 0)
+            return false;
+        bool ok = ::write(fd, data, sizeof(data)) == sizeof(data) && fsync(fd) == 0;
+        close(fd);
+        return ok && rename(tmp, _path) == 0;
+    }
+};
@@ -0,0 +1,151 @@
+#pragma once
+#include "uTypedef.h"
+
+// history records =======
+
+/**
+ * @brief one reading in 8 bytes (fixed-point, NaN is kept as a reserved code)
+ */
+struct ThistoryRecord
+{
+    static constexpr dtypes::int16 NO_OD = INT16_MIN;
+    static constexpr dtypes::uint8 NO_DATA = 0xff;
+    static constexpr dtypes::float32 NaN = std::numeric_limits<dtypes::float32>::quiet_NaN();
+
+    dtypes::uint16 dt_sec;      // seconds since the previous record (saturates at 65535)
+    dtypes::int16 od;           // OD x 10000 (-3.2767 to 3.2767)
+    dtypes::uint8 odSd;         // OD sd / 0.0002 (0 to 0.0508, saturates)
+    dtypes::uint8 temperature;  // (temperature - 10 C) x 5 (10 to 60.8 C, saturates)
+    dtypes::uint16 speed_rpm;
+
+    // encode
+    void set(dtypes::float32 _od, dtypes::float32 _odSd, dtypes::float32 _temperature_C, dtypes::uint16 _speed_rpm)
+    {
+        od = std::isnan(_od) ? NO_OD : static_cast<dtypes::int16>(clamp(_od * 10000.0f, -32767, 32767));
+        odSd = std::isnan(_odSd) ? NO_DATA : static_cast<dtypes::uint8>(clamp(_odSd / 0.0002f, 0, 254));
+        temperature = std::isnan(_temperature_C) ? NO_DATA : static_cast<dtypes::uint8>(clamp((_temperature_C - 10.0f) * 5.0f, 0, 254));
+        speed_rpm = _speed_rpm;
+    }
+
+    // decode
+    dtypes::float32 OD() const
+    {
+        return (od == NO_OD) ? NaN : od / 10000.0f;
+    }
+
+    dtypes::float32 ODSd() const
+    {
+        return (odSd == NO_DATA) ? NaN : odSd * 0.0002f;
+    }
+
+    dtypes::float32 temperature_C() const
+    {
+        return (temperature == NO_DATA) ? NaN : 10.0f + temperature / 5.0f;
+    }
+
+private:
+    static dtypes::float32 clamp(dtypes::float32 _v, dtypes::float32 _min, dtypes::float32 _max)
+    {
+        _v = roundf(_v);
+        return (_v < _min) ? _min : (_v > _max) ? _max : _v;
+    }
+};
+static_assert(sizeof(ThistoryRecord) == 8, "history records are 8 bytes");
+
+// history ring buffer =======
+
+/**
+ * @brief the most recent N records, the oldest is overwritten when full
+ * (timestamps are deltas to the previous record, ages are counted back from the newest)
+ */
+template <dtypes::uint16 N>
+class Thistory
+{
+
+private:
+    ThistoryRecord Frecords[N];
+    dtypes::uint16 Fhead = 0;  // where the next record goes
+    dtypes::uint16 Fcount = 0; // records stored
+    dtypes::uint32 Ftotal = 0; // records ever added
+    dtypes::uint32 Fspan = 0;  // seconds from the oldest to the newest record
+    dtypes::TtickCount FlastAdd = 0;
+
+public:
+    // add a reading (now)
+    void add(dtypes::float32 _od, dtypes::float32 _odSd, dtypes::float32 _temperature_C, dtypes::uint16 _speed_rpm)
+    {
+        dtypes::TtickCount now = millis();
+        dtypes::uint32 dt = (Fcount > 0) ? (now - FlastAdd + 500) / 1000 : 0;
+        if (dt > UINT16_MAX)
+            dt = UINT16_MAX;
+        if (Fcount == N)
+            Fspan -= Frecords[(Fhead + 1) % N].dt_sec; // the next oldest becomes the oldest
+        Fspan += dt;
+        ThistoryRecord &record = Frecords[Fhead];
+        record.dt_sec = dt;
+        record.set(_od, _odSd, _temperature_C, _speed_rpm);
+        FlastAdd = now;
+        Fhead = (Fhead + 1) % N;
+        if (Fcount < N)
+            Fcount++;
+        Ftotal++;
+    }
+
+    void clear()
+    {
+        Fhead = 0;
+        Fcount = 0;
+        Ftotal = 0;
+        Fspan = 0;
+    }
+
+    dtypes::uint16 size() const
+    {
+        return Fcount;
+    }
+
+    static constexpr dtypes::uint16 capacity()
+    {
+        return N;
+    }
+
+    dtypes::uint32 total() const
+    {
+        return Ftotal;
+    }
+
+    // i-th newest record (0 = newest)
+    const ThistoryRecord &at(dtypes::uint16 _i) const
+    {
+        return Frecords[(Fhead + N - 1 - _i) % N];
+    }
+
+    // seconds since the newest record
+    dtypes::uint32 age_sec() const
+    {
+        return (Fcount > 0) ? (millis() - FlastAdd) / 1000 : 0;
+    }
+
+    // seconds from the oldest record until now
+    dtypes::uint32 span_sec() const
+    {
+        return Fspan + age_sec();
+    }
+
+    /**
+     * @brief walk the records from newest to oldest
+     * @param _f called with (record, age in seconds), return false to stop
+     */
+    template <class F>
+    void walk(F _f) const
+    {
+        dtypes::uint32 age = age_sec();
+        for (dtypes::uint16 i = 0; i < Fcount; i++)
+        {
+            const ThistoryRecord &record = at(i);
+            if (!_f(record, age))
+                return;
+            age += record.dt_sec;
+        }
+    }
+};
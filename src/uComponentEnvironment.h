@@ -22,7 +22,7 @@ private:
 
 public:
     // sdds vars
-    sdds_var(Tuint32, readInterval_ms, sdds::opt::saveval, 1000); // how often to read the temperature
+    sdds_var(Tuint32, readInterval_ms, sdds::opt::saveval, 1000); // how often to read the temperature at most (the sensor's conversion cycle sets the actual rate)
     sdds_var(Tfloat32, temperature_C, sdds::opt::readonly);
     sdds_var(Tfloat32, power_V, sdds::opt::readonly);
     sdds_var(Tfloat32, powerReq_V, sdds::opt::saveval, 20.0); // what is the minimum power requirement?
@@ -56,11 +56,22 @@ public:
         // update temperature read timer
         on(FreadTimer)
         {
-            hardware().temperature.action = Thardware::Ti2cAction::read;
-            FreadTimer.start(readInterval_ms);
+            hardware().temperature.queue(Thardware::Ti2cAction::read);
+            FreadTimer.start(pollInterval_ms());
         };
     }
 
+    /**
+     * @brief when to read the temperature next
+     * the sensor converts continuously (averaging on-chip) so the read is timed to the end of its next conversion
+     * (the driver keeps the conversion schedule)
+     */
+    dtypes::uint32 pollInterval_ms()
+    {
+        dtypes::uint32 wait = hardware().temperature.untilNextConversion_ms();
+        return (readInterval_ms > wait) ? readInterval_ms.value() : wait;
+    }
+
     // pause state if disconnected
     void pauseState()
     {
@@ -0,0 +1,284 @@
+#pragma once
+#include "uTypedef.h"
+#include "uParticleSystem.h"
+#include "flashLog.h"
+
+/**
+ * @brief every completed reading is appended to a log in flash so a power cut during a network outage
+ * doesn't lose data, readings that were logged offline are published in batches once the cloud is back
+ */
+class TcomponentFlashLog : public TmenuHandle
+{
+
+public:
+    // enumerations
+    sdds_enum(off, ready, backfilling, error) Tstatus;
+    sdds_enum(___, resend, erase) Taction;
+
+private:
+    TflashLog Flog;
+    Ttimer FbackfillTimer;
+
+    // backfill position: records before Fcursor are done (persisted after each batch),
+    // records before FresendTo are sent even if they were logged online (resend action)
+    static constexpr const char *FcursorFile = "/log/cursor";
+    static constexpr const char *FbackfillEvent = "microloggerBackfill";
+    dtypes::uint32 Fcursor = 0;
+    dtypes::uint32 FresendTo = 0;
+
+    // publish data buffer (Particle.publish limit) and records checked per batch
+    static constexpr dtypes::uint16 FpublishSize = 1024;
+    static constexpr dtypes::uint8 FmaxBatch = 16;
+    static constexpr dtypes::uint16 FmaxChecked = 256;
+
+    // failed publishes back off (doubling the batch interval up to 32x)
+    static constexpr dtypes::uint8 FmaxBackoff = 5;
+    dtypes::uint8 Fbackoff = 0;
+
+    // count records that rotation deleted before they were backfilled
+    void checkDropped()
+    {
+        if (Fcursor < Flog.oldestSeq())
+        {
+            dropped += Flog.oldestSeq() - Fcursor;
+            Fcursor = Flog.oldestSeq();
+        }
+    }
+
+    void updateInfo()
+    {
+        if (records != Flog.nextSeq() - Flog.oldestSeq())
+            records = Flog.nextSeq() - Flog.oldestSeq();
+        if (segments != Flog.segments())
+            segments = Flog.segments();
+        if (pending != Flog.nextSeq() - Fcursor)
+            pending = Flog.nextSeq() - Fcursor;
+    }
+
+    // one record as JSON (records from earlier boots without a clock keep their boot and uptime)
+    int format(char *_buf, size_t _size, const TflashRecord &_record)
+    {
+        char values[96];
+        char od[12], odSd[12], temperature[12];
+        std::isnan(_record.od) ? snprintf(od, sizeof(od), "null") : snprintf(od, sizeof(od), "%.4f", _record.od);
+        std::isnan(_record.odSd) ? snprintf(odSd, sizeof(odSd), "null") : snprintf(odSd, sizeof(odSd), "%.4f", _record.odSd);
+        std::isnan(_record.temperature_C) ? snprintf(temperature, sizeof(temperature), "null") : snprintf(temperature, sizeof(temperature), "%.2f", _record.temperature_C);
+        snprintf(values, sizeof(values), "\"OD\":%s,\"ODSd\":%s,\"T\":%s,\"rpm\":%d,\"V\":%.2f",
+                 od, odSd, temperature, _record.speed_rpm, _record.power_cV / 100.0f);
+
+        if (!(_record.flags & TflashRecord::UPTIME))
+            return snprintf(_buf, _size, "{\"seq\":%u,\"t\":%u,%s}", static_cast<unsigned int>(_record.seq), static_cast<unsigned int>(_record.time), values);
+        if (_record.boot == Flog.boot() && Time.isValid())
+            return snprintf(_buf, _size, "{\"seq\":%u,\"t\":%u,%s}", static_cast<unsigned int>(_record.seq), static_cast<unsigned int>(Time.now() - millis() / 1000 + _record.time), values);
+        return snprintf(_buf, _size, "{\"seq\":%u,\"boot\":%d,\"up\":%u,%s}", static_cast<unsigned int>(_record.seq), _record.boot, static_cast<unsigned int>(_record.time), values);
+    }
+
+    /**
+     * @brief publish the next batch of offline records
+     * @return true if there is more to send
+     */
+    bool backfill()
+    {
+        checkDropped();
+        dtypes::uint8 size = (batchSize < 1) ? 1 : (batchSize > FmaxBatch) ? FmaxBatch : batchSize.value();
+        char data[FpublishSize];
+        size_t len = snprintf(data, sizeof(data), "{\"records\":[");
+        dtypes::uint8 n = 0;
+        dtypes::uint32 seq = Fcursor;
+        dtypes::uint16 checked = 0;
+        TflashRecord batch[FmaxBatch];
+        while (seq < Flog.nextSeq() && n < size && checked < FmaxChecked)
+        {
+            dtypes::uint16 read = Flog.read(seq, batch, FmaxBatch);
+            if (read == 0)
+            {
+                // unreadable record, skip it
+                corrupted++;
+                seq++;
+                checked++;
+                continue;
+            }
+            dtypes::uint16 i = 0;
+            for (; i < read && n < size; i++)
+            {
+                const TflashRecord &record = batch[i];
+                if ((record.flags & TflashRecord::OFFLINE) || record.seq < FresendTo)
+                {
+                    char json[160];
+                    int jsonLen = format(json, sizeof(json), record);
+                    if (len + jsonLen + 3 > sizeof(data))
+                        break; // full
+                    len += snprintf(data + len, sizeof(data) - len, "%s%s", (n > 0) ? "," : "", json);
+                    n++;
+                }
+            }
+            seq += i;
+            checked += i;
+            if (i < read)
+                break;
+        }
+        snprintf(data + len, sizeof(data) - len, "]}");
+
+        // send and move on (try again later if it didn't go out)
+        if (n > 0 && !Particle.publish(FbackfillEvent, data))
+        {
+            if (Fbackoff < FmaxBackoff)
+                Fbackoff++;
+            return true;
+        }
+        Fbackoff = 0;
+        Fcursor = seq;
+        TflashLog::writeValue(FcursorFile, Fcursor);
+        if (n > 0)
+            backfilled += n;
+        updateInfo();
+        return Fcursor < Flog.nextSeq();
+    }
+
+public:
+    // sdds vars
+    sdds_var(Taction, action);
+    sdds_var(Tstatus, status, sdds::opt::readonly);
+    sdds_var(enums::ToffOn, logging, sdds::opt::saveval, enums::ToffOn::on);
+    sdds_var(Tuint32, records, sdds::opt::readonly, 0);   // in flash
+    sdds_var(Tuint8, segments, sdds::opt::readonly, 0);   // segment files in use
+    sdds_var(Tuint32, pending, sdds::opt::readonly, 0);   // records not yet checked for backfill
+    sdds_var(Tuint32, backfilled, sdds::opt::readonly, 0);
+    sdds_var(Tuint32, dropped, sdds::opt::readonly, 0);   // deleted by rotation before they were backfilled
+    sdds_var(Tuint32, corrupted, sdds::opt::readonly, 0); // torn or unreadable records (cut off on startup or skipped)
+    sdds_var(Tuint8, batchSize, sdds::opt::saveval, 8);   // records per backfill event (1-16)
+    sdds_var(Tuint32, batchInterval_ms, sdds::opt::saveval, 2000);
+    sdds_var(Tuint32, from_min, sdds::opt::nothing, 60); // resend the records from this many minutes ago
+    sdds_var(Tuint32, to_min, sdds::opt::nothing, 0);    // ... to this many minutes ago
+
+    // write telemetry
+    sdds_var(Tuint32, bytesWritten, sdds::opt::readonly, 0);
+    sdds_var(Tuint32, appendTime_us, sdds::opt::readonly, 0); // last append (write + sync)
+    sdds_var(Tuint32, maxAppendTime_us, sdds::opt::readonly, 0);
+
+    // constructor
+    TcomponentFlashLog()
+    {
+        // the file system is available once the system is up
+        on(particleSystem().startup)
+        {
+            if (particleSystem().startup == TparticleSystem::TstartupStatus::complete && !Flog.mounted())
+            {
+                dtypes::uint16 repaired = 0;
+                if (!Flog.mount(repaired))
+                {
+                    status = Tstatus::error;
+                    return;
+                }
+                corrupted += repaired;
+                if (!TflashLog::readValue(FcursorFile, Fcursor))
+                    Fcursor = Flog.oldestSeq();
+                if (Fcursor > Flog.nextSeq())
+                    Fcursor = Flog.nextSeq(); // cursor from a log that is gone (pending would underflow)
+                checkDropped();
+                updateInfo();
+                status = Tstatus::ready;
+                if (pending > 0)
+                    FbackfillTimer.start(batchInterval_ms);
+            }
+        };
+
+        // back online, send what was logged offline
+        on(particleSystem().internet)
+        {
+            if (particleSystem().internet == TparticleSystem::TinternetStatus::connected && Flog.mounted() && pending > 0)
+            {
+                Fbackoff = 0;
+                FbackfillTimer.start(batchInterval_ms);
+            }
+        };
+
+        on(FbackfillTimer)
+        {
+            if (!Particle.connected())
+            {
+                if (status == Tstatus::backfilling)
+                    status = Tstatus::ready;
+                return;
+            }
+            if (status != Tstatus::backfilling)
+                status = Tstatus::backfilling;
+            if (backfill())
+                FbackfillTimer.start(batchInterval_ms << Fbackoff);
+            else
+                status = Tstatus::ready;
+        };
+
+        on(action)
+        {
+            // stop if no action
+            if (action == Taction::___)
+                return;
+
+            // process actions
+            if (action == Taction::resend && Flog.mounted() && Time.isValid())
+            {
+                // locate the range with the index
+                dtypes::uint32 now = Time.now();
+                dtypes::uint32 from = Flog.find(now - from_min * 60);
+                FresendTo = Flog.find(now - to_min * 60);
+                if (from < Fcursor)
+                    Fcursor = from;
+                updateInfo();
+                FbackfillTimer.start(0);
+            }
+            else if (action == Taction::erase && Flog.mounted())
+            {
+                Flog.erase();
+                Fcursor = Flog.nextSeq();
+                FresendTo = 0;
+                TflashLog::writeValue(FcursorFile, Fcursor);
+                updateInfo();
+            }
+            action = Taction::___;
+        };
+    }
+
+    // log a completed reading
+    void add(dtypes::float32 _od, dtypes::float32 _odSd, dtypes::float32 _temperature_C, dtypes::uint16 _speed_rpm, dtypes::float32 _power_V)
+    {
+        if (logging != enums::ToffOn::on || !Flog.mounted())
+            return;
+
+        TflashRecord record = {};
+        record.time = Time.isValid() ? Time.now() : millis() / 1000;
+        record.flags = (Time.isValid() ? 0 : TflashRecord::UPTIME) | (Particle.connected() ? 0 : TflashRecord::OFFLINE);
+        record.speed_rpm = _speed_rpm;
+        record.od = _od;
+        record.odSd = _odSd;
+        record.temperature_C = _temperature_C;
+        record.power_cV = std::isnan(_power_V) ? 0 : static_cast<dtypes::uint16>(_power_V * 100 + 0.5f);
+
+        // append (timed)
+        dtypes::uint32 start = micros();
+        dtypes::uint16 bytes = Flog.append(record);
+        dtypes::uint32 elapsed = micros() - start;
+        if (bytes == 0)
+        {
+            if (status != Tstatus::error)
+                status = Tstatus::error;
+            return;
+        }
+        if (status == Tstatus::error)
+            status = Tstatus::ready;
+        bytesWritten += bytes;
+        appendTime_us = elapsed;
+        if (elapsed > maxAppendTime_us)
+            maxAppendTime_us = elapsed;
+
+        // nothing waiting and logged online: no need to look at it again
+        if (Fcursor == record.seq && !(record.flags & TflashRecord::OFFLINE))
+            Fcursor++;
+        checkDropped();
+        updateInfo();
+
+        // logged offline while online again (e.g. the cloud just came back)
+        if (pending > 0 && Particle.connected() && !FbackfillTimer.running())
+            FbackfillTimer.start(batchInterval_ms);
+    }
+};
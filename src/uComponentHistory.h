@@ -0,0 +1,167 @@
+#pragma once
+#include "uTypedef.h"
+#include "history.h"
+
+/**
+ * @brief recent OD readings kept in RAM (with temperature and stirrer speed) for trends on the display
+ * and for dashboards that reconnect, queried by time range with decimation
+ */
+class TcomponentHistory : public TmenuHandle
+{
+
+public:
+    // a week of readings at the default 2 minute read interval (8 bytes each, ~40 kB)
+    static constexpr dtypes::uint16 Fcapacity = 7 * 24 * 30;
+    using Tdata = Thistory<Fcapacity>;
+
+private:
+    Tdata Fdata;
+
+    // query output
+    static constexpr dtypes::uint8 FmaxPoints = 32;
+    static constexpr dtypes::uint16 FresultSize = FmaxPoints * 36;
+
+    // decimation bucket (sums of the readings in it)
+    struct Tbucket
+    {
+        dtypes::uint32 age_sec;
+        dtypes::float32 od, odSd, temperature, speed;
+        dtypes::uint16 n, nOd, nOdSd, nTemperature;
+    };
+
+    /**
+     * @brief readings from from_min to to_min ago, averaged into at most points buckets
+     * "age_min,OD,ODSd,temperature_C,speed_rpm" per point, oldest first, separated by ';'
+     */
+    void query()
+    {
+        const dtypes::uint32 from = from_min * 60;
+        const dtypes::uint32 to = to_min * 60;
+        dtypes::uint8 maxPoints = (points < 1) ? 1 : (points > FmaxPoints) ? FmaxPoints : points.value();
+
+        // records in range
+        dtypes::uint16 n = 0;
+        Fdata.walk([&](const ThistoryRecord &, dtypes::uint32 _age)
+                   {
+            if (_age > from)
+                return false;
+            if (_age >= to)
+                n++;
+            return true; });
+
+        // bucket means (newest first)
+        Tbucket buckets[FmaxPoints] = {};
+        dtypes::uint16 perBucket = (n > maxPoints) ? (n + maxPoints - 1) / maxPoints : 1;
+        dtypes::uint16 i = 0;
+        Fdata.walk([&](const ThistoryRecord &_record, dtypes::uint32 _age)
+                   {
+            if (_age > from)
+                return false;
+            if (_age < to)
+                return true;
+            Tbucket &b = buckets[i++ / perBucket];
+            b.age_sec += _age;
+            b.n++;
+            b.speed += _record.speed_rpm;
+            if (!std::isnan(_record.OD()))
+            {
+                b.od += _record.OD();
+                b.nOd++;
+            }
+            if (!std::isnan(_record.ODSd()))
+            {
+                b.odSd += _record.ODSd();
+                b.nOdSd++;
+            }
+            if (!std::isnan(_record.temperature_C()))
+            {
+                b.temperature += _record.temperature_C();
+                b.nTemperature++;
+            }
+            return true; });
+
+        // format (oldest first, empty fields for no data)
+        char out[FresultSize];
+        size_t len = 0;
+        out[0] = 0;
+        dtypes::uint8 used = (n == 0) ? 0 : (n + perBucket - 1) / perBucket;
+        for (dtypes::int16 j = used - 1; j >= 0 && len < sizeof(out); j--)
+        {
+            const Tbucket &b = buckets[j];
+            len += snprintf(out + len, sizeof(out) - len, "%s%.1f,", (len > 0) ? ";" : "", b.age_sec / 60.0f / b.n);
+            if (b.nOd > 0 && len < sizeof(out))
+                len += snprintf(out + len, sizeof(out) - len, "%.4f", b.od / b.nOd);
+            if (len < sizeof(out))
+                len += snprintf(out + len, sizeof(out) - len, ",");
+            if (b.nOdSd > 0 && len < sizeof(out))
+                len += snprintf(out + len, sizeof(out) - len, "%.4f", b.odSd / b.nOdSd);
+            if (len < sizeof(out))
+                len += snprintf(out + len, sizeof(out) - len, ",");
+            if (b.nTemperature > 0 && len < sizeof(out))
+                len += snprintf(out + len, sizeof(out) - len, "%.1f", b.temperature / b.nTemperature);
+            if (len < sizeof(out))
+                len += snprintf(out + len, sizeof(out) - len, ",%d", static_cast<int>(b.speed / b.n + 0.5f));
+        }
+        result = out;
+        resultPoints = used;
+    }
+
+    // keep the info fields up to date
+    void updateInfo()
+    {
+        if (records != Fdata.size())
+            records = Fdata.size();
+        if (span_min != Fdata.span_sec() / 60)
+            span_min = Fdata.span_sec() / 60;
+    }
+
+public:
+    // enumerations
+    sdds_enum(___, query, clear) Taction;
+
+    // sdds vars
+    sdds_var(Taction, action);
+    sdds_var(Tuint16, records, sdds::opt::readonly, 0);
+    sdds_var(Tuint16, capacity, sdds::opt::readonly, Fcapacity);
+    sdds_var(Tuint32, span_min, sdds::opt::readonly, 0);                         // age of the oldest record
+    sdds_var(Tuint32, from_min, sdds::opt::nothing, 240);                        // query from this many minutes ago
+    sdds_var(Tuint32, to_min, sdds::opt::nothing, 0);                            // ... to this many minutes ago
+    sdds_var(Tuint8, points, sdds::opt::nothing, FmaxPoints);                    // ... averaged into at most this many points
+    sdds_var(Tstring, result, sdds::opt::readonly);                              // age_min,OD,ODSd,temperature_C,speed_rpm;... (oldest first)
+    sdds_var(Tuint8, resultPoints, sdds::opt::readonly, 0);
+    sdds_var(enums::ToffOn, sparkline, sdds::opt::saveval, enums::ToffOn::off); // show the OD trend on the display instead of the status lines
+
+    // constructor
+    TcomponentHistory()
+    {
+        on(action)
+        {
+            // stop if no action
+            if (action == Taction::___)
+                return;
+
+            // process actions
+            if (action == Taction::query)
+                query();
+            else if (action == Taction::clear)
+            {
+                Fdata.clear();
+                updateInfo();
+            }
+            action = Taction::___;
+        };
+    }
+
+    // add a reading
+    void add(dtypes::float32 _od, dtypes::float32 _odSd, dtypes::float32 _temperature_C, dtypes::uint16 _speed_rpm)
+    {
+        Fdata.add(_od, _odSd, _temperature_C, _speed_rpm);
+        updateInfo();
+    }
+
+    // the readings
+    const Tdata &data() const
+    {
+        return Fdata;
+    }
+};
@@ -12,8 +12,8 @@ class TcomponentLights : public TmenuHandle
 
 public:
     // enumerations
-    sdds_enum(___, on, off, schedule, pause, resume) Taction;
-    sdds_enum(on, off, schedule) Tstate;
+    sdds_enum(___, on, off, schedule, pause, resume, pulse, program) Taction;
+    sdds_enum(on, off, schedule, pulse, program) Tstate;
     sdds_enum(on, off, error) Tstatus;
     sdds_enum(none, paused) Tevent;
 
@@ -28,17 +28,30 @@ public:
     sdds_var(Tuint32, scheduleOn_sec, sdds::opt::saveval, 60 * 60 * 12);  // 12 hours on
     sdds_var(Tuint32, scheduleOff_sec, sdds::opt::saveval, 60 * 60 * 12); // 12 hours off
     sdds_var(Tuint16, scheduleOnStart_HHMM, sdds::opt::saveval, 1200);
-    sdds_var(Tstring, scheduleInfo, sdds::opt::readonly);
+    sdds_var(Tstring, program, sdds::opt::saveval);                 // daily program HHMM:percent[:ramp_min],... e.g. 0600:100:30,1800:0:30
+    sdds_var(Tuint8, programSegments, sdds::opt::readonly, 0);      // valid program segments (0 = none or not valid)
+    sdds_var(Tstring, scheduleInfo, sdds::opt::readonly);           // next transition (only changes at transitions)
+    sdds_var(Tuint16, pulsePeriod_ms, sdds::opt::saveval, 1000); // pulsed light period (run by the dimmer chip, 42 ms to 10.7 s)
+    sdds_var(Tuint8, pulseDuty_percent, sdds::opt::saveval, 50); // pulsed light on-time per period
 
     // sdds variables for fan
     class Tfan : public TmenuHandle
     {
     public:
-        sdds_enum(___, on, off, withLight) Taction;
-        sdds_enum(on, off, withLight) Tstate;
+        sdds_enum(___, on, off, withLight, regulate) Taction;
+        sdds_enum(on, off, withLight, regulate) Tstate;
         sdds_var(Taction, action);
         sdds_var(Tstate, state, sdds_joinOpt(sdds::opt::saveval, sdds::opt::readonly), Tstate::withLight);
         sdds_var(Tstatus, status, sdds::opt::readonly, Tstatus::off);
+
+        // temperature regulation (proportional with on/off hysteresis)
+        sdds_var(Tfloat32, setpoint_C, sdds::opt::saveval, 30.0);
+        sdds_var(Tfloat32, hysteresis_C, sdds::opt::saveval, 0.2);      // on above setpoint + hysteresis, off below setpoint - hysteresis
+        sdds_var(Tuint8, gain_percent_C, sdds::opt::saveval, 25);       // duty increase per degree above the on threshold
+        sdds_var(Tuint8, minDuty_percent, sdds::opt::saveval, 20);      // slowest the fan runs reliably
+        sdds_var(Tuint32, minWriteInterval_ms, sdds::opt::saveval, 5000); // limits duty changes (i2c writes)
+        sdds_var(Tuint8, duty_percent, sdds::opt::readonly, 0);
+        sdds_var(Tfloat32, error_C, sdds::opt::readonly);               // temperature - setpoint
     };
     sdds_var(Tfan, fan);
 
@@ -51,13 +64,19 @@ private:
     {
         bool isOn;
         uint32_t secondsToSwitch;
-        uint8_t h, m, s;
     };
 
+    // time of day
+    static constexpr dtypes::uint32 FdaySec = 24 * 60 * 60;
+    static dtypes::uint32 nowSec()
+    {
+        return static_cast<dtypes::uint32>(Time.hour()) * 3600 + Time.minute() * 60 + Time.second();
+    }
+
     Schedule calculateSchedule()
     {
         // schedule object
-        Schedule r{false, 0, 0, 0, 0};
+        Schedule r{false, 0};
 
         // do we have a valid time?
         if (!Time.isValid())
@@ -67,8 +86,8 @@ private:
         const uint16_t start_hour = scheduleOnStart_HHMM.value() / 100;
         const uint16_t start_min = scheduleOnStart_HHMM.value() % 100;
         const uint32_t start_sec = start_hour * 60 * 60 + start_min * 60;
-        const uint32_t now_sec = static_cast<uint32_t>(Time.hour()) * 3600 + Time.minute() * 60 + Time.second();
-        const uint32_t delta = (start_sec > now_sec) ? 24 * 60 * 60 + now_sec - start_sec : now_sec - start_sec;
+        const uint32_t now_sec = nowSec();
+        const uint32_t delta = (start_sec > now_sec) ? FdaySec + now_sec - start_sec : now_sec - start_sec;
 
         // figure out which phase we are in and when the next phase starts
         const uint32_t period = scheduleOn_sec.value() + scheduleOff_sec.value();
@@ -83,16 +102,185 @@ private:
             r.isOn = false;
             r.secondsToSwitch = period - phase; // OFF -> ON
         }
-
-        // determine time to next in H:M:S
-        uint32_t t = r.secondsToSwitch;
-        r.h = (uint8_t)(t / 3600);
-        t %= 3600;
-        r.m = (uint8_t)(t / 60);
-        r.s = (uint8_t)(t % 60);
         return r;
     }
 
+    // daily program segments (sorted by start time)
+    struct TprogramSegment
+    {
+        dtypes::uint32 start_sec; // time of day
+        dtypes::uint8 percent;    // intensity (0 = off)
+        dtypes::uint32 ramp_sec;  // ramp from the previous segment's intensity
+    };
+    static constexpr dtypes::uint8 FmaxProgramSegments = 24;
+    TprogramSegment Fprogram[FmaxProgramSegments];
+    dtypes::uint8 FprogramN = 0;
+
+    // program position (what to do now and when the next transition is)
+    struct TprogramStep
+    {
+        dtypes::uint8 percent;     // intensity now
+        dtypes::uint32 toNext_sec; // until the next intensity change
+        dtypes::uint8 target;      // intensity the current/next segment is headed for
+        dtypes::uint32 targetAt_sec; // time of day it gets there
+    };
+
+    /**
+     * @brief parse the daily program "HHMM:percent[:ramp_min],..." (any order)
+     * @return number of segments, 0 if empty or not valid
+     */
+    dtypes::uint8 parseProgram(const char *_program)
+    {
+        dtypes::uint8 n = 0;
+        const char *p = _program;
+        while (*p != 0)
+        {
+            if (n >= FmaxProgramSegments)
+                return 0;
+            char *end;
+            long hhmm = strtol(p, &end, 10);
+            if (end == p || *end != ':' || hhmm < 0 || hhmm / 100 > 23 || hhmm % 100 > 59)
+                return 0;
+            p = end + 1;
+            long percent = strtol(p, &end, 10);
+            if (end == p || percent < 0 || percent > 100)
+                return 0;
+            p = end;
+            long ramp = 0;
+            if (*p == ':')
+            {
+                ramp = strtol(p + 1, &end, 10);
+                if (end == p + 1 || ramp < 0 || ramp > 24 * 60)
+                    return 0;
+                p = end;
+            }
+            if (*p == ',')
+                p++;
+            else if (*p != 0)
+                return 0;
+
+            // insert sorted
+            TprogramSegment seg{static_cast<dtypes::uint32>(hhmm / 100 * 3600 + hhmm % 100 * 60), static_cast<dtypes::uint8>(percent), static_cast<dtypes::uint32>(ramp * 60)};
+            dtypes::uint8 i = n++;
+            for (; i > 0 && Fprogram[i - 1].start_sec > seg.start_sec; i--)
+                Fprogram[i] = Fprogram[i - 1];
+            Fprogram[i] = seg;
+        }
+        return n;
+    }
+
+    /**
+     * @brief where in the program are we? binary search for the segment that started last,
+     * ramps change the intensity one percent at a time
+     */
+    TprogramStep programStep(dtypes::uint32 _now_sec)
+    {
+        // last segment starting at or before now (before the first --> yesterday's last)
+        dtypes::uint8 lo = 0, hi = FprogramN;
+        while (lo < hi)
+        {
+            dtypes::uint8 mid = (lo + hi) / 2;
+            if (Fprogram[mid].start_sec <= _now_sec)
+                lo = mid + 1;
+            else
+                hi = mid;
+        }
+        const dtypes::uint8 i = (lo == 0) ? FprogramN - 1 : lo - 1;
+        const dtypes::uint8 prev = (i == 0) ? FprogramN - 1 : i - 1;
+        const dtypes::uint8 next = (i + 1 == FprogramN) ? 0 : i + 1;
+        const TprogramSegment &seg = Fprogram[i];
+        const dtypes::uint32 since = (_now_sec + FdaySec - seg.start_sec) % FdaySec;
+        dtypes::uint32 toNextSegment = (Fprogram[next].start_sec + FdaySec - _now_sec) % FdaySec;
+        if (toNextSegment == 0)
+            toNextSegment = FdaySec;
+
+        // ramping?
+        const dtypes::uint8 from = Fprogram[prev].percent;
+        if (since < seg.ramp_sec && from != seg.percent)
+        {
+            const dtypes::uint32 span = (seg.percent > from) ? seg.percent - from : from - seg.percent;
+            const dtypes::uint32 done = span * since / seg.ramp_sec;
+            const dtypes::uint8 percent = (seg.percent > from) ? from + done : from - done;
+            // next percent step (ceil)
+            dtypes::uint32 toNext = ((done + 1) * seg.ramp_sec + span - 1) / span - since;
+            if (toNext == 0)
+                toNext = 1;
+            if (toNext > toNextSegment)
+                toNext = toNextSegment;
+            return TprogramStep{percent, toNext, seg.percent, (seg.start_sec + seg.ramp_sec) % FdaySec};
+        }
+
+        // holding until the next segment
+        return TprogramStep{seg.percent, toNextSegment, Fprogram[next].percent, Fprogram[next].start_sec};
+    }
+
+    // fan regulation
+    dtypes::uint8 FfanDuty = 0;             // regulated duty (percent)
+    dtypes::TtickCount FlastFanWrite = 0;   // last regulated duty change
+    bool FfanWritten = false;               // regulated duty was changed before
+
+    /**
+     * @brief regulate the fan duty from the temperature, with hysteresis for switching on/off
+     * and at most one duty change every minWriteInterval_ms (the caller updates the hardware)
+     * @return true if the duty changed
+     */
+    bool regulateFan()
+    {
+        if (fan.state != Tfan::Tstate::regulate)
+            return false;
+
+        // error
+        dtypes::uint8 duty = FfanDuty;
+        if (hardware().temperature.error != Thardware::Ti2cError::none || hardware().temperature.temperature_C.isNan())
+        {
+            // no temperature, fail safe
+            duty = 100;
+        }
+        else
+        {
+            const dtypes::float32 e = hardware().temperature.temperature_C.value() - fan.setpoint_C.value();
+            const dtypes::float32 error = round(e * 100) / 100;
+            if (fan.error_C != error)
+                fan.error_C = error;
+
+            if (duty == 0 && e <= fan.hysteresis_C.value())
+                duty = 0; // off and not warm enough yet
+            else if (duty > 0 && e < -fan.hysteresis_C.value())
+                duty = 0; // on and cool enough
+            else
+            {
+                // proportional above the off threshold
+                dtypes::float32 d = fan.minDuty_percent.value() + fan.gain_percent_C.value() * (e + fan.hysteresis_C.value());
+                duty = (d < fan.minDuty_percent.value()) ? fan.minDuty_percent.value() : (d > 100) ? 100 : static_cast<dtypes::uint8>(round(d));
+            }
+        }
+
+        // change duty (rate limited)
+        if (duty == FfanDuty || (FfanWritten && millis() - FlastFanWrite < fan.minWriteInterval_ms.value()))
+            return false;
+        FfanDuty = duty;
+        FlastFanWrite = millis();
+        FfanWritten = true;
+        fan.duty_percent = FfanDuty;
+        return true;
+    }
+
+    // next transition (for the countdown on the display)
+    dtypes::TtickCount FnextTransition = 0;
+    dtypes::int16 FnextPercent = -1; // what happens then (in percent, -1 = nothing scheduled)
+
+    // update the schedule info (only when the transition changes)
+    void setScheduleInfo(dtypes::uint8 _percent, dtypes::uint32 _at_sec)
+    {
+        char buf[16]; // snprintf buffer
+        if (state == Tstate::schedule)
+            snprintf(buf, sizeof(buf), "%s@%02d:%02d", (_percent > 0) ? "on" : "off", static_cast<int>(_at_sec / 3600), static_cast<int>(_at_sec % 3600 / 60));
+        else
+            snprintf(buf, sizeof(buf), "%d%%@%02d:%02d", _percent, static_cast<int>(_at_sec / 3600), static_cast<int>(_at_sec % 3600 / 60));
+        if (scheduleInfo != buf)
+            scheduleInfo = buf;
+    }
+
     // update with current light and fan state
     void update()
     {
@@ -104,15 +292,17 @@ private:
     {
         // light
         bool light = false;
+        dtypes::uint8 intensity = intensity_percent.value();
+        FnextPercent = -1;
         if (_lightState == Tstate::off)
         {
             // off
             if (scheduleInfo != "")
                 scheduleInfo = "";
         }
-        else if (_lightState == Tstate::on)
+        else if (_lightState == Tstate::on || _lightState == Tstate::pulse)
         {
-            // on
+            // on (steady or pulsed)
             light = true;
             if (scheduleInfo != "")
                 scheduleInfo = "";
@@ -129,28 +319,41 @@ private:
             }
             else
             {
-
-                // determine schedule
+                // determine schedule and check back in at the switch
                 Schedule s = calculateSchedule();
                 light = s.isOn;
-                const dtypes::string next = (s.isOn) ? "off:" : "on:";
-
-                // when to scheck back in?
-                if (s.h == 0 && s.m == 0)
-                {
-                    scheduleInfo = next + dtypes::string(s.s) + "s";
-                    FscheduleTimer.start(1000); // once a second
-                }
-                else if (s.h == 0)
-                {
-                    scheduleInfo = next + dtypes::string(s.m) + "m" + dtypes::string(s.s) + "s";
-                    FscheduleTimer.start(1000); // once a second
-                }
-                else
-                {
-                    scheduleInfo = next + dtypes::string(s.h) + "h" + dtypes::string(s.m) + "m";
-                    FscheduleTimer.start((s.s + 1) * 1000); // once we're down a minute
-                }
+                FnextPercent = s.isOn ? 0 : 100;
+                FnextTransition = millis() + s.secondsToSwitch * 1000;
+                setScheduleInfo(FnextPercent, (nowSec() + s.secondsToSwitch) % FdaySec);
+                FscheduleTimer.start(s.secondsToSwitch * 1000);
+            }
+        }
+        else if (_lightState == Tstate::program)
+        {
+            // daily program
+            if (FprogramN == 0)
+            {
+                // nothing to run
+                if (scheduleInfo != "no program")
+                    scheduleInfo = "no program";
+            }
+            else if (!Time.isValid())
+            {
+                // don't have valid time yet - keep off and reschedule check
+                if (scheduleInfo != "pending")
+                    scheduleInfo = "pending";
+                FscheduleTimer.start(1000);
+            }
+            else
+            {
+                // current intensity and check back in at the next intensity change
+                TprogramStep step = programStep(nowSec());
+                light = step.percent > 0;
+                intensity = step.percent;
+                FnextPercent = step.target;
+                FnextTransition = millis() + ((step.targetAt_sec + FdaySec - nowSec()) % FdaySec) * 1000;
+                setScheduleInfo(step.target, step.targetAt_sec);
+                FscheduleTimer.start(step.toNext_sec * 1000);
             }
         }
 
@@ -158,18 +361,20 @@ private:
         if (event == Tevent::paused)
             light = false;
 
-        // update light
-        (light) ? hardware().setLight(enums::ToffOn::on, intensity_percent.value()) : hardware().setLight(enums::ToffOn::off);
-
         // fan
-        bool fan = false;
+        dtypes::uint8 fan = 0;
         if (_fanState == Tfan::Tstate::on)
-            fan = true;
+            fan = 100;
         else if (_fanState == Tfan::Tstate::withLight)
-            fan = light;
-
-        // update fan
-        (fan) ? hardware().setFan(enums::ToffOn::on) : hardware().setFan(enums::ToffOn::off);
+            fan = (light) ? 100 : 0;
+        else if (_fanState == Tfan::Tstate::regulate)
+            fan = FfanDuty;
+
+        // update light and fan in one dimmer write (pulses are executed by the dimmer hardware)
+        hardware().setFanLight(
+            light ? enums::ToffOn::on : enums::ToffOn::off, intensity,
+            (light && _lightState == Tstate::pulse) ? pulsePeriod_ms.value() : 0, pulseDuty_percent.value(),
+            (fan > 0) ? enums::ToffOn::on : enums::ToffOn::off, fan);
     }
 
 public:
@@ -220,6 +425,16 @@ public:
                 state = Tstate::schedule;
                 update();
             }
+            else if (action == Taction::pulse)
+            {
+                state = Tstate::pulse;
+                update();
+            }
+            else if (action == Taction::program)
+            {
+                state = Tstate::program;
+                update();
+            }
             else if (action == Taction::pause)
             {
                 // no state change but event paused is now active
@@ -251,9 +466,9 @@ public:
         {
             if (hardware().fanLightError != Thardware::Ti2cError::none && status != Tstatus::error)
                 status = Tstatus::error;
-            else if ((hardware().lightValue == Thardware::TlightValue::ON || hardware().lightValue == Thardware::TlightValue::DIMMED) && status != Tstatus::on)
+            else if ((hardware().lightValue == Thardware::TlightValue::ON || hardware().lightValue == Thardware::TlightValue::DIMMED || hardware().lightValue == Thardware::TlightValue::PULSED) && status != Tstatus::on)
                 status = Tstatus::on;
-            else if ((hardware().lightValue != Thardware::TlightValue::ON && hardware().lightValue != Thardware::TlightValue::DIMMED) && status != Tstatus::off)
+            else if ((hardware().lightValue != Thardware::TlightValue::ON && hardware().lightValue != Thardware::TlightValue::DIMMED && hardware().lightValue != Thardware::TlightValue::PULSED) && status != Tstatus::off)
                 status = Tstatus::off;
         };
 
@@ -282,6 +497,22 @@ public:
             else
                 update();
         };
+        on(pulsePeriod_ms)
+        {
+            if (pulsePeriod_ms < 42)
+                pulsePeriod_ms = 42;
+            else if (pulsePeriod_ms > 10667)
+                pulsePeriod_ms = 10667;
+            else
+                update();
+        };
+        on(pulseDuty_percent)
+        {
+            if (pulseDuty_percent > 100)
+                pulseDuty_percent = 100;
+            else
+                update();
+        };
         on(scheduleOnStart_HHMM)
         {
             if (scheduleOnStart_HHMM > 2359)
@@ -289,6 +520,14 @@ public:
             else
                 update();
         };
+        on(program)
+        {
+            FprogramN = parseProgram(program.c_str());
+            if (programSegments != FprogramN)
+                programSegments = FprogramN;
+            if (state == Tstate::program)
+                update();
+        };
 
         // fan action events
         on(fan.action)
@@ -308,10 +547,38 @@ public:
                 fan.state = Tfan::Tstate::withLight;
                 update();
             }
+            else if (fan.action == Tfan::Taction::regulate)
+            {
+                // start from off and regulate right away, then one update for the new state and duty
+                fan.state = Tfan::Tstate::regulate;
+                FfanDuty = 0;
+                FfanWritten = false;
+                fan.duty_percent = 0;
+                regulateFan();
+                update();
+            }
             if (fan.action != Tfan::Taction::___)
                 fan.action = Tfan::Taction::___;
         };
 
+        // regulate fan with every temperature reading
+        on(hardware().temperature.temperature_C)
+        {
+            if (regulateFan())
+                update();
+        };
+        on(hardware().temperature.error)
+        {
+            if (regulateFan())
+                update();
+        };
+        on(fan.setpoint_C)
+        {
+            FfanWritten = false; // respond right away
+            if (regulateFan())
+                update();
+        };
+
         // update fan status from hardware
         on(hardware().fanValue)
         {
@@ -324,6 +591,31 @@ public:
         };
     }
 
+    /**
+     * @brief countdown to the next schedule/program transition (formatted only when asked, e.g. for the display)
+     * @return false if there is no transition coming up
+     */
+    bool nextTransition(char *_buf, size_t _size)
+    {
+        if (FnextPercent < 0 || event != Tevent::none)
+            return false;
+        // time left across millis() wraparound (a transition that has passed is more than half the range away)
+        dtypes::uint32 left = static_cast<dtypes::uint32>(FnextTransition - millis());
+        int t = (left < 0x80000000UL) ? static_cast<int>((left + 999) / 1000) : 0;
+        char what[6];
+        if (state == Tstate::schedule)
+            snprintf(what, sizeof(what), "%s", (FnextPercent > 0) ? "on" : "off");
+        else
+            snprintf(what, sizeof(what), "%d%%", FnextPercent);
+        if (t >= 3600)
+            snprintf(_buf, _size, "%s:%dh%dm", what, t / 3600, t % 3600 / 60);
+        else if (t >= 60)
+            snprintf(_buf, _size, "%s:%dm%ds", what, t / 60, t % 60);
+        else
+            snprintf(_buf, _size, "%s:%ds", what, t);
+        return true;
+    }
+
     // pause state if disconnected
     void pauseState()
     {
@@ -34,7 +34,10 @@ private:
     Ttimer FsettlingTimer;
     Ttimer FwarmupCooldownTimer;
     Ttimer FpausingToZeroTimer;
+    Ttimer FdeferredReadTimer;
     system_tick_t FnextRead = 0;
+    bool FreadDeferred = false; // read is waiting for the stirrer to finish ramping
+    const dtypes::uint32 FdeferredReadTimeout_ms = 30000; // read anyway if the ramp does not finish
 
     // temporary values for gain adjustment
     bool FbeamWasOn = false;
@@ -683,7 +686,10 @@ public:
             {
                 // resume stirrer and lights (they manage what that means - nothing if they're off or have not been paused)
                 if (Fstirrer)
+                {
+                    (*Fstirrer).hold(false);
                     (*Fstirrer).action = TcomponentStirrer::Taction::resume;
+                }
                 if (Flights)
                     (*Flights).action = TcomponentLights::Taction::resume;
             }
@@ -715,14 +721,26 @@ public:
         {
             if (zero.valid == enums::TnoYes::yes)
             {
-                status = Tstatus::reading;
-                Freading = TreadingStages::READ_START;
                 FnextRead = millis() + reading.readInterval_ms.value();
                 FreadTimer.start(reading.readInterval_ms.value());
-                process();
+                if (Fstirrer && (*Fstirrer).isRamping())
+                {
+                    // never read mid-ramp, wait for the stirrer to get to its speed
+                    FreadDeferred = true;
+                    FdeferredReadTimer.start(FdeferredReadTimeout_ms);
+                    return;
+                }
+                startRead();
             }
         };
 
+        on(FdeferredReadTimer)
+        {
+            // the stirrer never reached its speed (e.g. stalled ramp), don't skip the read
+            if (FreadDeferred && zero.valid == enums::TnoYes::yes && status == Tstatus::idle)
+                startRead();
+        };
+
         on(reading.readInterval_ms)
         {
             if (FreadTimer.running())
@@ -755,6 +773,19 @@ public:
         };
     }
 
+    // start a read (stirrer protocol holds its segment boundaries until the read is done)
+    void startRead()
+    {
+        FreadDeferred = false;
+        if (FdeferredReadTimer.running())
+            FdeferredReadTimer.stop();
+        if (Fstirrer)
+            (*Fstirrer).hold(true);
+        status = Tstatus::reading;
+        Freading = TreadingStages::READ_START;
+        process();
+    }
+
     // set pointer to stirrer component to control stirring
     void setStirrer(TcomponentStirrer *_stirrer)
     {
@@ -773,6 +804,10 @@ public:
             // check if stopping is done
             if ((FgainAdjustment == TgainAdjustmentStages::GAIN_STIR_STOP || Freading == TreadingStages::READ_STIR_STOP) && (*Fstirrer).status == TcomponentStirrer::Tstatus::off)
                 process(true);
+
+            // deferred read once the stirrer is done ramping
+            if (FreadDeferred && !(*Fstirrer).isRamping() && zero.valid == enums::TnoYes::yes && status == Tstatus::idle)
+                startRead();
         };
     }
 
@@ -15,7 +15,7 @@ public:
     // enumerations
     sdds_enum(___, start, stop, pause, resume, vortex) Taction;
     sdds_enum(off, accelerating, decelerating, running, error) Tstatus;
-    sdds_enum(none, paused, vortexing) Tevent;
+    sdds_enum(none, paused, vortexing, recovering) Tevent;
 
 private:
     // keep track of publishing to detect when it switches from OFF to ON
@@ -28,9 +28,155 @@ private:
     // timers
     const dtypes::TtickCount FrestartDelay = 1000; // ms
     Ttimer FrestartTimer;
-    const dtypes::TtickCount FspeedChangeInterval = 100; // ms
-    Ttimer FspeedChangeTimer;
     Ttimer FvortexEndTimer;
+    Ttimer FrecoveryTimer;
+
+    // decoupling recoveries in a row (within FrecoveryWindow of each other)
+    dtypes::uint8 FrecoveryStreak = 0;
+    dtypes::TtickCount FlastRecovery = 0;
+    const dtypes::TtickCount FrecoveryWindow = 600000; // ms
+
+    // waiting for a motor ramp to finish
+    bool FrampPending = false;
+
+    // agitation protocol segments (parsed from protocol.segments)
+    struct Tsegment
+    {
+        dtypes::uint16 speed_rpm;
+        dtypes::uint32 duration_sec;
+        dtypes::uint16 ramp_rpm_s; // 0 = acceleration/deceleration settings
+    };
+    static constexpr dtypes::uint8 FmaxSegments = 16;
+    Tsegment Fsegments[FmaxSegments];
+    dtypes::uint8 FsegmentsN = 0;
+    dtypes::uint8 Fsegment = 0;
+    Ttimer FsegmentTimer;                 // runs to the next segment boundary
+    dtypes::TtickCount FsegmentEnd = 0;   // when the current segment ends
+    dtypes::TtickCount FsegmentLeft = 0;  // time left in the current segment while paused
+    bool FsegmentDue = false;             // segment boundary is waiting for an event (or a hold) to end
+    bool Fheld = false;                   // segment boundaries on hold (e.g. during an OD read)
+
+    /**
+     * @brief parse protocol segments "rpm:sec[:ramp],..." e.g. "1500:30,0:300,3000:3:1000"
+     * @return number of segments, 0 if empty or not valid
+     */
+    dtypes::uint8 parseSegments(const char *_segments)
+    {
+        dtypes::uint8 n = 0;
+        const char *p = _segments;
+        while (*p != 0)
+        {
+            if (n >= FmaxSegments)
+                return 0;
+            char *end;
+            long rpm = strtol(p, &end, 10);
+            if (end == p || *end != ':' || rpm < 0 || rpm > 65535)
+                return 0;
+            p = end + 1;
+            long sec = strtol(p, &end, 10);
+            if (end == p || sec <= 0)
+                return 0;
+            p = end;
+            long ramp = 0;
+            if (*p == ':')
+            {
+                ramp = strtol(p + 1, &end, 10);
+                if (end == p + 1 || ramp < 0 || ramp > 65535)
+                    return 0;
+                p = end;
+            }
+            if (*p == ',')
+                p++;
+            else if (*p != 0)
+                return 0;
+            Fsegments[n++] = {static_cast<dtypes::uint16>(rpm), static_cast<dtypes::uint32>(sec), static_cast<dtypes::uint16>(ramp)};
+        }
+        return n;
+    }
+
+    // is the protocol running?
+    bool protocolRunning()
+    {
+        return protocol.status == Tprotocol::Tstatus::running || protocol.status == Tprotocol::Tstatus::paused;
+    }
+
+    // speed to run at when nothing else is going on
+    dtypes::uint16 runSpeed()
+    {
+        if (protocolRunning())
+            return (Fsegments[Fsegment].speed_rpm > settings.maxSpeed_rpm) ? settings.maxSpeed_rpm.value() : Fsegments[Fsegment].speed_rpm;
+        return setpoint_rpm;
+    }
+
+    // start running: protocol (if enabled) or constant setpoint
+    void run()
+    {
+        if (protocol.enabled == enums::ToffOn::on && FsegmentsN > 0)
+            startProtocol();
+        else
+        {
+            stopProtocol();
+            changeSpeed(setpoint_rpm);
+        }
+    }
+
+    /**
+     * @brief protocol from the top
+     */
+    void startProtocol()
+    {
+        protocol.status = Tprotocol::Tstatus::running;
+        protocol.cycle = 1;
+        enterSegment(0);
+    }
+
+    /**
+     * @brief end the protocol (back to the setpoint when running again)
+     */
+    void stopProtocol()
+    {
+        FsegmentTimer.stop();
+        FsegmentDue = false;
+        if (protocol.status == Tprotocol::Tstatus::running || protocol.status == Tprotocol::Tstatus::paused)
+            protocol.status = Tprotocol::Tstatus::idle;
+    }
+
+    /**
+     * @brief start a segment: change speed and time the next boundary (the only timer the protocol needs)
+     */
+    void enterSegment(dtypes::uint8 _segment)
+    {
+        Fsegment = _segment;
+        FsegmentDue = false;
+        protocol.segment = _segment + 1;
+        FsegmentEnd = millis() + Fsegments[Fsegment].duration_sec * 1000;
+        FsegmentTimer.start(Fsegments[Fsegment].duration_sec * 1000);
+        if (event == Tevent::none)
+            changeSpeed(runSpeed());
+    }
+
+    /**
+     * @brief segment boundary
+     */
+    void nextSegment()
+    {
+        if (Fsegment + 1 < FsegmentsN)
+        {
+            enterSegment(Fsegment + 1);
+            return;
+        }
+        if (protocol.repeats > 0 && protocol.cycle >= protocol.repeats)
+        {
+            // all done, back to the setpoint
+            FsegmentDue = false;
+            protocol.status = Tprotocol::Tstatus::done;
+            if (event == Tevent::none)
+                changeSpeed(setpoint_rpm);
+            return;
+        }
+        protocol.cycle++;
+        enterSegment(0);
+    }
 
     // reached vortex peak?
     bool vortexPeak = false;
@@ -41,63 +187,82 @@ private:
     void changeSpeed(dtypes::uint16 _speed)
     {
         FvortexEndTimer.stop();
-        FspeedChangeTimer.stop();
         FspeedTarget = _speed;
         adjustSpeed();
     }
 
     /**
      * @brief adjust speed towards the speed target
+     * the motor ramps there on its own (jerk-limited) and reports back via its ramping flag
      */
     void adjustSpeed()
     {
 
-        if (FspeedNow == FspeedTarget)
+        if (FspeedNow == FspeedTarget && hardware().motor.ramping == enums::ToffOn::off)
         {
             // already at target, nothing to do
             return;
         }
 
-        if ((FspeedNow < FspeedTarget && settings.acceleration_rpm_s == 0) || (FspeedNow > FspeedTarget && settings.deceleration_rpm_s == 0))
+        // accelerate or decelerate from where the motor is right now (could be mid-ramp)
+        bool faster = FspeedTarget > hardware().motor.commandedSpeed_rpm();
+        dtypes::uint16 acceleration = faster ? settings.acceleration_rpm_s : settings.deceleration_rpm_s;
+        if (protocol.status == Tprotocol::Tstatus::running && FspeedTarget == runSpeed() && Fsegments[Fsegment].ramp_rpm_s > 0)
+            acceleration = Fsegments[Fsegment].ramp_rpm_s; // segment specific ramp
+        if (acceleration == 0)
         {
             // no accelerationg/decellration setting, change speed immediately
             setMotorSpeed(FspeedTarget);
             return;
         }
 
-        // change speed by the acceleration/deceleration amount
-        if (FspeedNow < FspeedTarget)
-        {
-            dtypes::uint16 change = static_cast<dtypes::uint16>(round(settings.acceleration_rpm_s * FspeedChangeInterval / 1000.));
-            if (FspeedNow + change > FspeedTarget)
-            {
-                // reached target speed
-                setMotorSpeed(FspeedTarget);
-                return;
-            }
-            // time to increase the speed
-            setMotorSpeed(FspeedNow + change);
-        }
-        else if (FspeedNow > FspeedTarget)
-        {
-            dtypes::uint16 change = static_cast<dtypes::uint16>(round(settings.deceleration_rpm_s * FspeedChangeInterval / 1000.));
-            if (FspeedNow < FspeedTarget + change)
-            {
-                // reached target speed
-                setMotorSpeed(FspeedTarget);
-                return;
-            }
-            // time to decrease the speed
-            setMotorSpeed(FspeedNow - change);
-        }
+        // ramp to the target speed
+        hardware().motor.ramp(FspeedTarget, acceleration, settings.jerk_rpm_s2);
+
         // check for issues
         if (hardware().motor.error != Thardware::TmotorError::none)
         {
             return; // there are motor errors
         }
 
-        // there's more to do, start timer
-        FspeedChangeTimer.start(FspeedChangeInterval);
+        // still ramping?
+        FrampPending = hardware().motor.ramping == enums::ToffOn::on;
+        if (!FrampPending)
+        {
+            // nothing to ramp, already there
+            FspeedNow = FspeedTarget;
+            updateStatus();
+        }
+        else if (faster && status != Tstatus::accelerating)
+            status = Tstatus::accelerating;
+        else if (!faster && status != Tstatus::decelerating)
+            status = Tstatus::decelerating;
+    }
+
+    /**
+     * @brief stir bar decoupled: ramp down to the recovery speed to let the magnet catch the bar again,
+     * hold, and then ramp back up (gives up after too many recoveries in a row)
+     */
+    void recoverCoupling()
+    {
+        FrecoveryStreak = (FrecoveryStreak > 0 && millis() - FlastRecovery < FrecoveryWindow) ? FrecoveryStreak + 1 : 1;
+        FlastRecovery = millis();
+        recoveries++;
+        if (error != Thardware::TmotorError::decoupled)
+            error = Thardware::TmotorError::decoupled;
+        FvortexEndTimer.stop();
+        FrecoveryTimer.stop();
+        if (FrecoveryStreak > settings.maxRecoveries)
+        {
+            // does not recover, stay slow and flag it
+            if (event != Tevent::none)
+                event = Tevent::none;
+            setMotorSpeed(settings.recoverySpeed_rpm);
+            status = Tstatus::error;
+            return;
+        }
+        event = Tevent::recovering;
+        changeSpeed(settings.recoverySpeed_rpm);
     }
 
     /**
@@ -105,7 +270,8 @@ private:
      */
     void setMotorSpeed(dtypes::uint16 _speed)
     {
-        // tell the hardware the speed
+        // tell the hardware the speed (takes over from any ramp)
+        FrampPending = false;
         hardware().motor.targetSpeed_rpm = _speed;
 
         // check for issues
@@ -117,6 +283,14 @@ private:
 
         // update speed info
         FspeedNow = _speed;
+        updateStatus();
+    }
+
+    /**
+     * @brief update status and events from the current speed
+     */
+    void updateStatus()
+    {
         if (FspeedNow == FspeedTarget)
         {
             // reached target
@@ -141,6 +315,20 @@ private:
                 // pausing is done
                 event = Tevent::none;
             }
+            else if (event == Tevent::recovering)
+            {
+                if (FspeedTarget == settings.recoverySpeed_rpm && FspeedTarget != runSpeed())
+                {
+                    // down at the recovery speed, hold before ramping back up
+                    FrecoveryTimer.start(settings.recoveryHold_sec * 1000);
+                }
+                else
+                {
+                    // back up at the setpoint
+                    event = Tevent::none;
+                    error = Thardware::TmotorError::none;
+                }
+            }
         }
         else if (FspeedNow < FspeedTarget)
         {
@@ -172,19 +360,41 @@ public:
     // stir events
     sdds_var(Tevent, event, sdds::opt::readonly, Tevent::none);
 
+    // stir bar decoupling recoveries
+    sdds_var(Tuint32, recoveries, sdds::opt::readonly, 0);
+
     // speed details
     sdds_var(Tuint16, setpoint_rpm, sdds::opt::saveval, 500);
     sdds_var(Tuint16, speed_rpm, sdds::opt::readonly);
 
+    // agitation protocol: repeating (speed, duration, ramp) segments instead of the constant setpoint
+    class Tprotocol : public TmenuHandle
+    {
+    public:
+        sdds_enum(idle, running, paused, done) Tstatus;
+        sdds_var(enums::ToffOn, enabled, sdds::opt::saveval, enums::ToffOn::off);
+        sdds_var(Tstring, segments, sdds::opt::saveval);           // rpm:sec[:ramp_rpm_s],... e.g. 1500:30,0:300,3000:3
+        sdds_var(Tuint16, repeats, sdds::opt::saveval, 0);         // 0 = forever
+        sdds_var(Tuint8, segmentsN, sdds::opt::readonly, 0);       // valid segments (0 = none or not valid)
+        sdds_var(Tstatus, status, sdds::opt::readonly);
+        sdds_var(Tuint8, segment, sdds::opt::readonly, 0);
+        sdds_var(Tuint16, cycle, sdds::opt::readonly, 0);
+    };
+    sdds_var(Tprotocol, protocol);
+
     // additional settings
     class Tsettings : public TmenuHandle
     {
     public:
         sdds_var(Tuint16, acceleration_rpm_s, sdds::opt::saveval, 500);  // rpm/second
         sdds_var(Tuint16, deceleration_rpm_s, sdds::opt::saveval, 3000); // rpm/second
+        sdds_var(Tuint16, jerk_rpm_s2, sdds::opt::saveval, 2000);        // rpm/second^2 (0 = linear ramps)
         sdds_var(Tuint16, maxSpeed_rpm, sdds::opt::saveval, hardware().motor.maxSpeed_rpm);
         sdds_var(Tuint16, vortexSpeed_rpm, sdds::opt::saveval, 3000);
         sdds_var(Tuint16, vortexTime_sec, sdds::opt::saveval, 2);
+        sdds_var(Tuint16, recoverySpeed_rpm, sdds::opt::saveval, 200); // ramp down to this speed when the stir bar decouples
+        sdds_var(Tuint16, recoveryHold_sec, sdds::opt::saveval, 5);
+        sdds_var(Tuint8, maxRecoveries, sdds::opt::saveval, 3); // in a row before giving up
     };
     sdds_var(Tsettings, settings);
 
@@ -198,24 +408,40 @@ public:
         // action events
         on(action)
         {
+            if (action != Taction::___ && error == Thardware::TmotorError::decoupled)
+            {
+                // user takes over from the decoupling recovery
+                FrecoveryTimer.stop();
+                FrecoveryStreak = 0;
+                if (event == Tevent::recovering)
+                    event = Tevent::none;
+                error = Thardware::TmotorError::none;
+            }
             if (action == Taction::start)
             {
                 state = enums::ToffOn::on;
                 event = Tevent::none;
-                changeSpeed(setpoint_rpm);
+                run();
             }
             else if (action == Taction::stop)
             {
                 state = enums::ToffOn::off;
                 event = Tevent::none;
+                stopProtocol();
                 changeSpeed(0);
             }
             else if (action == Taction::pause)
             {
                 if (state == enums::ToffOn::on)
                 {
-                    // no state change but stopping the motor
+                    // no state change but stopping the motor (and the protocol clock)
                     event = Tevent::paused;
+                    if (protocol.status == Tprotocol::Tstatus::running)
+                    {
+                        FsegmentLeft = (FsegmentDue || FsegmentEnd <= millis()) ? 0 : FsegmentEnd - millis();
+                        FsegmentTimer.stop();
+                        protocol.status = Tprotocol::Tstatus::paused;
+                    }
                     changeSpeed(0);
                 }
             }
@@ -223,8 +449,16 @@ public:
             {
                 if (state == enums::ToffOn::on)
                 {
-                    // no state change but restarting the motor
-                    changeSpeed(setpoint_rpm);
+                    // no state change but restarting the motor (and the protocol clock)
+                    if (protocol.status == Tprotocol::Tstatus::paused)
+                    {
+                        protocol.status = Tprotocol::Tstatus::running;
+                        FsegmentEnd = millis() + FsegmentLeft;
+                        FsegmentTimer.start(FsegmentLeft);
+                    }
+                    if (event == Tevent::paused && runSpeed() == 0)
+                        event = Tevent::none; // nothing to spin back up to
+                    changeSpeed(runSpeed());
                 }
             }
             else if (action == Taction::vortex)
@@ -238,11 +472,55 @@ public:
                 action = Taction::___;
         };
 
+        // recovery hold done --> back up to the setpoint
+        on(FrecoveryTimer)
+        {
+            (state == enums::ToffOn::on) ? changeSpeed(runSpeed()) : changeSpeed(0);
+        };
+
         // vortex end timer
         on(FvortexEndTimer)
         {
             // resume where we were before the vortex
-            (state == enums::ToffOn::on) ? changeSpeed(setpoint_rpm) : changeSpeed(0);
+            (state == enums::ToffOn::on) ? changeSpeed(runSpeed()) : changeSpeed(0);
+        };
+
+        // protocol segment boundary
+        on(FsegmentTimer)
+        {
+            if (Fheld || event != Tevent::none)
+            {
+                // wait for the hold/event to end
+                FsegmentDue = true;
+                return;
+            }
+            nextSegment();
+        };
+
+        // catch up on a segment boundary that came up during an event
+        on(event)
+        {
+            if (event == Tevent::none && FsegmentDue && !Fheld && protocol.status == Tprotocol::Tstatus::running)
+                nextSegment();
+        };
+
+        // protocol segments
+        on(protocol.segments)
+        {
+            dtypes::uint8 n = parseSegments(protocol.segments.c_str());
+            if (protocol.segmentsN != n)
+                protocol.segmentsN = n;
+            FsegmentsN = n;
+            // restart with the new segments (or back to the setpoint if there are none)
+            if (protocolRunning() && state == enums::ToffOn::on && event == Tevent::none)
+                run();
+        };
+
+        // switching between protocol and constant setpoint
+        on(protocol.enabled)
+        {
+            if (state == enums::ToffOn::on && event == Tevent::none)
+                run();
         };
 
         // update speed from hardware
@@ -265,7 +543,12 @@ public:
         // update motor error from hardware
         on(hardware().motor.error)
         {
-            if (hardware().motor.error != Thardware::TmotorError::none)
+            if (hardware().motor.error == Thardware::TmotorError::decoupled)
+            {
+                // stir bar lost, try to catch it again
+                recoverCoupling();
+            }
+            else if (hardware().motor.error != Thardware::TmotorError::none)
             {
                 // error, stop operations
                 if (error != hardware().motor.error)
@@ -275,13 +558,12 @@ public:
                 if (event != Tevent::none)
                     event = Tevent::none;
                 FvortexEndTimer.stop();
-                FspeedChangeTimer.stop();
                 // set to min speed so it keeps checking for connectivity
                 // but also does not speed up too fast when error resolves
                 FspeedNow = hardware().motor.minSpeed_rpm;
                 setMotorSpeed(FspeedNow);
             }
-            else if (error != Thardware::TmotorError::none)
+            else if (error != Thardware::TmotorError::none && error != Thardware::TmotorError::decoupled)
             {
                 // no error anymore --> resume state (this is in case errors not related to device connection get resolved)
                 error = Thardware::TmotorError::none;
@@ -294,9 +576,9 @@ public:
         {
             if (setpoint_rpm > settings.maxSpeed_rpm)
                 setpoint_rpm = settings.maxSpeed_rpm;
-            if (state == enums::ToffOn::on && event == Tevent::none)
+            if (state == enums::ToffOn::on && event == Tevent::none && !protocolRunning())
             {
-                // don't adjust if we're off, paused or vortexing
+                // don't adjust if we're off, paused, vortexing or running a protocol
                 changeSpeed(setpoint_rpm);
             }
         };
@@ -330,13 +612,37 @@ public:
             }
         };
 
-        // on speed change timer
-        on(FspeedChangeTimer)
+        // motor ramp done
+        on(hardware().motor.ramping)
         {
-            adjustSpeed();
+            // (the motor clamps the target to its speed range)
+            if (FrampPending && hardware().motor.ramping == enums::ToffOn::off && hardware().motor.targetSpeed_rpm == hardware().motor.clampSpeed(FspeedTarget))
+            {
+                // reached target speed
+                FrampPending = false;
+                FspeedNow = FspeedTarget;
+                updateStatus();
+            }
         };
     }
 
+    /**
+     * @brief hold protocol segment boundaries (e.g. while reading OD), a boundary that came up during the hold
+     * is taken when the hold ends
+     */
+    void hold(bool _hold)
+    {
+        Fheld = _hold;
+        if (!Fheld && FsegmentDue && event == Tevent::none && protocol.status == Tprotocol::Tstatus::running)
+            nextSegment();
+    }
+
+    // is the speed ramping?
+    bool isRamping()
+    {
+        return status == Tstatus::accelerating || status == Tstatus::decelerating;
+    }
+
     // pause state if disconnected
     void pauseState()
     {
@@ -350,7 +656,7 @@ public:
             // should be on but is not
             if (status == Tstatus::error)
                 status = Tstatus::off; // reset from error
-            changeSpeed(setpoint_rpm);
+            run();
         }
         else if (state == enums::ToffOn::off && status != Tstatus::off)
         {
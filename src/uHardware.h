@@ -150,6 +150,7 @@ public:
     decltype(expander.action) &beamAction = expander.action;
     decltype(expander.pin1) &beamState = expander.pin1;
     decltype(expander.value1) &beamValue = expander.value1;
+    decltype(expander.switchLatency_us) &beamLatency_us = expander.switchLatency_us;
 
     decltype(dimmer.action) &fanLightAction = dimmer.action;
     decltype(dimmer.error) &fanLightError = dimmer.error;
@@ -269,32 +270,31 @@ public:
         {
             // beam off
             beamState = TbeamState::OUTPUT_OFF;
-            beamAction = Ti2cAction::write;
+            expander.writeOutputs();
         }
         else if (_state == enums::ToffOn::on && beamValue != TbeamValue::ON)
         {
             // beam on
             beamState = TbeamState::OUTPUT_ON;
-            beamAction = Ti2cAction::write;
+            expander.writeOutputs();
         }
     }
 
-    // set light by percentage
-    void setLight(enums::ToffOn::e _state, uint8_t _percent = 100)
+    // stage light by percentage (written with the next fan/light write), true if anything changed
+    bool stageLight(enums::ToffOn::e _state, uint8_t _percent = 100)
     {
-
         if ((_state == enums::ToffOn::off || _percent == 0) && lightValue != TlightValue::OFF)
         {
             // full off
             lightState = enums::ToffOn::off;
-            fanLightAction = Ti2cAction::write;
+            return true;
         }
         else if (_state == enums::ToffOn::on && _percent == 100 && lightValue != TlightValue::ON)
         {
             // full on
             lightState = enums::ToffOn::on;
             lightSetpoint = ThardwarePwmPCA9633::MAX;
-            fanLightAction = Ti2cAction::write;
+            return true;
         }
         else if (_state == enums::ToffOn::on && _percent < 100)
         {
@@ -304,28 +304,90 @@ public:
             {
                 lightState = enums::ToffOn::on;
                 lightSetpoint = setpoint;
-                fanLightAction = Ti2cAction::write;
+                return true;
             }
         }
+        return false;
     }
 
-    // set fan
-    void setFan(enums::ToffOn::e _state)
+    // stage light pulses with the dimmer's group blinking (_period_ms = 0 for steady light), true if anything changed
+    bool stageLightPulse(uint16_t _period_ms, uint8_t _duty_percent = 50)
     {
+        uint8_t blink = (_period_ms > 0) ? (dimmer.blink | 0x01) : (dimmer.blink & ~0x01); // light is channel 1
+        dtypes::uint8 duty = static_cast<dtypes::uint8>(round(static_cast<dtypes::float32>(_duty_percent) * ThardwarePwmPCA9633::MAX / 100.));
+        if (dimmer.blink != blink || dimmer.blinkPeriod_ms != _period_ms || dimmer.blinkDuty != duty)
+        {
+            dimmer.blink = blink;
+            dimmer.blinkPeriod_ms = _period_ms;
+            dimmer.blinkDuty = duty;
+            return true;
+        }
+        return false;
+    }
 
-        if (_state == enums::ToffOn::off && fanValue != TfanValue::OFF)
+    // stage fan by percentage, true if anything changed
+    bool stageFan(enums::ToffOn::e _state, uint8_t _percent = 100)
+    {
+        if ((_state == enums::ToffOn::off || _percent == 0) && fanValue != TfanValue::OFF)
         {
             // fan off
             fanState = enums::ToffOn::off;
-            fanLightAction = Ti2cAction::write;
+            return true;
         }
-        else if (_state == enums::ToffOn::on && fanValue != TfanValue::ON)
+        else if (_state == enums::ToffOn::on && _percent >= 100 && fanValue != TfanValue::ON)
         {
             // full on
             fanState = enums::ToffOn::on;
             fanSetpoint = ThardwarePwmPCA9633::MAX;
-            fanLightAction = Ti2cAction::write;
+            return true;
         }
+        else if (_state == enums::ToffOn::on && _percent > 0 && _percent < 100)
+        {
+            // dimmed
+            dtypes::uint8 setpoint = static_cast<dtypes::uint8>(round(static_cast<dtypes::float32>(_percent) * ThardwarePwmPCA9633::MAX / 100.));
+            if (fanValue != TfanValue::DIMMED || fanSetpoint != setpoint)
+            {
+                fanState = enums::ToffOn::on;
+                fanSetpoint = setpoint;
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // set light by percentage
+    void setLight(enums::ToffOn::e _state, uint8_t _percent = 100)
+    {
+        if (stageLight(_state, _percent))
+            fanLightAction = Ti2cAction::write;
+    }
+
+    // pulse light with the dimmer's group blinking (_period_ms = 0 for steady light)
+    void setLightPulse(uint16_t _period_ms, uint8_t _duty_percent = 50)
+    {
+        if (stageLightPulse(_period_ms, _duty_percent))
+            fanLightAction = Ti2cAction::write;
+    }
+
+    // set fan by percentage
+    void setFan(enums::ToffOn::e _state, uint8_t _percent = 100)
+    {
+        if (stageFan(_state, _percent))
+            fanLightAction = Ti2cAction::write;
+    }
+
+    /**
+     * @brief set light (with pulses) and fan together
+     * the dimmer writes everything that changed in a single register range transaction
+     */
+    void setFanLight(enums::ToffOn::e _lightState, uint8_t _lightPercent, uint16_t _pulsePeriod_ms, uint8_t _pulseDuty_percent,
+                     enums::ToffOn::e _fanState, uint8_t _fanPercent)
+    {
+        bool changed = stageLightPulse(_pulsePeriod_ms, _pulseDuty_percent);
+        changed = stageLight(_lightState, _lightPercent) || changed;
+        changed = stageFan(_fanState, _fanPercent) || changed;
+        if (changed)
+            fanLightAction = Ti2cAction::write;
     }
 
     // whether to record signal
@@ -374,6 +436,9 @@ public:
             pcbVersions.controller = version + 1;
         };
 
+        // shared i2c bus stats
+        addDescr(i2cBus());
+
         // turn the gpio expander connection autocheck on to keep track of device connection
         expander.autoConnect = enums::ToffOn::on;
         beamState = TioMode::OUTPUT_OFF; // beam LED
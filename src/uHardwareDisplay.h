@@ -52,6 +52,14 @@ public:
         FiconXpadding = 0;
     }
 
+    // clear a band of the display (the icons start over if it includes them)
+    void clearRegion(uint16_t _y, uint16_t _h)
+    {
+        fillRect(0, _y, width(), _h, 0);
+        if (_y <= iconsY)
+            FiconXpadding = 0;
+    }
+
 private:
     // icon x padding
     uint8_t FiconXpadding = 0;
@@ -61,12 +69,14 @@ private:
     virtual void splash() override
     {
         printBitmap(height() / 2, splash1_data, splash1_width, splash1_height, align::CENTER, valign::CENTER);
-        printLine(line5Y, "version " + String(Fversion / 10000) + "." + String((Fversion % 10000) / 100) + "." + String(Fversion % 100), align::CENTER);
+        printLinef(line5Y, align::CENTER, "version %d.%d.%d", Fversion / 10000, (Fversion % 10000) / 100, Fversion % 100);
     }
 
 public:
-    // display refresh rate
+    // display refresh: redrawn when what it shows changes (at most every minRefresh_ms),
+    // countdowns are refreshed every refresh_ms
     sdds_var(Tuint32, refresh_ms, sdds::opt::saveval, 1000);
+    sdds_var(Tuint32, minRefresh_ms, sdds::opt::saveval, 250);
 
     // initialize 128x64 oled display with width, height, reset pin, and lower clock speed
     // (screen does not get messed up as often at 100kHz instead of the 400kHz default)
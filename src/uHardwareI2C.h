@@ -4,13 +4,24 @@
  * Takes care of Wire.begin() and generally connectivity.
  * Definese 3 error codes for use in derived classes: failedRed, failedWrite, failedCheck
  * failedRed and failedWrite will disconnect the bus
+ * Keeps a register shadow so derived classes can skip redundant writes and read-backs.
+ * Failed transactions of connected devices are retried (bounded, with jittered backoff and bus recovery)
+ * before the error is reported and the device disconnects.
+ * Presence checks (autoConnect) are scheduled for all devices by the bus supervisor.
+ * Each device sets its preferred bus clock (clock_kHz), the shared Wire clock is switched as needed.
+ * All transactions go through transmit()/request() which feed the per-device telemetry (latency histogram, errors by code, bus time).
  */
 #pragma once
 
 #include "uTypedef.h"
+#include "uRunningStats.h"
 #include "enums.h"
 #include "Particle.h"
 
+// shared bus (defined below)
+class ThardwareI2Cbus;
+ThardwareI2Cbus &i2cBus();
+
 /**
  * @brief basic I2C class --> override write/read in derived classes and trigger all actions with action = Taction::connect/write/read/disconnect/reset
  */
@@ -18,15 +29,28 @@
 // @brief: override
 class ThardwareI2C : public TmenuHandle
 {
+    // the bus collects shared clock switch statistics
+    friend class ThardwareI2Cbus;
 
 public:
     // enumerations
     sdds_enum(___, connect, disconnect, read, write, reset) Taction;
     sdds_enum(none, damagedI2CBus, failedConnect, failedRed, failedWrite, failedReset) Terror;
+    sdds_enum(always, periodic, onError) Tverify; // when to read back written registers
+    sdds_enum(___, success, failed) Toutcome;      // outcome of a queued action
+
+    // priority of queued actions on the shared bus (URGENT runs first)
+    enum class Priority
+    {
+        URGENT,    // beam and gain
+        NORMAL,    // sensors and other peripherals
+        BACKGROUND // display
+    };
 
 private:
     // global Wire initialization
     static bool FwireInitialized; // shared across ALL instances & derived classes
+    static dtypes::uint16 FbusClock_kHz; // current Wire clock (shared)
     static void initializeWire()
     {
         if (!FwireInitialized)
@@ -39,8 +63,10 @@ private:
     // how long should it maximally take to get an answer from the I2C [in ms]
     uint16_t i2cMaxResponseTime = 200;
 
-    // connection activity and checks
-    Ttimer FautoConnectTimer;
+    // connection activity and checks (scheduled by the bus supervisor, see supervise())
+    dtypes::uint32 FlastSuccess_ms = 0;
+    bool FactionSucceeded = false; // outcome of the last action (for the bus pump)
+    dtypes::uint32 FlastCheck_ms = 0;
 
     /**
      * @brief checks if there is a connection to the I2C device
@@ -51,41 +77,53 @@ private:
         if (!Finitialized)
             return false;
 
-        // lock for thread safety
-        WITH_LOCK(Wire)
+        // empty transmission to probe the device
+        unsigned long requestStart = millis();
+        uint8_t transmitCode = transmit(nullptr, 0);
+        if (transmitCode == SYSTEM_ERROR_NONE)
         {
-            unsigned long requestStart = millis();
-            Wire.beginTransmission(Fi2cAddress);
-            uint8_t transmitCode = Wire.endTransmission();
-            if (transmitCode == SYSTEM_ERROR_NONE)
-            {
-                // success
-                if (status != enums::TconStatus::connected)
-                {
-                    connections++;
-                    status = enums::TconStatus::connected;
-                }
-                return true;
-            }
-            else if (millis() - requestStart > i2cMaxResponseTime)
-            {
-                // special case: response took so long the I2C is likely broken
-                Log.trace("timed out when trying connect to I2C device at 0x%x (there is likely a bigger issue with the I2C bus) - error code %d", Fi2cAddress, transmitCode);
-                if (error != Terror::damagedI2CBus)
-                    error = Terror::damagedI2CBus;
-            }
-            else
+            // success
+            if (status != enums::TconStatus::connected)
             {
-                // connection failed for some other reason
-                // error codes: https://docs.particle.io/reference/device-os/api/wire-i2c/endtransmission/
-                Log.trace("could not connect to I2C device at 0x%x - error code %d", Fi2cAddress, transmitCode);
-                if (error != Terror::failedConnect)
-                    error = Terror::failedConnect;
+                connections++;
+                status = enums::TconStatus::connected;
             }
+            return true;
+        }
+        else if (millis() - requestStart > i2cMaxResponseTime)
+        {
+            // special case: response took so long the I2C is likely broken
+            Log.trace("timed out when trying connect to I2C device at 0x%x (there is likely a bigger issue with the I2C bus) - error code %d", Fi2cAddress, transmitCode);
+            if (error != Terror::damagedI2CBus)
+                error = Terror::damagedI2CBus;
+        }
+        else
+        {
+            // connection failed for some other reason
+            // error codes: https://docs.particle.io/reference/device-os/api/wire-i2c/endtransmission/
+            Log.trace("could not connect to I2C device at 0x%x - error code %d", Fi2cAddress, transmitCode);
+            if (error != Terror::failedConnect)
+                error = Terror::failedConnect;
         }
         return false;
     }
 
+    // telemetry: latency histogram bucket upper limits (in micro seconds, last bucket is open ended)
+    static constexpr uint8_t FlatencyBucketsN = 8;
+    static constexpr dtypes::uint32 FlatencyBuckets_us[FlatencyBucketsN - 1] = {100, 250, 500, 1000, 2000, 5000, 10000};
+
+    // telemetry: counters are kept in plain variables, per window, and start over when the window closes
+    struct TtelemetryWindow
+    {
+        dtypes::uint32 histogram[FlatencyBucketsN];
+        dtypes::uint32 errorCodes[6]; // busy, start, address, data, short read, other
+        dtypes::uint32 transactions;
+        dtypes::uint32 maxLatency_us;
+        dtypes::uint32 busy_us;
+    };
+    TtelemetryWindow Fsecond = {};  // copied to the sdds vars once per second (closeTelemetryWindow)
+    TtelemetryWindow Fsummary = {}; // since the last summary (summarize)
+
     // read from I2C device
     virtual bool read()
     {
@@ -122,6 +160,287 @@ protected:
     uint8_t Fi2cAddress;
     bool Finitialized = false;
 
+    // priority on the shared bus queue (derived classes set their own)
+    Priority Fpriority = Priority::NORMAL;
+
+    // clock switches (shared, collected by the bus once per second)
+    static dtypes::uint32 FclockSwitches;
+    static dtypes::uint32 FclockSwitch_us;
+
+    /**
+     * @brief switch the shared Wire clock (call with the Wire lock held), the switch is not counted
+     * Device OS only applies Wire.setSpeed() in Wire.begin(), so a switch restarts the peripheral.
+     * Device OS supports 100 and 400 kHz, Fast-mode Plus (1 MHz) is not available.
+     * @return true if the clock was switched, _switch_us is the time it took
+     */
+    static bool switchClock(dtypes::uint16 _clock_kHz, dtypes::uint32 &_switch_us)
+    {
+        dtypes::uint16 kHz = (_clock_kHz >= 400) ? 400 : 100;
+        if (kHz == FbusClock_kHz)
+            return false;
+        dtypes::uint32 start = micros();
+        Wire.end();
+        Wire.setSpeed(kHz == 400 ? CLOCK_SPEED_400KHZ : CLOCK_SPEED_100KHZ);
+        Wire.begin();
+        FbusClock_kHz = kHz;
+        _switch_us = micros() - start;
+        return true;
+    }
+
+    /**
+     * @brief switch the shared Wire clock to this device's clock_kHz (call with the Wire lock held, main loop only)
+     */
+    void useClock()
+    {
+        dtypes::uint32 switch_us = 0;
+        if (switchClock(clock_kHz, switch_us))
+        {
+            FclockSwitches++;
+            FclockSwitch_us += switch_us;
+        }
+    }
+
+    /**
+     * @brief write bytes to the device in a single transaction (no bytes = connection probe)
+     * retries according to the retry policy (see retry())
+     * @return error code from Wire.endTransmission()
+     */
+    uint8_t transmit(const uint8_t *_bytes, uint8_t _n)
+    {
+        uint8_t transmitCode;
+        for (uint8_t attempt = 1;; attempt++)
+        {
+            dtypes::uint32 start = micros();
+            // lock for thread safety
+            WITH_LOCK(Wire)
+            {
+                useClock();
+                Wire.beginTransmission(Fi2cAddress);
+                for (uint8_t i = 0; i < _n; i++)
+                    Wire.write(_bytes[i]);
+                transmitCode = Wire.endTransmission();
+#ifdef I2C_FAULT_INJECTION
+                transmitCode = injectFault(transmitCode, nullptr, 0);
+#endif
+            }
+            record(transmitCode, micros() - start);
+            if (!retry(transmitCode, attempt))
+                break;
+        }
+        return transmitCode;
+    }
+
+    /**
+     * @brief write command bytes (e.g. a register pointer, can be none) and then read bytes from the device
+     * retries according to the retry policy (see retry())
+     * @return error code from Wire.endTransmission() or custom error code 0xff if not the expected number of bytes
+     */
+    uint8_t request(const uint8_t *_cmd, uint8_t _cmdN, uint8_t *_bytes, uint8_t _n)
+    {
+        uint8_t transmitCode;
+        for (uint8_t attempt = 1;; attempt++)
+        {
+            transmitCode = SYSTEM_ERROR_NONE;
+            dtypes::uint32 start = micros();
+            // lock for thread safety
+            WITH_LOCK(Wire)
+            {
+                useClock();
+                if (_cmdN > 0)
+                {
+                    Wire.beginTransmission(Fi2cAddress);
+                    for (uint8_t i = 0; i < _cmdN; i++)
+                        Wire.write(_cmd[i]);
+                    // false = keep connection alive instead of stop
+                    transmitCode = Wire.endTransmission(false);
+                }
+
+                // if it worked, request the data
+                if (transmitCode == SYSTEM_ERROR_NONE)
+                {
+                    uint8_t received = Wire.requestFrom(Fi2cAddress, _n);
+                    for (uint8_t i = 0; i < _n && transmitCode == SYSTEM_ERROR_NONE; i++)
+                    {
+                        if (received != _n || !Wire.available())
+                            transmitCode = 0xff; // custom error: did not receive the expected number of bytes
+                        else
+                            _bytes[i] = Wire.read();
+                    }
+                }
+#ifdef I2C_FAULT_INJECTION
+                transmitCode = injectFault(transmitCode, _bytes, _n);
+#endif
+            }
+            record(transmitCode, micros() - start);
+            if (!retry(transmitCode, attempt))
+                break;
+        }
+        return transmitCode;
+    }
+
+    /**
+     * @brief retry policy: decides whether a failed attempt should be repeated
+     * Only connected devices retry (connection attempts and probes for absent devices fail fast).
+     * Bus-level failures (busy / start / stop timeouts) first try to recover the bus from a stuck SDA.
+     * Waits with exponential backoff plus random jitter before the next attempt.
+     */
+    bool retry(uint8_t _transmitCode, uint8_t _attempt)
+    {
+        if (_transmitCode == SYSTEM_ERROR_NONE || status != enums::TconStatus::connected || _attempt >= maxAttempts)
+            return false;
+
+        // bus level failure?
+        if (_transmitCode == 1 || _transmitCode == 2 || _transmitCode == 5 || _transmitCode == 6)
+        {
+            if (recoverBus())
+                recoveries++;
+        }
+
+        // backoff with jitter
+        dtypes::uint32 backoff = static_cast<dtypes::uint32>(retryBackoff_us) << (_attempt - 1);
+        if (backoff > FmaxBackoff_us)
+            backoff = FmaxBackoff_us;
+        delayMicroseconds(backoff + random(backoff + 1));
+        retries++;
+        return true;
+    }
+
+    // upper limit for a single backoff (blocking, so keep short)
+    static constexpr dtypes::uint32 FmaxBackoff_us = 5000;
+
+    // run the shared bus recovery (defined below the bus)
+    bool recoverBus();
+
+#ifdef I2C_FAULT_INJECTION
+    // apply the bus fault injection settings to a transaction (defined below the bus)
+    uint8_t injectFault(uint8_t _transmitCode, uint8_t *_bytes, uint8_t _n);
+#endif
+
+    /**
+     * @brief record a transaction in the telemetry (for transactions that don't go through transmit/request)
+     */
+    void record(uint8_t _transmitCode, dtypes::uint32 _duration_us)
+    {
+        // latency bucket
+        uint8_t bucket = 0;
+        while (bucket < FlatencyBucketsN - 1 && _duration_us >= FlatencyBuckets_us[bucket])
+            bucket++;
+
+        // error breakdown
+        int8_t code = -1;
+        if (_transmitCode == 1 || _transmitCode == 5 || _transmitCode == 6)
+            code = 0; // bus busy / stop bit timeouts
+        else if (_transmitCode == 2)
+            code = 1; // start bit timeout
+        else if (_transmitCode == 3)
+            code = 2; // address not acknowledged
+        else if (_transmitCode == 4)
+            code = 3; // data not acknowledged
+        else if (_transmitCode == 0xff)
+            code = 4; // short read
+        else if (_transmitCode != SYSTEM_ERROR_NONE)
+            code = 5; // anything else
+
+        if (_transmitCode == SYSTEM_ERROR_NONE)
+            FlastSuccess_ms = millis();
+        for (TtelemetryWindow *window : {&Fsecond, &Fsummary})
+        {
+            window->histogram[bucket]++;
+            window->transactions++;
+            window->busy_us += _duration_us;
+            if (_duration_us > window->maxLatency_us)
+                window->maxLatency_us = _duration_us;
+            if (code >= 0)
+                window->errorCodes[code]++;
+        }
+    }
+
+    // register shadow: last-known-good register contents
+    // (invalidated whenever the connection status changes or there is an error)
+    static constexpr uint8_t FshadowSize = 16;
+    uint8_t Fshadow[FshadowSize];
+    uint16_t FshadowValid = 0;      // bit mask of the registers with known content
+    uint8_t FwritesSinceVerify = 0;   // for periodic verification
+    uint16_t FverifyPending = 0xffff; // bit mask of the registers that must be read back (after connect or error)
+
+    // does the shadow already hold this register value?
+    bool isShadowed(uint8_t _register, uint8_t _value)
+    {
+        return _register < FshadowSize && ((FshadowValid >> _register) & 0x01) && Fshadow[_register] == _value;
+    }
+
+    // update the shadow after a successful write/read
+    void setShadow(uint8_t _register, uint8_t _value)
+    {
+        if (_register >= FshadowSize)
+            return;
+        Fshadow[_register] = _value;
+        FshadowValid |= (1 << _register);
+    }
+
+    // forget all register contents
+    void clearShadow()
+    {
+        FshadowValid = 0;
+        FverifyPending = 0xffff;
+    }
+
+    /**
+     * @brief find the range of registers that differs from the shadow
+     * @return false if all registers already hold the values
+     */
+    bool changedRange(uint8_t _first, uint8_t _n, const uint8_t *_values, uint8_t *_from, uint8_t *_to)
+    {
+        bool changed = false;
+        for (uint8_t i = 0; i < _n; i++)
+        {
+            if (!isShadowed(_first + i, _values[i]))
+            {
+                if (!changed)
+                    *_from = _first + i;
+                *_to = _first + i;
+                changed = true;
+            }
+        }
+        return changed;
+    }
+
+    // bit mask of a register range (for verifyDue() and verified())
+    static uint16_t registerMask(uint8_t _first, uint8_t _n = 1)
+    {
+        uint16_t mask = 0;
+        for (uint8_t i = _first; i < _first + _n && i < FshadowSize; i++)
+            mask |= (1 << i);
+        return mask;
+    }
+
+    /**
+     * @brief should the registers of this device write be read back to verify them? (based on the verify setting)
+     * call once per device write with all the registers it touches so periodic verification counts writes, not registers
+     */
+    bool verifyDue(uint16_t _registers)
+    {
+        if ((FverifyPending & _registers) || verify == Tverify::always)
+            return true;
+        if (verify == Tverify::periodic && FwritesSinceVerify + 1 >= verifyInterval)
+            return true;
+        FwritesSinceVerify++;
+        return false;
+    }
+
+    // register a successful verification of these registers
+    void verified(uint16_t _registers)
+    {
+        FwritesSinceVerify = 0;
+        FverifyPending &= ~_registers;
+    }
+
+    // count bus transactions saved by the shadow
+    void skip(uint8_t _n = 1)
+    {
+        skipped = skipped.value() + _n;
+    }
+
     // helper function to assemble register byte
     static uint8_t bitsToByte(
         bool b0, bool b1, bool b2, bool b3,
@@ -171,6 +490,43 @@ public:
     sdds_var(Tuint32, reads, sdds::opt::readonly, 0);
     sdds_var(Tuint32, resets, sdds::opt::readonly, 0);
     sdds_var(Tuint32, errors, sdds::opt::readonly, 0);
+    sdds_var(Tuint16, clock_kHz, sdds::opt::nothing, 100);         // preferred bus clock for this device (100 or 400)
+    sdds_var(Tuint8, maxAttempts, sdds::opt::nothing, 3);          // attempts per transaction before the error is reported
+    sdds_var(Tuint16, retryBackoff_us, sdds::opt::nothing, 200);   // backoff before the first retry (doubles with each retry)
+    sdds_var(Tuint32, retries, sdds::opt::readonly, 0);
+    sdds_var(Tuint32, recoveries, sdds::opt::readonly, 0);         // bus recoveries triggered by this device
+    sdds_var(Tuint32, disconnects, sdds::opt::readonly, 0);        // errors after the retry policy was exhausted
+    sdds_var(Tverify, verify, sdds::opt::nothing, Tverify::periodic);
+    sdds_var(Tuint8, verifyInterval, sdds::opt::nothing, 10); // read back every n-th write (if verify = periodic)
+    sdds_var(Tuint32, skipped, sdds::opt::readonly, 0);        // bus transactions saved by the register shadow
+    sdds_var(Toutcome, outcome, sdds::opt::readonly);           // outcome of the completed action (set right before completed)
+    sdds_var(Taction, completed, sdds::opt::readonly);          // last queued action that finished (see queue())
+
+    // bus telemetry of the last second (updated once per second by the bus)
+    class Ttelemetry : public TmenuHandle
+    {
+    public:
+        sdds_var(Tuint32, transactions, sdds::opt::readonly, 0);
+        sdds_var(Tuint32, busy_us, sdds::opt::readonly, 0); // bus time used during the last second
+        sdds_var(Tuint32, maxLatency_us, sdds::opt::readonly, 0);
+        // latency histogram (transactions per bucket)
+        sdds_var(Tuint32, lt100us, sdds::opt::readonly, 0);
+        sdds_var(Tuint32, lt250us, sdds::opt::readonly, 0);
+        sdds_var(Tuint32, lt500us, sdds::opt::readonly, 0);
+        sdds_var(Tuint32, lt1ms, sdds::opt::readonly, 0);
+        sdds_var(Tuint32, lt2ms, sdds::opt::readonly, 0);
+        sdds_var(Tuint32, lt5ms, sdds::opt::readonly, 0);
+        sdds_var(Tuint32, lt10ms, sdds::opt::readonly, 0);
+        sdds_var(Tuint32, gt10ms, sdds::opt::readonly, 0);
+        // errors by code
+        sdds_var(Tuint32, errBusy, sdds::opt::readonly, 0);
+        sdds_var(Tuint32, errStart, sdds::opt::readonly, 0);
+        sdds_var(Tuint32, errAddress, sdds::opt::readonly, 0);
+        sdds_var(Tuint32, errData, sdds::opt::readonly, 0);
+        sdds_var(Tuint32, errShortRead, sdds::opt::readonly, 0);
+        sdds_var(Tuint32, errOther, sdds::opt::readonly, 0);
+    };
+    sdds_var(Ttelemetry, telemetry);
 
     // constructor
     ThardwareI2C()
@@ -222,6 +578,7 @@ public:
                 // was the action successful?
                 if (success)
                     error = Terror::none;
+                FactionSucceeded = success;
                 action = Taction::___;
             }
         };
@@ -229,6 +586,9 @@ public:
         // connection
         on(status)
         {
+            // register contents are unknown after any connection change
+            clearShadow();
+
             // write and read the values if we're autoconnecting
             if (autoConnect == enums::ToffOn::on)
             {
@@ -239,30 +599,17 @@ public:
             }
         };
 
+        // connection checks are scheduled by the bus supervisor
         on(autoConnect)
         {
-            // start connection checks?
-            if (Finitialized && autoConnect == enums::ToffOn::on)
-            {
-                FautoConnectTimer.start(checkInterval_ms);
-            }
-            else
-            {
-                FautoConnectTimer.stop();
-            }
+            if (Finitialized)
+                wakeSupervisor();
         };
 
-        on(FautoConnectTimer)
+        on(checkInterval_ms)
         {
-            if (Finitialized && autoConnect == enums::ToffOn::on)
-            {
-                if (status == enums::TconStatus::connected)
-                    checkConnection(); // check connection
-                else
-                    action = Taction::connect; // start connection
-                // restart timer
-                FautoConnectTimer.start(checkInterval_ms);
-            }
+            if (Finitialized)
+                wakeSupervisor();
         };
 
         // error
@@ -272,8 +619,12 @@ public:
             if (error != Terror::none)
             {
                 errors++;
+                clearShadow();
                 if (status != enums::TconStatus::disconnected)
+                {
+                    disconnects++;
                     status = enums::TconStatus::disconnected;
+                }
             }
         };
     }
@@ -286,13 +637,569 @@ public:
             initializeWire();
             Fi2cAddress = _i2cAddress;
             Finitialized = true;
+            registerWithBus();
 
-            // start auto connect check timer
+            // start auto connect checks
             if (autoConnect == enums::ToffOn::on)
-                FautoConnectTimer.start(checkInterval_ms);
+                wakeSupervisor();
+        }
+    }
+
+    // supervision outcomes
+    enum class Check
+    {
+        NONE,
+        PROBED,
+        SKIPPED,
+        CONNECT
+    };
+
+    /**
+     * @brief presence supervision (called by the bus supervisor for all registered devices)
+     * connected devices are only probed if there was no successful transaction within checkInterval_ms
+     */
+    Check supervise(dtypes::uint32 _now)
+    {
+        if (!Finitialized || autoConnect != enums::ToffOn::on)
+            return Check::NONE;
+
+        if (status == enums::TconStatus::connected)
+        {
+            if (_now - FlastSuccess_ms >= checkInterval_ms)
+            {
+                // idle, check connection
+                FlastCheck_ms = _now;
+                checkConnection();
+                return Check::PROBED;
+            }
+            if (_now - FlastCheck_ms >= checkInterval_ms)
+            {
+                // a probe would have been due but there was recent traffic
+                FlastCheck_ms = _now;
+                return Check::SKIPPED;
+            }
+        }
+        else if (_now - FlastCheck_ms >= checkInterval_ms)
+        {
+            // start connection
+            FlastCheck_ms = _now;
+            action = Taction::connect;
+            return Check::CONNECT;
+        }
+        return Check::NONE;
+    }
+
+    /**
+     * @brief time until the next presence check is due
+     * @return 0 if due, UINT32_MAX if the device is not supervised
+     */
+    dtypes::uint32 checkDueIn(dtypes::uint32 _now) const
+    {
+        if (!Finitialized || autoConnect != enums::ToffOn::on)
+            return UINT32_MAX;
+        dtypes::uint32 since = _now - ((status == enums::TconStatus::connected) ? FlastSuccess_ms : FlastCheck_ms);
+        return (since >= checkInterval_ms) ? 0 : checkInterval_ms - since;
+    }
+
+    // i2c address
+    uint8_t address() const
+    {
+        return Fi2cAddress;
+    }
+
+    /**
+     * @brief close the one second telemetry window (called once per second by the bus): the telemetry vars
+     * show the last second and the next window starts from zero
+     * @return bus time used by this device during the window (in micro seconds)
+     */
+    dtypes::uint32 closeTelemetryWindow()
+    {
+        // helper to only update what changed
+        auto update = [](Tuint32 &_var, dtypes::uint32 _value)
+        {
+            if (_var != _value)
+                _var = _value;
+        };
+        update(telemetry.transactions, Fsecond.transactions);
+        update(telemetry.busy_us, Fsecond.busy_us);
+        update(telemetry.maxLatency_us, Fsecond.maxLatency_us);
+        update(telemetry.lt100us, Fsecond.histogram[0]);
+        update(telemetry.lt250us, Fsecond.histogram[1]);
+        update(telemetry.lt500us, Fsecond.histogram[2]);
+        update(telemetry.lt1ms, Fsecond.histogram[3]);
+        update(telemetry.lt2ms, Fsecond.histogram[4]);
+        update(telemetry.lt5ms, Fsecond.histogram[5]);
+        update(telemetry.lt10ms, Fsecond.histogram[6]);
+        update(telemetry.gt10ms, Fsecond.histogram[7]);
+        update(telemetry.errBusy, Fsecond.errorCodes[0]);
+        update(telemetry.errStart, Fsecond.errorCodes[1]);
+        update(telemetry.errAddress, Fsecond.errorCodes[2]);
+        update(telemetry.errData, Fsecond.errorCodes[3]);
+        update(telemetry.errShortRead, Fsecond.errorCodes[4]);
+        update(telemetry.errOther, Fsecond.errorCodes[5]);
+        dtypes::uint32 busy = Fsecond.busy_us;
+        Fsecond = TtelemetryWindow();
+        return busy;
+    }
+
+    /**
+     * @brief compact telemetry summary of the transactions since the last summary (starts the next summary window):
+     * address:transactions/errors/p90 latency bucket limit/max latency
+     * e.g. "20:1234/0/250/812" (latencies in micro seconds, p90 of 0 means above 10 ms, "-" without transactions)
+     */
+    void summarize(char *_buf, size_t _size)
+    {
+        dtypes::uint32 errs = 0;
+        for (uint8_t i = 0; i < 6; i++)
+            errs += Fsummary.errorCodes[i];
+
+        // empty window: no latency
+        if (Fsummary.transactions == 0)
+        {
+            snprintf(_buf, _size, "%02x:0/%lu/-/0", Fi2cAddress, (unsigned long)errs);
+            Fsummary = TtelemetryWindow();
+            return;
+        }
+
+        // 90th percentile bucket
+        dtypes::uint32 p90 = 0;
+        dtypes::uint32 n = 0;
+        for (uint8_t i = 0; i < FlatencyBucketsN; i++)
+        {
+            n += Fsummary.histogram[i];
+            if (n * 10 >= Fsummary.transactions * 9)
+            {
+                p90 = (i < FlatencyBucketsN - 1) ? FlatencyBuckets_us[i] : 0;
+                break;
+            }
         }
+        snprintf(_buf, _size, "%02x:%lu/%lu/%lu/%lu", Fi2cAddress, (unsigned long)Fsummary.transactions, (unsigned long)errs, (unsigned long)p90,
+                 (unsigned long)Fsummary.maxLatency_us);
+        Fsummary = TtelemetryWindow();
     }
+
+    // priority of this device's queued actions
+    Priority priority() const
+    {
+        return Fpriority;
+    }
+
+    /**
+     * @brief queue an action on the shared bus instead of running it right away
+     * the action runs from the bus pump in priority order, when it is done outcome is set and then completed
+     * (a display frame that is pushed on the worker thread succeeds once it is handed over, see ThardwareOledSSD1309)
+     * @return false if the queue is full (the action is dropped)
+     */
+    bool queue(Taction::e _action);
+
+private:
+    // register device with the shared bus (for telemetry and supervision)
+    void registerWithBus();
+
+    // (re)schedule the bus supervisor
+    void wakeSupervisor();
 };
 
 // define the static wire initialized
-bool ThardwareI2C::FwireInitialized = false;
\ No newline at end of file
+bool ThardwareI2C::FwireInitialized = false;
+dtypes::uint16 ThardwareI2C::FbusClock_kHz = 100;
+dtypes::uint32 ThardwareI2C::FclockSwitches = 0;
+dtypes::uint32 ThardwareI2C::FclockSwitch_us = 0;
+constexpr dtypes::uint32 ThardwareI2C::FlatencyBuckets_us[];
+
+/**
+ * @brief shared I2C bus
+ * Runs queued device actions in priority order from a cooperative pump (one action per
+ * task handler pass) so the events waiting between actions get their turn.
+ * Each action still runs inline and blocks the main loop until it is done: a full display
+ * frame pushed from the main loop (background off, or a frame handed back by the worker)
+ * takes about 25 ms at 400 kHz, the background display pushes run on their own thread.
+ * Actions that need an immediate result (e.g. beam and gain) can still be triggered
+ * directly with action = ... and bypass the queue.
+ */
+class ThardwareI2Cbus : public TmenuHandle
+{
+
+
+public:
+    // enumerations
+    sdds_enum(___, resetStats) Taction;
+
+private:
+    // in case it is used in a tree
+    Tmeta meta() override { return Tmeta{TYPE_ID, 0, "I2C"}; }
+
+    // queued requests
+    struct Request
+    {
+        ThardwareI2C *device;
+        ThardwareI2C::Taction::e action;
+        dtypes::uint32 queued_us;
+    };
+    static constexpr uint8_t FqueueSize = 16;
+    Request Fqueue[FqueueSize];
+    uint8_t FqueueN = 0;
+
+    // pump
+    Ttimer FpumpTimer;
+
+    // registered devices
+    static constexpr uint8_t FdevicesSize = 12;
+    ThardwareI2C *Fdevices[FdevicesSize];
+    uint8_t FdevicesN = 0;
+
+    // presence supervision
+    Ttimer FsupervisorTimer;
+    static constexpr dtypes::uint32 FminSupervisorInterval_ms = 10;
+
+    // telemetry windows
+    Ttimer FwindowTimer;
+    dtypes::uint32 FwindowCount = 0;
+
+    // latency stats
+    TrunningStats FlatencyStats;
+
+    // find the next request to run (highest priority first, first come first serve within a priority)
+    uint8_t next()
+    {
+        uint8_t idx = 0;
+        for (uint8_t i = 1; i < FqueueN; i++)
+        {
+            if (Fqueue[i].device->priority() < Fqueue[idx].device->priority())
+                idx = i;
+        }
+        return idx;
+    }
+
+public:
+    // sdds vars
+    sdds_var(Taction, action);
+    sdds_var(Tuint8, queueDepth, sdds::opt::readonly, 0);
+    sdds_var(Tuint8, maxQueueDepth, sdds::opt::readonly, 0);
+    sdds_var(Tuint32, executed, sdds::opt::readonly, 0);
+    sdds_var(Tuint32, dropped, sdds::opt::readonly, 0);
+    sdds_var(Tuint32, failed, sdds::opt::readonly, 0); // queued actions that did not succeed
+    sdds_var(Tuint32, latency_us, sdds::opt::readonly, 0); // mean time from queueing to execution
+    sdds_var(Tuint32, maxLatency_us, sdds::opt::readonly, 0);
+    sdds_var(Tuint16, busy_permille, sdds::opt::readonly, 0);          // bus utilization during the last second
+    sdds_var(Tuint16, summaryInterval_sec, sdds::opt::saveval, 3600); // how often to update the summary
+    sdds_var(Tstring, summary, sdds::opt::readonly);                   // compact per-device summary of the last summaryInterval_sec (see ThardwareI2C::summarize)
+    sdds_var(Tuint32, probes, sdds::opt::readonly, 0);                 // presence probes of idle devices
+    sdds_var(Tuint32, probesSkipped, sdds::opt::readonly, 0);          // probes skipped thanks to recent traffic
+    sdds_var(Tuint8, devicesConnected, sdds::opt::readonly, 0);
+    sdds_var(Tuint32, clockSwitches, sdds::opt::readonly, 0);          // Wire clock changes between devices
+    sdds_var(Tuint32, clockSwitch_us, sdds::opt::readonly, 0);         // mean cost of a clock change
+    sdds_var(Tuint32, busRecoveries, sdds::opt::readonly, 0);          // SCL clock-pulse recoveries
+    sdds_var(Tuint32, stuckBus, sdds::opt::readonly, 0);               // recoveries that could not release SDA
+
+#ifdef I2C_FAULT_INJECTION
+    /**
+     * @brief fault and latency injection for exercising recovery paths (compile with I2C_FAULT_INJECTION)
+     * faults are only injected into otherwise successful transactions, rates are per 1000 transactions
+     * use randomSeed() for a reproducible fault sequence
+     */
+    class TfaultInjection : public TmenuHandle
+    {
+    public:
+        sdds_var(Tuint8, address, sdds::opt::nothing, 0);             // only inject for this device (0 = all devices)
+        sdds_var(Tuint16, latency_us, sdds::opt::nothing, 0);         // added to every transaction
+        sdds_var(Tuint16, nack_permille, sdds::opt::nothing, 0);      // address not acknowledged (code 3)
+        sdds_var(Tuint16, busy_permille, sdds::opt::nothing, 0);      // bus busy (code 1, triggers recovery)
+        sdds_var(Tuint16, shortRead_permille, sdds::opt::nothing, 0); // read returns too few bytes (code 0xff)
+        sdds_var(Tuint16, bitFlip_permille, sdds::opt::nothing, 0);   // one read bit flipped (no error code)
+        sdds_var(Tuint32, injected, sdds::opt::readonly, 0);
+
+        uint8_t inject(uint8_t _i2cAddress, uint8_t _transmitCode, uint8_t *_bytes, uint8_t _n)
+        {
+            if (_transmitCode != SYSTEM_ERROR_NONE || (address != 0 && address != _i2cAddress))
+                return _transmitCode;
+
+            if (latency_us > 0)
+                delayMicroseconds(latency_us);
+
+            // pick at most one fault
+            dtypes::uint16 roll = random(1000);
+            if (roll < nack_permille)
+                _transmitCode = 3;
+            else if ((roll -= nack_permille) < busy_permille)
+                _transmitCode = 1;
+            else if ((roll -= busy_permille) < shortRead_permille && _n > 0)
+                _transmitCode = 0xff;
+            else if ((roll -= shortRead_permille) < bitFlip_permille && _n > 0)
+                _bytes[random(_n)] ^= (1 << random(8));
+            else
+                return _transmitCode;
+            injected++;
+            return _transmitCode;
+        }
+    };
+    sdds_var(TfaultInjection, faults);
+#endif
+
+    // constructor
+    ThardwareI2Cbus()
+    {
+        // presence supervision
+        on(FsupervisorTimer)
+        {
+            supervise();
+        };
+
+        // telemetry windows
+        FwindowTimer.start(1000);
+        on(FwindowTimer)
+        {
+            dtypes::uint32 busy_us = 0;
+            for (uint8_t i = 0; i < FdevicesN; i++)
+                busy_us += Fdevices[i]->closeTelemetryWindow();
+            dtypes::uint16 permille = static_cast<dtypes::uint16>(busy_us / 1000);
+            if (busy_permille != permille)
+                busy_permille = permille;
+            if (clockSwitches != ThardwareI2C::FclockSwitches)
+            {
+                clockSwitches = ThardwareI2C::FclockSwitches;
+                clockSwitch_us = ThardwareI2C::FclockSwitch_us / ThardwareI2C::FclockSwitches;
+            }
+
+            // time for a summary?
+            FwindowCount++;
+            if (summaryInterval_sec > 0 && FwindowCount >= summaryInterval_sec)
+            {
+                FwindowCount = 0;
+                updateSummary();
+            }
+            FwindowTimer.start(1000);
+        };
+
+        on(action)
+        {
+            if (action == Taction::resetStats)
+            {
+                FlatencyStats.reset();
+                maxQueueDepth = queueDepth.value();
+                latency_us = 0;
+                maxLatency_us = 0;
+            }
+            if (action != Taction::___)
+                action = Taction::___;
+        };
+
+        // run one request per pass
+        on(FpumpTimer)
+        {
+            if (FqueueN == 0)
+                return;
+
+            // take the request out of the queue
+            uint8_t idx = next();
+            Request r = Fqueue[idx];
+            for (uint8_t i = idx; i + 1 < FqueueN; i++)
+                Fqueue[i] = Fqueue[i + 1];
+            FqueueN--;
+            queueDepth = FqueueN;
+
+            // latency stats
+            dtypes::uint32 latency = micros() - r.queued_us;
+            FlatencyStats.add(latency);
+            latency_us = static_cast<dtypes::uint32>(round(FlatencyStats.mean()));
+            if (latency > maxLatency_us)
+                maxLatency_us = latency;
+
+            // run the action and report completion (the outcome first so completed handlers can check it)
+            r.device->action = r.action;
+            ThardwareI2C::Toutcome::e outcome = r.device->FactionSucceeded ? ThardwareI2C::Toutcome::success : ThardwareI2C::Toutcome::failed;
+            if (r.device->outcome != outcome)
+                r.device->outcome = outcome;
+            r.device->completed = r.action;
+            executed++;
+            if (outcome == ThardwareI2C::Toutcome::failed)
+                failed++;
+
+            // more to do?
+            if (FqueueN > 0)
+                FpumpTimer.start(0);
+        };
+    }
+
+    /**
+     * @brief recover a bus where a slave holds SDA low (e.g. after a glitch in the middle of a read)
+     * clocks SCL up to 9 times until the slave releases SDA, then generates a STOP and restarts Wire
+     * @return whether SDA was released
+     */
+    bool recover()
+    {
+        bool released;
+        WITH_LOCK(Wire)
+        {
+            Wire.end();
+            pinMode(SDA, INPUT_PULLUP);
+            pinMode(SCL, OUTPUT_OPEN_DRAIN);
+            digitalWrite(SCL, HIGH);
+            for (uint8_t i = 0; i < 9 && digitalRead(SDA) == LOW; i++)
+            {
+                digitalWrite(SCL, LOW);
+                delayMicroseconds(5);
+                digitalWrite(SCL, HIGH);
+                delayMicroseconds(5);
+            }
+            // STOP condition: SDA low to high while SCL is high
+            pinMode(SDA, OUTPUT_OPEN_DRAIN);
+            digitalWrite(SCL, LOW);
+            digitalWrite(SDA, LOW);
+            delayMicroseconds(5);
+            digitalWrite(SCL, HIGH);
+            delayMicroseconds(5);
+            digitalWrite(SDA, HIGH);
+            delayMicroseconds(5);
+            pinMode(SDA, INPUT_PULLUP);
+            released = (digitalRead(SDA) == HIGH);
+            Wire.begin();
+        }
+        busRecoveries++;
+        if (!released)
+        {
+            Log.trace("I2C bus recovery could not release SDA");
+            stuckBus++;
+        }
+        return released;
+    }
+
+    /**
+     * @brief single supervision pass over all registered devices
+     * probes only idle devices and then sleeps until the earliest next due check
+     */
+    void supervise()
+    {
+        dtypes::uint32 now = millis();
+        uint8_t connected = 0;
+        for (uint8_t i = 0; i < FdevicesN; i++)
+        {
+            ThardwareI2C::Check check = Fdevices[i]->supervise(now);
+            if (check == ThardwareI2C::Check::PROBED)
+                probes++;
+            else if (check == ThardwareI2C::Check::SKIPPED)
+                probesSkipped++;
+            if (Fdevices[i]->status == enums::TconStatus::connected)
+                connected++;
+        }
+        if (devicesConnected != connected)
+            devicesConnected = connected;
+
+        // schedule next pass
+        now = millis();
+        dtypes::uint32 next = UINT32_MAX;
+        for (uint8_t i = 0; i < FdevicesN; i++)
+        {
+            dtypes::uint32 dueIn = Fdevices[i]->checkDueIn(now);
+            if (dueIn < next)
+                next = dueIn;
+        }
+        if (next == UINT32_MAX)
+            FsupervisorTimer.stop();
+        else
+            FsupervisorTimer.start(next > FminSupervisorInterval_ms ? next : FminSupervisorInterval_ms);
+    }
+
+    // run a supervision pass soon (e.g. after a device enabled autoConnect)
+    void wake()
+    {
+        FsupervisorTimer.start(FminSupervisorInterval_ms);
+    }
+
+    /**
+     * @brief register a device for supervision and telemetry
+     * @return false if the device table is full (the device still works but is not supervised)
+     */
+    bool add(ThardwareI2C *_device)
+    {
+        if (FdevicesN >= FdevicesSize)
+        {
+            Log.trace("I2C device table full (%u devices), 0x%02x is not supervised", FdevicesSize, _device->address());
+            return false;
+        }
+        Fdevices[FdevicesN++] = _device;
+        return true;
+    }
+
+    // update the compact summary of all devices (space separated)
+    void updateSummary()
+    {
+        char buf[FdevicesSize * 32] = "";
+        size_t n = 0;
+        for (uint8_t i = 0; i < FdevicesN && n < sizeof(buf); i++)
+        {
+            if (i > 0)
+                buf[n++] = ' ';
+            Fdevices[i]->summarize(buf + n, sizeof(buf) - n);
+            n = strlen(buf);
+        }
+        summary = buf;
+    }
+
+    /**
+     * @brief queue a device action (an identical request that is still waiting is not added again)
+     * @return false if the queue is full
+     */
+    bool enqueue(ThardwareI2C *_device, ThardwareI2C::Taction::e _action)
+    {
+        for (uint8_t i = 0; i < FqueueN; i++)
+        {
+            if (Fqueue[i].device == _device && Fqueue[i].action == _action)
+                return true;
+        }
+        if (FqueueN >= FqueueSize)
+        {
+            Log.trace("I2C queue full, action %u for 0x%02x dropped", static_cast<unsigned>(_action), _device->address());
+            dropped++;
+            return false;
+        }
+        Fqueue[FqueueN++] = Request{_device, _action, micros()};
+        queueDepth = FqueueN;
+        if (FqueueN > maxQueueDepth)
+            maxQueueDepth = FqueueN;
+        if (!FpumpTimer.running())
+            FpumpTimer.start(0);
+        return true;
+    }
+};
+
+/**
+ * @brief get the static bus instance
+ */
+ThardwareI2Cbus &i2cBus()
+{
+    static ThardwareI2Cbus bus;
+    return bus;
+}
+
+// queue action on the bus
+bool ThardwareI2C::queue(Taction::e _action)
+{
+    return i2cBus().enqueue(this, _action);
+}
+
+// register with the bus
+void ThardwareI2C::registerWithBus()
+{
+    i2cBus().add(this);
+}
+
+// recover the shared bus
+bool ThardwareI2C::recoverBus()
+{
+    return i2cBus().recover();
+}
+
+// schedule the bus supervisor
+void ThardwareI2C::wakeSupervisor()
+{
+    i2cBus().wake();
+}
+
+#ifdef I2C_FAULT_INJECTION
+// fault injection
+uint8_t ThardwareI2C::injectFault(uint8_t _transmitCode, uint8_t *_bytes, uint8_t _n)
+{
+    return i2cBus().faults.inject(Fi2cAddress, _transmitCode, _bytes, _n);
+}
+#endif
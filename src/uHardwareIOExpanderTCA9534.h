@@ -26,6 +26,9 @@ private:
     static constexpr uint8_t FoutputValuesRegister = 0x01; // output pin state register
     static constexpr uint8_t FinputValuesRegister = 0x00;  // input pin state register
 
+    // deferred verification of fast output switches
+    Ttimer FverifyTimer;
+
     // low level interactions with the chip via I2C
 
     /**
@@ -34,32 +37,7 @@ private:
      */
     uint8_t readRegister(uint8_t _register, uint8_t *_value)
     {
-        uint8_t transmitCode = SYSTEM_ERROR_NONE;
-        // lock for thread safety
-        WITH_LOCK(Wire)
-        {
-            Wire.beginTransmission(Fi2cAddress);
-            Wire.write(_register); // flag register for reading
-            // false = keep connection alive instead of stop
-            transmitCode = Wire.endTransmission(false);
-
-            // if it worked, request the uint8_t data
-            if (transmitCode == SYSTEM_ERROR_NONE)
-            {
-                const uint8_t bytesRequested = 1;
-                uint8_t request = Wire.requestFrom(Fi2cAddress, bytesRequested);
-                if (request == bytesRequested && Wire.available())
-                {
-                    *_value = Wire.read();
-                }
-                else
-                {
-                    // custom error: did not receive the expected number of bytes
-                    transmitCode = 0xff;
-                }
-            }
-        }
-        return transmitCode;
+        return request(&_register, 1, _value, 1);
     }
 
     /**
@@ -68,34 +46,57 @@ private:
      */
     uint8_t writeRegister(uint8_t _register, uint8_t _value)
     {
-        uint8_t transmitCode;
-        // lock for thread safety
-        WITH_LOCK(Wire)
-        {
-            Wire.beginTransmission(Fi2cAddress);
-            Wire.write(_register);
-            Wire.write(_value);
-            transmitCode = Wire.endTransmission();
-        }
-        return transmitCode;
+        const uint8_t bytes[] = {_register, _value};
+        return transmit(bytes, 2);
+    }
+
+    // register contents for the current pin settings
+    uint8_t pinModesByte()
+    {
+        return bitsToByte(
+            pin1 == Tmode::INPUT, pin2 == Tmode::INPUT, pin3 == Tmode::INPUT, pin4 == Tmode::INPUT,
+            pin5 == Tmode::INPUT, pin6 == Tmode::INPUT, pin7 == Tmode::INPUT, pin8 == Tmode::INPUT);
+    }
+
+    uint8_t pinValuesByte()
+    {
+        return bitsToByte(
+            pin1 == Tmode::OUTPUT_ON, pin2 == Tmode::OUTPUT_ON, pin3 == Tmode::OUTPUT_ON, pin4 == Tmode::OUTPUT_ON,
+            pin5 == Tmode::OUTPUT_ON, pin6 == Tmode::OUTPUT_ON, pin7 == Tmode::OUTPUT_ON, pin8 == Tmode::OUTPUT_ON);
     }
 
     // next level writing/reading modes
 
     /**
      * @brief writes pin modes (output/input) and checks if written correctly
+     * skips the write if the pin modes are unchanged and only reads back if _readBack is set (see verifyDue())
      */
-    bool writePinModes()
+    bool writePinModes(bool _readBack)
     {
         // configure pin inputs/outputs
-        uint8_t modes = bitsToByte(
-            pin1 == Tmode::INPUT, pin2 == Tmode::INPUT, pin3 == Tmode::INPUT, pin4 == Tmode::INPUT,
-            pin5 == Tmode::INPUT, pin6 == Tmode::INPUT, pin7 == Tmode::INPUT, pin8 == Tmode::INPUT);
-        uint8_t transmitCode = writeRegister(FpinModesRegister, modes);
-        if (transmitCode != SYSTEM_ERROR_NONE)
+        uint8_t modes = pinModesByte();
+        uint8_t transmitCode;
+        if (isShadowed(FpinModesRegister, modes))
         {
-            Log.trace("could not transmit IOExpander pin modes %s", byteBits(modes, 'O', 'I').c_str());
-            return false;
+            // already configured
+            skip();
+        }
+        else
+        {
+            transmitCode = writeRegister(FpinModesRegister, modes);
+            if (transmitCode != SYSTEM_ERROR_NONE)
+            {
+                Log.trace("could not transmit IOExpander pin modes %s", byteBits(modes, 'O', 'I').c_str());
+                return false;
+            }
+        }
+
+        // no need to read back?
+        if (!_readBack)
+        {
+            skip();
+            setShadow(FpinModesRegister, modes);
+            return true;
         }
 
         // read back modes to check if they match
@@ -116,47 +117,128 @@ private:
         }
 
         // everything in order
+        verified(registerMask(FpinModesRegister));
+        setShadow(FpinModesRegister, modes);
         return true;
     }
 
     /**
      * @brief updates output pin values (does nothing to input pin values) and checks if written correctly
+     * skips the write if the values are unchanged and only reads back if _readBack is set (see verifyDue())
      */
-    bool writePinValues()
+    bool writePinValues(bool _readBack)
     {
         // configure pin values (only matters for output pins)
-        uint8_t values = bitsToByte(
-            pin1 == Tmode::OUTPUT_ON, pin2 == Tmode::OUTPUT_ON, pin3 == Tmode::OUTPUT_ON, pin4 == Tmode::OUTPUT_ON,
-            pin5 == Tmode::OUTPUT_ON, pin6 == Tmode::OUTPUT_ON, pin7 == Tmode::OUTPUT_ON, pin8 == Tmode::OUTPUT_ON);
+        uint8_t values = pinValuesByte();
+        uint8_t transmitCode;
+        if (isShadowed(FoutputValuesRegister, values))
+        {
+            // already set
+            skip();
+        }
+        else
+        {
+            // configure pin inputs/outputs
+            transmitCode = writeRegister(FoutputValuesRegister, values);
+            if (transmitCode != SYSTEM_ERROR_NONE)
+            {
+                Log.trace("could not transmit IOExpander pin values %s", byteBits(values, 'H', 'L').c_str());
+                error = Terror::failedWrite;
+                return false;
+            }
+        }
 
-        // configure pin inputs/outputs
-        uint8_t transmitCode = writeRegister(FoutputValuesRegister, values);
-        if (transmitCode != SYSTEM_ERROR_NONE)
+        if (_readBack)
         {
-            Log.trace("could not transmit IOExpander pin values %s", byteBits(values, 'H', 'L').c_str());
-            error = Terror::failedWrite;
-            return false;
+            // check back if values are as expected
+            uint8_t read;
+            transmitCode = readRegister(FoutputValuesRegister, &read);
+            if (transmitCode != SYSTEM_ERROR_NONE)
+            {
+                Log.trace("could not read IOExpander pin values");
+                return false;
+            }
+
+            // then compare
+            if (read != values)
+            {
+                // config doesn't match!
+                Log.trace("IOExpander pin values do not match - expected: %s, received: %s",
+                          byteBits(values, 'H', 'L').c_str(), byteBits(read, 'H', 'L').c_str());
+                return false;
+            }
+            verified(registerMask(FoutputValuesRegister));
         }
+        else
+        {
+            // no read back
+            skip();
+        }
+        setShadow(FoutputValuesRegister, values);
+
+        // update sdds vars
+        updateOutputValues();
+
+        // everything in order
+        return true;
+    }
+
+    /**
+     * @brief fast path: writes only the output register (pin modes must be known to be in place)
+     * a due verification is deferred to FverifyTimer so this returns after a single transaction
+     */
+    bool writePinValuesFast()
+    {
+        uint8_t values = pinValuesByte();
+        if (isShadowed(FoutputValuesRegister, values))
+        {
+            // already set
+            skip(2);
+        }
+        else
+        {
+            if (writeRegister(FoutputValuesRegister, values) != SYSTEM_ERROR_NONE)
+            {
+                Log.trace("could not transmit IOExpander pin values %s", byteBits(values, 'H', 'L').c_str());
+                return false;
+            }
+            setShadow(FoutputValuesRegister, values);
+
+            // deferred verification
+            if (verifyDue(registerMask(FoutputValuesRegister)))
+                FverifyTimer.start(verifyDelay_ms);
+            else
+                skip();
+        }
+        updateOutputValues();
+        return true;
+    }
 
-        // check back if values are as expected
+    /**
+     * @brief deferred verification of the output register (after a fast path write)
+     */
+    bool verifyPinValues()
+    {
+        uint8_t values = pinValuesByte();
         uint8_t read;
-        transmitCode = readRegister(FoutputValuesRegister, &read);
-        if (transmitCode != SYSTEM_ERROR_NONE)
+        if (readRegister(FoutputValuesRegister, &read) != SYSTEM_ERROR_NONE)
         {
             Log.trace("could not read IOExpander pin values");
             return false;
         }
-
-        // then compare
         if (read != values)
         {
-            // config doesn't match!
             Log.trace("IOExpander pin values do not match - expected: %s, received: %s",
                       byteBits(values, 'H', 'L').c_str(), byteBits(read, 'H', 'L').c_str());
             return false;
         }
+        verified(registerMask(FoutputValuesRegister));
+        return true;
+    }
 
-        // update sdds vars
+    // update sdds vars of all outputs
+    void updateOutputValues()
+    {
         setOutputValue(&pin1, &value1);
         setOutputValue(&pin2, &value2);
         setOutputValue(&pin3, &value3);
@@ -165,9 +247,6 @@ private:
         setOutputValue(&pin6, &value6);
         setOutputValue(&pin7, &value7);
         setOutputValue(&pin8, &value8);
-
-        // everything in order
-        return true;
     }
 
     /**
@@ -203,7 +282,7 @@ private:
     {
         if (status != enums::TconStatus::connected && !connect())
             return false;
-        if (!writePinModes())
+        if (!writePinModes(verifyDue(registerMask(FpinModesRegister))))
             return false;
         if (!readPinValues())
             return false;
@@ -215,9 +294,11 @@ private:
     {
         if (status != enums::TconStatus::connected && !connect())
             return false;
-        if (!writePinModes())
+        // one verification decision for both registers
+        bool readBack = verifyDue(registerMask(FpinModesRegister) | registerMask(FoutputValuesRegister));
+        if (!writePinModes(readBack))
             return false;
-        if (!writePinValues())
+        if (!writePinValues(readBack))
             return false;
         return true;
     }
@@ -270,10 +351,16 @@ public:
     sdds_var(Tvalue, value7, sdds::opt::readonly);
     sdds_var(Tmode, pin8);
     sdds_var(Tvalue, value8, sdds::opt::readonly);
+    sdds_var(Tuint16, verifyDelay_ms, sdds::opt::nothing, 50);  // delay of deferred verification after a fast output switch
+    sdds_var(Tuint32, switchLatency_us, sdds::opt::readonly, 0); // duration of the last output switch (writeOutputs)
+    sdds_var(Tuint32, maxSwitchLatency_us, sdds::opt::readonly, 0);
 
     // constructor
     ThardwareIOExpander()
     {
+        // beam switching is time critical
+        Fpriority = Priority::URGENT;
+        clock_kHz = 400; // fast-mode
 
         // change modes
         on(pin1) { resetValue(&pin1, &value1); };
@@ -285,11 +372,23 @@ public:
         on(pin7) { resetValue(&pin7, &value7); };
         on(pin8) { resetValue(&pin8, &value8); };
 
+        // deferred verification
+        on(FverifyTimer)
+        {
+            if (status == enums::TconStatus::connected && !verifyPinValues())
+            {
+                clearShadow();
+                if (error == Terror::none)
+                    error = Terror::failedWrite;
+            }
+        };
+
         // connection status
         on(status)
         {
             if (status == enums::TconStatus::disconnected)
             {
+                FverifyTimer.stop();
                 // disconnected
                 resetValue(&pin1, &value1);
                 resetValue(&pin2, &value2);
@@ -308,4 +407,35 @@ public:
     {
         ThardwareI2C::init(_i2cAddress);
     }
+
+    /**
+     * @brief low latency output switching (e.g. the beam)
+     * writes only the output register if the pin modes are known to be in place, otherwise does a regular write
+     * @return whether the outputs were switched
+     */
+    bool writeOutputs()
+    {
+        dtypes::uint32 start = micros();
+        bool success;
+        if (status == enums::TconStatus::connected && isShadowed(FpinModesRegister, pinModesByte()))
+            success = writePinValuesFast();
+        else
+            success = write();
+
+        // same bookkeeping as a write action
+        if (success)
+        {
+            writes++;
+            if (error != Terror::none)
+                error = Terror::none;
+        }
+        else if (error == Terror::none)
+            error = Terror::failedWrite;
+
+        // latency
+        switchLatency_us = micros() - start;
+        if (switchLatency_us > maxSwitchLatency_us)
+            maxSwitchLatency_us = switchLatency_us.value();
+        return success;
+    }
 };
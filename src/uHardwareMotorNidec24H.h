@@ -22,14 +22,40 @@ private:
 
     // decoder for speed measurement
     dtypes::uint8 FdecoderPin; // digital pin on decoder
-    TisrEvent decoderISR;
-    dtypes::TtickCount FdecoderStart = 0L; // when was the decoder last set
-    dtypes::uint32 FdecoderCounter = 0L;
 
-    // decoder interrupt
+    // edge period capture (only touched by the ISR until the speed check takes a snapshot)
+    volatile dtypes::uint32 FisrLastEdge_us = 0;   // timestamp of the last edge
+    volatile dtypes::uint32 FisrLastPeriod_us = 0; // last edge period (0 = no previous edge)
+    volatile dtypes::uint32 FisrPeriodSum_us = 0;  // sum of edge periods since the last speed check
+    volatile dtypes::uint32 FisrPeriods = 0;       // number of edge periods since the last speed check
+    volatile dtypes::uint32 FisrMissed = 0;        // edges missed since the last speed check
+
+    // edges further apart than this are not part of a rotation (motor stopped or just starting), ~6 rpm
+    static constexpr dtypes::uint32 FmaxPeriod_us = 100000;
+
+    // decoder interrupt: count and time the edge right here (no event per edge)
     void decoderChangeISR()
     {
-        decoderISR.signal();
+        dtypes::uint32 now = micros();
+        dtypes::uint32 period = now - FisrLastEdge_us;
+        FisrLastEdge_us = now;
+        if (period > FmaxPeriod_us)
+        {
+            // first edge after a stop
+            FisrLastPeriod_us = 0;
+            return;
+        }
+        // a period of ~2x (or more) the previous one means edges were missed (e.g. interrupts blocked)
+        dtypes::uint32 last = FisrLastPeriod_us;
+        dtypes::uint32 missed = 0;
+        if (last > 0 && period > last + last / 2)
+        {
+            missed = (period + last / 2) / last - 1;
+            FisrMissed += missed;
+        }
+        FisrLastPeriod_us = period / (missed + 1);
+        FisrPeriodSum_us += period;
+        FisrPeriods++;
     };
 
     // speed readings/stats
@@ -38,6 +64,89 @@ private:
     TrunningStats FspeedRunningStats;
     TexactHistogram<0, 5000> Fhistogram;
 
+    // PI speed controller (runs with every speed check)
+    dtypes::float32 Fintegral_steps = 0; // integral term
+    bool FcontrolUpdate = false;         // steps are being changed by the controller
+
+    // step response tracking
+    bool Fsettled = true;
+    dtypes::TtickCount FstepStart = 0;        // when the current target was set
+    dtypes::TtickCount FinToleranceSince = 0; // when the speed entered the tolerance band
+    dtypes::uint8 FinToleranceN = 0;          // consecutive speed checks within tolerance
+    dtypes::float32 FstepDirection = 0;       // +1 speeding up, -1 slowing down
+    dtypes::float32 FmaxOvershoot = 0;        // furthest past the target (in the step direction)
+    static constexpr dtypes::uint8 FsettledN = 5; // speed checks within tolerance to count as settled
+
+    // ramp generator: jerk-limited (S-curve) speed profile, precomputed as steps and
+    // played back on the PWM output by a system timer (no sdds events until it is done)
+    static constexpr dtypes::uint16 FrampN = 200;      // max profile points
+    static constexpr dtypes::uint16 FrampMinTick_ms = 5; // finest playback interval
+    dtypes::uint16 FrampSteps[FrampN];
+    volatile dtypes::uint16 FrampIdx = 0; // next profile point
+    dtypes::uint16 FrampLen = 0;          // profile points
+    volatile bool Framping = false;       // profile playing
+    dtypes::uint16 FrampTick_ms = FrampMinTick_ms;
+    dtypes::uint16 FrampTarget_rpm = 0;
+    dtypes::float32 FrampV0 = 0, FrampV1 = 0; // start/end speed [rpm]
+    dtypes::float32 FrampA = 0, FrampJ = 0;   // peak acceleration [rpm/s], jerk [rpm/s2]
+    dtypes::float32 FrampTj = 0, FrampTa = 0; // jerk phase, constant acceleration phase [s]
+    dtypes::float32 FrampT = 0;               // total duration [s]
+    Timer FrampTimer;
+    TisrEvent FrampDone;
+
+    // timer thread: next profile point
+    void rampTick()
+    {
+        if (!Framping)
+            return;
+        dtypes::uint16 i = FrampIdx;
+        if (i < FrampLen)
+            analogWrite(FspeedPin, FrampSteps[i], FspeedFreq);
+        FrampIdx = i + 1;
+        if (i + 1 >= FrampLen)
+        {
+            Framping = false;
+            FrampTimer.stop();
+            FrampDone.signal();
+        }
+    }
+
+    // speed on the ramp profile at time _t [s]
+    dtypes::float32 rampSpeed(dtypes::float32 _t)
+    {
+        dtypes::float32 sign = (FrampV1 >= FrampV0) ? 1.0f : -1.0f;
+        if (_t >= FrampT)
+            return FrampV1;
+        if (FrampTj == 0)
+            return FrampV0 + sign * FrampA * _t; // no jerk limit (linear)
+        if (_t < FrampTj)
+            return FrampV0 + sign * FrampJ * _t * _t / 2;
+        if (_t < FrampTj + FrampTa)
+            return FrampV0 + sign * (FrampJ * FrampTj * FrampTj / 2 + FrampA * (_t - FrampTj));
+        dtypes::float32 r = FrampT - _t;
+        return FrampV1 - sign * FrampJ * r * r / 2;
+    }
+
+    // steps for a speed on the ramp (the motor does not turn below the min speed)
+    dtypes::uint16 rampStep(dtypes::float32 _rpm)
+    {
+        return (_rpm < minSpeed_rpm) ? 0 : rpmToStep(static_cast<dtypes::uint16>(round(_rpm)));
+    }
+
+    // cancel a running ramp (where it is)
+    void stopRamp()
+    {
+        Framping = false;
+        FrampTimer.stop();
+        if (ramping != enums::ToffOn::off)
+            ramping = enums::ToffOn::off;
+    }
+
+    // coupling watch (stir bar following the magnet)
+    dtypes::float32 FloadBaseline = 0;           // load index once settled at the current target (0 = not yet known)
+    dtypes::uint8 FsuspectN = 0;                 // consecutive speed updates that look decoupled
+    static constexpr dtypes::uint8 FdecoupledN = 3; // suspect speed updates to flag decoupling
+
     // step limits (will be refined based on the max and min RPM sdds variables later)
     dtypes::uint16 FminStep = 0;
     dtypes::uint16 FmaxStep = 4095;
@@ -64,7 +173,90 @@ private:
     // average slope
     static constexpr dtypes::float32 Fmavg = (0.693f + 0.693f + 0.702f + 0.691f) / 4.0f;
 
-    // convert rm to step
+    // step to rpm from the segmented linear fit above (default calibration)
+    static dtypes::float32 fitStepToRpm(dtypes::uint16 _step)
+    {
+        dtypes::uint8 calib_idx = 0;
+        for (; calib_idx < 3; calib_idx++)
+        {
+            if (_step <= calibrations[calib_idx].stepMax)
+                break;
+        }
+        return (static_cast<dtypes::float32>(_step) - calibrations[calib_idx].b) / calibrations[calib_idx].m;
+    }
+
+    // calibration table: rpm at uniformly spaced steps (every 128 steps, last point at the max step)
+    static constexpr dtypes::uint8 FcalShift = 7;
+    static constexpr dtypes::uint8 FcalN = (4096 >> FcalShift) + 1;
+    dtypes::uint16 FcalRpm[FcalN];
+
+    // inverse table: steps at uniformly spaced rpm (every 64 rpm)
+    static constexpr dtypes::uint8 FinvShift = 6;
+    static constexpr dtypes::uint8 FinvN = 100;
+    dtypes::uint16 FinvSteps[FinvN];
+
+    // step at a calibration table index
+    static dtypes::uint16 calStep(dtypes::uint8 _idx)
+    {
+        dtypes::uint16 step = static_cast<dtypes::uint16>(_idx) << FcalShift;
+        return (step > 4095) ? 4095 : step;
+    }
+
+    // seed the calibration table from the segmented fit
+    void defaultCalibration()
+    {
+        for (dtypes::uint8 i = 0; i < FcalN; i++)
+        {
+            dtypes::float32 rpm = fitStepToRpm(calStep(i));
+            FcalRpm[i] = (rpm > 0) ? static_cast<dtypes::uint16>(round(rpm)) : 0;
+        }
+    }
+
+    // parse a stored calibration (comma separated rpm values), false if it is not a complete monotone table
+    bool parseCalibration(const char *_csv)
+    {
+        dtypes::uint16 values[FcalN];
+        const char *p = _csv;
+        for (dtypes::uint8 i = 0; i < FcalN; i++)
+        {
+            char *end;
+            long v = strtol(p, &end, 10);
+            if (end == p || v < 0 || v > 65535 || (i > 0 && v < values[i - 1]))
+                return false;
+            values[i] = static_cast<dtypes::uint16>(v);
+            p = (*end == ',') ? end + 1 : end;
+        }
+        memcpy(FcalRpm, values, sizeof(FcalRpm));
+        return true;
+    }
+
+    // build the inverse table and step limits from the calibration table
+    void buildCalibration()
+    {
+        dtypes::uint8 j = 0;
+        for (dtypes::uint8 i = 0; i < FinvN; i++)
+        {
+            dtypes::uint32 rpm = static_cast<dtypes::uint32>(i) << FinvShift;
+            while (j < FcalN - 2 && rpm > FcalRpm[j + 1])
+                j++;
+            if (rpm <= FcalRpm[0])
+                FinvSteps[i] = 0;
+            else if (rpm >= FcalRpm[FcalN - 1])
+                FinvSteps[i] = 4095;
+            else
+            {
+                dtypes::uint32 dRpm = FcalRpm[j + 1] - FcalRpm[j];
+                dtypes::uint32 dStep = calStep(j + 1) - calStep(j);
+                FinvSteps[i] = calStep(j) + ((dRpm > 0) ? (rpm - FcalRpm[j]) * dStep / dRpm : 0);
+            }
+        }
+
+        // step limits follow the calibration
+        FminStep = rpmToStep(minSpeed_rpm, false);
+        FmaxStep = rpmToStep(maxSpeed_rpm, false);
+    }
+
+    // convert rm to step (O(1) lookup in the inverse calibration table)
     dtypes::uint16 rpmToStep(dtypes::uint16 _rpm, bool _checkLimits = true)
     {
         // deal with limits
@@ -72,19 +264,15 @@ private:
             return FminStep;
         if (_checkLimits && _rpm >= maxSpeed_rpm)
             return FmaxStep;
-        // find calibration
-        dtypes::float32 rpm = static_cast<dtypes::float32>(_rpm);
-        dtypes::uint8 calib_idx = 0;
-        for (; calib_idx < 4; calib_idx++)
-        {
-            if (rpm <= calibrations[calib_idx].rpmMax)
-                break;
-        }
-        // apply calibration
-        return static_cast<dtypes::uint16>(round(calibrations[calib_idx].b + calibrations[calib_idx].m * rpm));
+        // interpolate
+        dtypes::uint16 i = _rpm >> FinvShift;
+        if (i >= FinvN - 1)
+            return FinvSteps[FinvN - 1];
+        dtypes::uint16 frac = _rpm & ((1 << FinvShift) - 1);
+        return FinvSteps[i] + static_cast<dtypes::uint16>(((FinvSteps[i + 1] - FinvSteps[i]) * frac + (1 << (FinvShift - 1))) >> FinvShift);
     }
 
-    // convert steps to rpm
+    // convert steps to rpm (O(1) lookup in the calibration table)
     dtypes::uint16 stepToRpm(dtypes::uint16 _step)
     {
         // deal with limits
@@ -92,15 +280,202 @@ private:
             return minSpeed_rpm;
         if (_step >= FmaxStep)
             return maxSpeed_rpm;
-        // find calibration
-        dtypes::uint8 calib_idx = 0;
-        for (; calib_idx < 4; calib_idx++)
+        // interpolate
+        dtypes::uint8 i = _step >> FcalShift;
+        dtypes::uint16 dStep = calStep(i + 1) - calStep(i);
+        return FcalRpm[i] + static_cast<dtypes::uint16>(((FcalRpm[i + 1] - FcalRpm[i]) * (_step - calStep(i)) + dStep / 2) / dStep);
+    }
+
+    // calibration sweep
+    Ttimer FcalibrationTimer;
+    dtypes::uint8 FcalIdx = 0;                // current calibration point
+    bool FcalMeasuring = false;                // settling (false) or measuring (true)
+    TrunningStats FcalStats;                  // speeds at the current calibration point
+    dtypes::uint16 FcalSweep[FcalN];          // measured rpm
+    enums::ToffOn::e FcalAutoAdjust;          // restore after the sweep
+    dtypes::uint16 FcalTargetSteps;           // restore after the sweep
+
+    /**
+     * @brief next calibration sweep point (or finish the sweep)
+     */
+    void calibrationStep()
+    {
+        if (FcalMeasuring)
         {
-            if (_step <= calibrations[calib_idx].stepMax)
-                break;
+            // done measuring this point
+            if (FcalStats.count() == 0)
+            {
+                Log.trace("no speed readings at calibration step %d", calStep(FcalIdx));
+                finishCalibration(false);
+                return;
+            }
+            FcalSweep[FcalIdx] = static_cast<dtypes::uint16>(round(FcalStats.mean()));
+            FcalIdx++;
+            FcalMeasuring = false;
+        }
+        else
+        {
+            // settled, start measuring
+            FcalStats.reset();
+            FcalMeasuring = true;
+            FcalibrationTimer.start(calibrationMeasure_ms);
+            return;
+        }
+
+        // sweep done?
+        if (FcalIdx >= FcalN)
+        {
+            finishCalibration(true);
+            return;
         }
-        // apply calibration
-        return static_cast<dtypes::uint16>(round((static_cast<dtypes::float32>(_step) - calibrations[calib_idx].b) / calibrations[calib_idx].m));
+
+        // next point (the motor does not turn at the lowest steps, those get extrapolated at the end)
+        if (calibrationProgress_percent != FcalIdx * 100 / FcalN)
+            calibrationProgress_percent = FcalIdx * 100 / FcalN;
+        steps = calStep(FcalIdx);
+        FcalibrationTimer.start(calibrationSettle_ms);
+    }
+
+    /**
+     * @brief finish the calibration sweep, store the table if successful
+     */
+    void finishCalibration(bool _success)
+    {
+        FcalibrationTimer.stop();
+        if (_success)
+        {
+            // below the first turning point: extrapolate linearly from the next two points
+            dtypes::uint8 first = 0;
+            while (first < FcalN - 2 && FcalSweep[first] < minSpeed_rpm)
+                first++;
+            for (dtypes::int16 i = first - 1; i >= 0; i--)
+            {
+                dtypes::int32 rpm = 2 * static_cast<dtypes::int32>(FcalSweep[i + 1]) - FcalSweep[i + 2];
+                FcalSweep[i] = (rpm > 0) ? rpm : 0;
+            }
+            // enforce a monotone table
+            for (dtypes::uint8 i = 1; i < FcalN; i++)
+            {
+                if (FcalSweep[i] < FcalSweep[i - 1])
+                    FcalSweep[i] = FcalSweep[i - 1];
+            }
+            // store (parsed back into the lookup tables by the calibration event)
+            dtypes::string csv;
+            for (dtypes::uint8 i = 0; i < FcalN; i++)
+                csv = csv + ((i > 0) ? "," : "") + dtypes::string(FcalSweep[i]);
+            calibration = csv;
+        }
+        calibrationStatus = _success ? TcalibrationStatus::done : TcalibrationStatus::failed;
+        calibrationProgress_percent = _success ? 100 : calibrationProgress_percent.value();
+
+        // back to where we were
+        autoAdjust = FcalAutoAdjust;
+        targetSteps = FcalTargetSteps;
+    }
+
+    /**
+     * @brief start tracking the response to a new target speed
+     */
+    void startStep()
+    {
+        Fsettled = false;
+        FstepStart = millis();
+        FinToleranceN = 0;
+        FmaxOvershoot = 0;
+        FstepDirection = (targetSpeed_rpm >= measuredSpeed_rpm) ? 1.0f : -1.0f;
+    }
+
+    /**
+     * @brief check the tachometer statistics for a decoupled (or slipping) stir bar
+     * a decoupled bar takes the load off the motor so it turns faster than calibrated for its steps
+     * (or the PI controller backs off the steps to hold the target), a slipping bar makes the speed
+     * oscillate - both compared against the state right after settling at the current target
+     */
+    bool checkCoupling(dtypes::float32 _speed)
+    {
+        // only meaningful at a steady target
+        if (decoupleDetection != enums::ToffOn::on || !Fsettled || calibrationStatus == TcalibrationStatus::running || steps < FminStep)
+            return false;
+
+        // measured vs. calibrated speed at the current steps
+        dtypes::float32 load = 100.0f * _speed / stepToRpm(steps.value());
+        dtypes::float32 variation = 100.0f * FspeedRunningStats.stdDev() / FspeedRunningStats.mean();
+        if (loadIndex_percent != static_cast<dtypes::uint16>(round(load)))
+            loadIndex_percent = static_cast<dtypes::uint16>(round(load));
+        if (speedVariation_percent != static_cast<dtypes::uint8>(round(variation)))
+            speedVariation_percent = static_cast<dtypes::uint8>(round(variation));
+
+        // first steady read at this target --> baseline
+        if (FloadBaseline == 0)
+        {
+            FloadBaseline = load;
+            FsuspectN = 0;
+            return false;
+        }
+
+        // suspicious?
+        if (load - FloadBaseline > decoupleJump_percent.value() || variation > decoupleVariation_percent.value())
+            return ++FsuspectN >= FdecoupledN;
+
+        // looks normal --> slowly follow drifts (e.g. viscosity changes)
+        FsuspectN = 0;
+        FloadBaseline += (load - FloadBaseline) / 8.0f;
+        return false;
+    }
+
+    /**
+     * @brief PI controller with the calibration curve as feed-forward
+     * steps = rpmToStep(target) + Kp * error + integral, the integral only keeps integrating
+     * while the output is not saturated in the direction of the error (anti-windup)
+     */
+    void regulate(dtypes::float32 _speed, dtypes::float32 _dt_s)
+    {
+        if (autoAdjust != enums::ToffOn::on || targetSteps == 0 || error != Terror::none || Framping)
+            return;
+
+        dtypes::float32 e = static_cast<dtypes::float32>(targetSpeed_rpm.value()) - _speed;
+        dtypes::float32 ff = static_cast<dtypes::float32>(rpmToStep(targetSpeed_rpm.value()));
+        dtypes::float32 p = Kp.value() * e;
+
+        // anti-windup: conditional integration
+        dtypes::float32 integral = Fintegral_steps + Ki.value() * e * _dt_s;
+        dtypes::float32 u = ff + p + integral;
+        if ((u < FmaxStep || e < 0) && (u > FminStep || e > 0))
+            Fintegral_steps = integral;
+
+        // output
+        u = ff + p + Fintegral_steps;
+        if (u < FminStep)
+            u = FminStep;
+        else if (u > FmaxStep)
+            u = FmaxStep;
+        dtypes::uint16 out = static_cast<dtypes::uint16>(round(u));
+        if (steps != out)
+        {
+            FcontrolUpdate = true;
+            steps = out;
+            FcontrolUpdate = false;
+        }
+
+        // step response
+        if (Fsettled)
+            return;
+        dtypes::float32 overshoot = -e * FstepDirection;
+        if (overshoot > FmaxOvershoot)
+            FmaxOvershoot = overshoot;
+        if (fabs(e) <= autoAdjustSpeedTolerance_rpm.value())
+        {
+            if (FinToleranceN == 0)
+                FinToleranceSince = millis();
+            if (++FinToleranceN >= FsettledN)
+            {
+                Fsettled = true;
+                settling_ms = FinToleranceSince - FstepStart;
+                overshoot_rpm = static_cast<dtypes::uint16>(round(FmaxOvershoot));
+            }
+        }
+        else
+            FinToleranceN = 0;
     }
 
 public:
@@ -113,17 +488,93 @@ public:
     sdds_var(enums::ToffOn, autoAdjust, sdds::opt::saveval, enums::ToffOn::on);
     // speed tolerance: based on the calibration slopes of ~0.7 steps/rpm --> 1/0.7 = 1.4 rpm/step --> aim for targetSpeed +/- 2)
     sdds_var(Tuint8, autoAdjustSpeedTolerance_rpm, sdds::opt::saveval, static_cast<dtypes::uint8>(ceil(1.0f / Fmavg)));
-    sdds_var(Tuint16, speedCheckInterval_ms, sdds::opt::saveval, 50);
+    sdds_var(Tuint16, speedCheckInterval_ms, sdds::opt::saveval, 50); // also the controller update interval
+    sdds_var(Tfloat32, Kp, sdds::opt::saveval, 0.1);                  // proportional gain [steps/rpm]
+    sdds_var(Tfloat32, Ki, sdds::opt::saveval, 0.5);                  // integral gain [steps/(rpm s)]
+    sdds_var(Tuint32, settling_ms, sdds::opt::readonly, 0);           // time to reach the last target (within tolerance)
+    sdds_var(Tuint16, overshoot_rpm, sdds::opt::readonly, 0);         // overshoot of the last target
     sdds_var(Tuint32, readInterval_ms, sdds::opt::saveval, 500);
-    sdds_enum(none, noResponse, notInitialized) Terror;
+    sdds_enum(none, noResponse, notInitialized, decoupled) Terror;
     sdds_var(Terror, error, sdds::opt::readonly);
 
-    ThardwareMotorNidec24H()
+    // decoupling detection (decoupled is latched until the next target)
+    sdds_var(enums::ToffOn, decoupleDetection, sdds::opt::saveval, enums::ToffOn::on);
+    sdds_var(Tuint8, decoupleJump_percent, sdds::opt::saveval, 15);     // load index jump at a steady target
+    sdds_var(Tuint8, decoupleVariation_percent, sdds::opt::saveval, 8); // relative speed variation (slip)
+    sdds_var(Tuint16, loadIndex_percent, sdds::opt::readonly, 0);       // measured vs. calibrated speed at the current steps
+    sdds_var(Tuint8, speedVariation_percent, sdds::opt::readonly, 0);
+    sdds_var(Tuint32, decouplings, sdds::opt::readonly, 0);
+
+    // calibration (sweep the steps, measure the steady state speed)
+    sdds_enum(___, calibrate, abortCalibration, resetCalibration) Taction;
+    sdds_enum(none, running, done, failed) TcalibrationStatus;
+    sdds_var(Taction, action);
+    sdds_var(Tstring, calibration, sdds::opt::saveval);                // rpm at every 128 steps (empty = default calibration)
+    sdds_var(TcalibrationStatus, calibrationStatus, sdds::opt::readonly);
+    sdds_var(Tuint8, calibrationProgress_percent, sdds::opt::readonly, 0);
+    sdds_var(Tuint16, calibrationSettle_ms, sdds::opt::saveval, 3000); // wait at each step before measuring
+    sdds_var(Tuint16, calibrationMeasure_ms, sdds::opt::saveval, 2000); // measure at each step
+    sdds_var(Tuint32, missedEdges, sdds::opt::readonly, 0); // decoder edges the ISR could not have caught
+
+    // speed ramps (see ramp())
+    sdds_var(enums::ToffOn, ramping, sdds::opt::readonly, enums::ToffOn::off);
+    sdds_var(Tuint32, rampDuration_ms, sdds::opt::readonly, 0); // duration of the last ramp
+
+    ThardwareMotorNidec24H() : FrampTimer(FrampMinTick_ms, &ThardwareMotorNidec24H::rampTick, *this)
     {
+        // default calibration
+        defaultCalibration();
+        buildCalibration();
 
-        FminStep = rpmToStep(minSpeed_rpm, false);
-        FmaxStep = rpmToStep(maxSpeed_rpm, false);
+        // stored calibration
+        on(calibration)
+        {
+            if (calibration == "" || !parseCalibration(calibration.c_str()))
+                defaultCalibration();
+            buildCalibration();
+        };
+
+        // calibration actions
+        on(action)
+        {
+            if (action == Taction::calibrate && calibrationStatus != TcalibrationStatus::running)
+            {
+                if (!Finitalized)
+                {
+                    error = Terror::notInitialized;
+                }
+                else
+                {
+                    // start sweep (open loop)
+                    stopRamp();
+                    FcalAutoAdjust = autoAdjust;
+                    FcalTargetSteps = targetSteps;
+                    autoAdjust = enums::ToffOn::off;
+                    FcalIdx = 0;
+                    FcalMeasuring = false;
+                    calibrationStatus = TcalibrationStatus::running;
+                    calibrationProgress_percent = 0;
+                    steps = calStep(FcalIdx);
+                    FcalibrationTimer.start(calibrationSettle_ms);
+                }
+            }
+            else if (action == Taction::abortCalibration && calibrationStatus == TcalibrationStatus::running)
+            {
+                finishCalibration(false);
+            }
+            else if (action == Taction::resetCalibration)
+            {
+                calibration = "";
+            }
+            if (action != Taction::___)
+                action = Taction::___;
+        };
 
+        // calibration sweep
+        on(FcalibrationTimer)
+        {
+            calibrationStep();
+        };
         // set actual motor steps
         on(steps)
         {
@@ -147,6 +598,10 @@ public:
             // write the voltage for speed
             analogWrite(FspeedPin, steps.Fvalue, FspeedFreq);
 
+            // controller corrections keep the stats going
+            if (FcontrolUpdate)
+                return;
+
             // reset stats and stabilitizy
             FspeedRunningStats.reset();
             FcurrentMax = 0;
@@ -161,10 +616,22 @@ public:
         // set target steps
         on(targetSteps)
         {
+            // direct target changes take over from a ramp
+            if (Framping)
+                stopRamp();
+
+            // new target --> new coupling baseline
+            FloadBaseline = 0;
+            FsuspectN = 0;
+            if (error == Terror::decoupled)
+                error = Terror::none;
+
             if (targetSteps == 0)
             {
                 // turn motor off
                 steps = 0;
+                Fintegral_steps = 0;
+                Fsettled = true;
                 if (targetSpeed_rpm != 0)
                 {
                     // check to avoid trigger loop
@@ -183,8 +650,9 @@ public:
             }
             else
             {
-                // set steps
+                // set steps (feed-forward) and track how the speed responds
                 steps = targetSteps;
+                startStep();
                 if (targetSpeed_rpm != stepToRpm(targetSteps.Fvalue))
                 {
                     // check to aovid trigger loop
@@ -219,12 +687,6 @@ public:
             }
         };
 
-        // decoder interrupt triggered
-        on(decoderISR)
-        {
-            FdecoderCounter++;
-        };
-
         // check speed update
         on(FspeedUpdateTimer)
         {
@@ -263,8 +725,8 @@ public:
                     if (measuredSpeed_rpm != rpm)
                         measuredSpeed_rpm = rpm;
 
-                    // check if we're actually running
-                    if (targetSteps > 0)
+                    // check if we're actually running (not while the speed is still ramping)
+                    if (targetSteps > 0 && ramping == enums::ToffOn::off)
                     {
                         // if it's really running should have at least be 20% of the min speed
                         if (FspeedRunningStats.mean() < 0.2 * minSpeed_rpm.value())
@@ -273,20 +735,21 @@ public:
                             if (error != Terror::noResponse)
                                 error = Terror::noResponse;
                         }
+                        else if (error == Terror::decoupled)
+                        {
+                            // latched until the next target
+                        }
+                        else if (checkCoupling(FspeedRunningStats.mean()))
+                        {
+                            // running but the stir bar does not seem to follow
+                            decouplings++;
+                            error = Terror::decoupled;
+                        }
                         else
                         {
-                            // all good, we're running for real
+                            // all good, we're running for real (speed is regulated by the PI controller in the speed check)
                             if (error != Terror::none)
                                 error = Terror::none;
-                            // now that we're running, do we want to auto-adjust the steps to get closer to the targetSpeed once we have some good stats (n=10)?
-                            if (autoAdjust == enums::ToffOn::on && ps.count >= 10 &&
-                                abs(measuredSpeed_rpm - targetSpeed_rpm) > (autoAdjustSpeedTolerance_rpm.value() + static_cast<dtypes::uint16>(ps.sem)))
-                            {
-                                // finetune step adjustments
-                                dtypes::uint8 adjustment = static_cast<dtypes::uint8>(round(static_cast<dtypes::float32>(abs(measuredSpeed_rpm - targetSpeed_rpm)) * Fmavg * 0.5));
-                                if (adjustment > 0)
-                                    steps = steps + adjustment * ((measuredSpeed_rpm < targetSpeed_rpm) ? 1 : -1);
-                            }
                         }
                     }
                 }
@@ -303,16 +766,40 @@ public:
             FspeedUpdateTimer.start(readInterval_ms);
         };
 
+        // ramp profile finished --> now the target speed is set (and everything that follows from it)
+        on(FrampDone)
+        {
+            if (Framping)
+                return; // a new ramp already started
+            targetSpeed_rpm = FrampTarget_rpm;
+            if (ramping != enums::ToffOn::off)
+                ramping = enums::ToffOn::off;
+        };
+
         // check speed timer
         on(FspeedCheckTimer)
         {
-            // how long was the check interval?
-            dtypes::uint32 diff_micros = micros() - FdecoderStart;
-            // make sure the time interval is within 1% of the intented window, otherwise it's likely that not all interrupts were caught correctly
-            if (diff_micros > speedCheckInterval_ms.value() * 990 && diff_micros < speedCheckInterval_ms.value() * 1110)
+            // snapshot of the edge periods captured by the ISR
+            dtypes::uint32 periodSum, periods, missed, lastEdge;
+            ATOMIC_BLOCK()
+            {
+                periodSum = FisrPeriodSum_us;
+                periods = FisrPeriods;
+                missed = FisrMissed;
+                lastEdge = FisrLastEdge_us;
+                FisrPeriodSum_us = 0;
+                FisrPeriods = 0;
+                FisrMissed = 0;
+            }
+            if (missed > 0)
+                missedEdges = missedEdges + missed;
+
+            // speed from the mean edge period (missed edges are part of the summed periods)
+            // decoder info: rpm = freq (in Hz) / 100 * 60 = 1e6 / period.micros * 1/100 * 60 = 600000. / period.micros
+            bool stopped = (periods == 0 && micros() - lastEdge > FmaxPeriod_us);
+            if (periods > 0 || stopped)
             {
-                // decoder info: rpm = freq (in Hz) / 100 * 60 = counts / dt.micros * 1e6 * 1/100 * 60 = 600000. * count / dt.micros
-                dtypes::float32 speed = 600000.0 / diff_micros * FdecoderCounter;
+                dtypes::float32 speed = (periods > 0) ? 600000.0 * (periods + missed) / periodSum : 0.0;
                 FspeedRunningStats.add(speed);
                 if (speed > FcurrentMax)
                     FcurrentMax = speed;
@@ -322,16 +809,132 @@ public:
                     dtypes::uint16 rpm = static_cast<dtypes::uint16>(round(speed));
                     Fhistogram.add(rpm);
                 }
+
+                // calibration measurement
+                if (FcalMeasuring)
+                    FcalStats.add(speed);
+
+                // closed loop speed control (once the motor is turning)
+                if (periods > 0)
+                    regulate(speed, speedCheckInterval_ms.value() / 1000.0f);
             }
 
-            // reset decoder
-            FdecoderStart = micros();
-            FdecoderCounter = 0;
             FspeedCheckTimer.start(speedCheckInterval_ms);
             return;
         };
     }
 
+    // speed the motor actually runs at for a target (0 = off, otherwise within the min/max speed)
+    dtypes::uint16 clampSpeed(dtypes::uint16 _rpm)
+    {
+        if (_rpm > 0 && _rpm < minSpeed_rpm)
+            return minSpeed_rpm;
+        if (_rpm > maxSpeed_rpm)
+            return maxSpeed_rpm;
+        return _rpm;
+    }
+
+    /**
+     * @brief ramp to a new speed with limited acceleration and jerk (S-curve)
+     * the profile is precomputed and played back directly on the PWM output, the target speed
+     * (and with it targetSteps/steps and the speed controller) is only updated once the ramp is done
+     * @param _rpm target speed (0 = off)
+     * @param _accel_rpm_s max acceleration (0 = jump to the new speed)
+     * @param _jerk_rpm_s2 max jerk (0 = no jerk limit, i.e. linear ramp)
+     */
+    void ramp(dtypes::uint16 _rpm, dtypes::float32 _accel_rpm_s, dtypes::float32 _jerk_rpm_s2)
+    {
+        if (!Finitalized)
+        {
+            error = Terror::notInitialized;
+            return;
+        }
+
+        // where are we now?
+        dtypes::float32 v0 = Framping ? rampSpeed(FrampIdx * FrampTick_ms / 1000.0f) : static_cast<dtypes::float32>(targetSpeed_rpm.value());
+        Framping = false;
+        FrampTimer.stop();
+
+        // where to?
+        _rpm = clampSpeed(_rpm);
+        dtypes::float32 dv = fabs(_rpm - v0);
+
+        // a ramp is a new target --> new coupling baseline (the target speed itself is only set once the ramp is done)
+        FloadBaseline = 0;
+        FsuspectN = 0;
+        if (error == Terror::decoupled)
+            error = Terror::none;
+        if (_accel_rpm_s <= 0 || dv < 1)
+        {
+            // nothing to ramp
+            if (ramping != enums::ToffOn::off)
+                ramping = enums::ToffOn::off;
+            targetSpeed_rpm = _rpm;
+            return;
+        }
+
+        // profile phases
+        FrampV0 = v0;
+        FrampV1 = _rpm;
+        FrampTarget_rpm = _rpm;
+        FrampJ = _jerk_rpm_s2;
+        if (_jerk_rpm_s2 <= 0)
+        {
+            // linear
+            FrampA = _accel_rpm_s;
+            FrampTj = 0;
+            FrampTa = dv / FrampA;
+            FrampT = FrampTa;
+        }
+        else if (dv >= _accel_rpm_s * _accel_rpm_s / _jerk_rpm_s2)
+        {
+            // reaches the max acceleration
+            FrampA = _accel_rpm_s;
+            FrampTj = FrampA / FrampJ;
+            FrampTa = dv / FrampA - FrampTj;
+            FrampT = 2 * FrampTj + FrampTa;
+        }
+        else
+        {
+            // does not reach the max acceleration
+            FrampTj = sqrt(dv / FrampJ);
+            FrampA = FrampJ * FrampTj;
+            FrampTa = 0;
+            FrampT = 2 * FrampTj;
+        }
+
+        // precompute the steps
+        dtypes::uint32 T_ms = static_cast<dtypes::uint32>(ceil(FrampT * 1000));
+        FrampTick_ms = (T_ms + FrampN - 2) / (FrampN - 1);
+        if (FrampTick_ms < FrampMinTick_ms)
+            FrampTick_ms = FrampMinTick_ms;
+        FrampLen = (T_ms + FrampTick_ms - 1) / FrampTick_ms + 1;
+        if (FrampLen > FrampN)
+            FrampLen = FrampN;
+        for (dtypes::uint16 i = 0; i + 1 < FrampLen; i++)
+            FrampSteps[i] = rampStep(rampSpeed((i + 1) * FrampTick_ms / 1000.0f));
+        FrampSteps[FrampLen - 1] = (_rpm > 0) ? rpmToStep(_rpm) : 0;
+        rampDuration_ms = FrampLen * FrampTick_ms;
+
+        // play
+        FrampIdx = 0;
+        Framping = true;
+        if (ramping != enums::ToffOn::on)
+            ramping = enums::ToffOn::on;
+        FrampTimer.changePeriod(FrampTick_ms);
+        FrampTimer.start();
+    }
+
+    /**
+     * @brief speed the motor is driven at right now (on the ramp if one is playing)
+     */
+    dtypes::uint16 commandedSpeed_rpm()
+    {
+        if (!Framping)
+            return targetSpeed_rpm;
+        return static_cast<dtypes::uint16>(round(rampSpeed(FrampIdx * FrampTick_ms / 1000.0f)));
+    }
+
     void init(dtypes::uint8 _speedPin, dtypes::uint8 _decoderPin)
     {
         // save pins
@@ -30,33 +30,270 @@ public:
 protected:
     Ttimer FstartupTimer;
 
-    // I2C write function
-    virtual bool write() override
+    // shadow of the frame last sent to the display (128x64 max)
+    static constexpr dtypes::uint16 FshadowSize = 128 * 64 / 8;
+    uint8_t Fshadow[FshadowSize];
+    bool FshadowValid = false; // false = display RAM unknown, push the full frame
+
+    // longest formatted line (a full line is 21 characters of the 6 pixel font)
+    static constexpr dtypes::uint8 FlineSize = 32;
+
+    // data bytes per I2C transmission (Wire buffer minus the control byte)
+    static constexpr dtypes::uint8 FchunkSize = 31;
+
+    // frame worker: renders and pushes frames on a low priority thread so the main loop only hands over a request.
+    // The GFX buffer is the back buffer (only the worker draws into it while a frame is in flight),
+    // the shadow is the front buffer (what the display RAM holds).
+    static constexpr os_thread_prio_t FworkerPriority = OS_THREAD_PRIORITY_DEFAULT - 1;
+    static constexpr size_t FworkerStack = 4096;
+    std::function<void()> Frender; // draws a frame (called on the worker thread)
+    Thread *Fworker = nullptr;
+    os_semaphore_t Fframe = nullptr;
+    volatile bool Frendering = false; // set by the main loop, cleared when the frame is done
+    TisrEvent FframeDone;
+
+    // a frame handed back to the main loop (to push after connecting, or for a reset that came in while it was in flight):
+    // the main loop owns the buffer and no new frame is rendered until it is done with it
+    bool FhandedBack = false;
+    bool FresetPending = false;
+
+    // frame results (written by the worker, read on the main loop after FframeDone)
+    volatile bool FframePushed = false;
+    volatile uint8_t FframeCode = SYSTEM_ERROR_NONE;
+    volatile bool FframeFull = false;
+    volatile dtypes::uint16 FframeSent = 0;
+    volatile dtypes::uint32 FframeRender_us = 0;
+    volatile dtypes::uint32 FframePush_us = 0;
+
+    // push inputs (copied from the sdds variables on the main loop before a frame is pushed, see takePushInputs())
+    bool FpushConnected = false;
+    bool FpushDifferential = true;
+    dtypes::uint16 FpushClock_kHz = 100;
+
+    // clock switches made by pushes (added to the shared counters on the main loop, see countClockSwitches())
+    volatile dtypes::uint32 FpushClockSwitches = 0;
+    volatile dtypes::uint32 FpushClockSwitch_us = 0;
+
+    // start the worker thread (false if the OS can't provide it)
+    bool startWorker()
     {
-        if (status != enums::TconStatus::connected && !connect())
+        if (Fworker)
+            return true;
+        if (os_semaphore_create(&Fframe, 1, 0) != 0)
             return false;
+        Fworker = new Thread("display", [this]()
+                             { work(); }, FworkerPriority, FworkerStack);
+        return Fworker != nullptr;
+    }
+
+    // worker thread: wait for a frame request, render, push (no sdds variables are touched here)
+    void work()
+    {
+        while (true)
+        {
+            if (os_semaphore_take(Fframe, CONCURRENT_WAIT_FOREVER, false) != 0)
+                continue;
+            dtypes::uint32 start = micros();
+            Frender();
+            FframeRender_us = micros() - start;
 
-        // send over I2C
+            // push if connected (connecting is left to the main loop)
+            FframePushed = FpushConnected;
+            if (FframePushed)
+            {
+                uint8_t transmitCode = SYSTEM_ERROR_NONE;
+                bool full = false;
+                start = micros();
+                FframeSent = push(transmitCode, full);
+                FframePush_us = micros() - start;
+                FframeCode = transmitCode;
+                FframeFull = full;
+            }
+            FframeDone.signal();
+        }
+    }
+
+    // send data bytes to the display RAM (at the current address window)
+    uint8_t sendData(const uint8_t *_bytes, dtypes::uint16 _n)
+    {
+        uint8_t transmitCode = SYSTEM_ERROR_NONE;
+        for (dtypes::uint16 i = 0; i < _n; i += FchunkSize)
+        {
+            dtypes::uint16 n = (_n - i < FchunkSize) ? _n - i : FchunkSize;
+            Wire.beginTransmission(Fi2cAddress);
+            Wire.write(0x40); // data stream
+            Wire.write(_bytes + i, n);
+            uint8_t code = Wire.endTransmission();
+            if (transmitCode == SYSTEM_ERROR_NONE)
+                transmitCode = code;
+        }
+        return transmitCode;
+    }
+
+    /**
+     * @brief send only the changed column range of each changed page (page/column addressing,
+     * the display runs in horizontal addressing mode so the window can be set with COLUMNADDR/PAGEADDR)
+     * @return bytes sent (commands + data)
+     */
+    dtypes::uint16 pushChanges(uint8_t &_transmitCode)
+    {
+        const dtypes::uint16 w = width();
+        const dtypes::uint8 pages = (height() + 7) / 8;
+        dtypes::uint16 sent = 0;
+        for (dtypes::uint8 page = 0; page < pages; page++)
+        {
+            const uint8_t *now = buffer + page * w;
+            uint8_t *last = Fshadow + page * w;
+
+            // changed column range
+            dtypes::int16 first = 0;
+            while (first < w && now[first] == last[first])
+                first++;
+            if (first == w)
+                continue; // page unchanged
+            dtypes::int16 end = w - 1;
+            while (now[end] == last[end])
+                end--;
+
+            // window and data
+            const uint8_t window[] = {SSD1306_COLUMNADDR, static_cast<uint8_t>(first), static_cast<uint8_t>(end), SSD1306_PAGEADDR, page, page};
+            ssd1306_commandList(window, sizeof(window));
+            uint8_t code = sendData(now + first, end - first + 1);
+            if (_transmitCode == SYSTEM_ERROR_NONE)
+                _transmitCode = code;
+            memcpy(last + first, now + first, end - first + 1);
+            sent += sizeof(window) + end - first + 1;
+        }
+        return sent;
+    }
+
+    // copy what push() reads from the sdds variables (main loop, before the frame goes to the worker or is pushed)
+    void takePushInputs()
+    {
+        FpushConnected = (status == enums::TconStatus::connected);
+        FpushDifferential = (differential == enums::ToffOn::on);
+        FpushClock_kHz = clock_kHz;
+    }
+
+    // add the clock switches of the pushes to the shared bus counters (main loop, no push in flight)
+    void countClockSwitches()
+    {
+        FclockSwitches += FpushClockSwitches;
+        FclockSwitch_us += FpushClockSwitch_us;
+        FpushClockSwitches = 0;
+        FpushClockSwitch_us = 0;
+    }
+
+    /**
+     * @brief push the frame buffer to the display (only what changed if the shadow is valid)
+     * runs on the worker thread as well: only the push inputs are read (see takePushInputs())
+     * @return bytes sent, _full is set if the whole frame went out
+     */
+    dtypes::uint16 push(uint8_t &_transmitCode, bool &_full)
+    {
+        dtypes::uint16 sent = 0;
+        _full = false;
         WITH_LOCK(Wire)
         {
+            dtypes::uint32 switch_us = 0;
+            if (switchClock(FpushClock_kHz, switch_us))
+            {
+                FpushClockSwitches++;
+                FpushClockSwitch_us += switch_us;
+            }
             // make sure vertical offset stays at 0 (tends to get messed up after a while)
             ssd1306_command1(SSD1306_SETSTARTLINE | 0x0);
-            // display actual text
-            display();
+            if (FshadowValid && FpushDifferential)
+            {
+                // only what changed
+                sent = pushChanges(_transmitCode);
+            }
+            else
+            {
+                // full frame (Adafruit_SSD1306 does not report errors)
+                display();
+                sent = width() * ((height() + 7) / 8);
+                FshadowValid = (sent <= FshadowSize);
+                if (FshadowValid)
+                    memcpy(Fshadow, buffer, sent);
+                _full = true;
+            }
+        }
+        if (_transmitCode != SYSTEM_ERROR_NONE)
+            FshadowValid = false; // not sure what made it, full frame next time
+        return sent;
+    }
+
+    // does the worker own the GFX buffer? (main loop pushes and resets have to stay off it)
+    bool bufferBusy() const
+    {
+        return Frendering && !FhandedBack;
+    }
+
+    // main loop is done with a handed back frame, the next one can be rendered
+    void releaseBuffer()
+    {
+        if (FhandedBack)
+        {
+            FhandedBack = false;
+            Frendering = false;
         }
-        return true;
+    }
+
+    // I2C write function
+    virtual bool write() override
+    {
+        // a frame is in flight: the worker pushes it (or hands it back to be pushed here)
+        if (bufferBusy())
+            return true;
+        bool success = pushFrame();
+        releaseBuffer();
+        return success;
+    }
+
+    // push the frame from the main loop (connects first if needed)
+    bool pushFrame()
+    {
+        if (status != enums::TconStatus::connected && !connect())
+            return false;
+
+        // send over I2C (timed for the bus telemetry)
+        dtypes::uint32 start = micros();
+        uint8_t transmitCode = SYSTEM_ERROR_NONE;
+        bool full = false;
+        takePushInputs();
+        dtypes::uint16 sent = push(transmitCode, full);
+        record(transmitCode, micros() - start);
+        countClockSwitches();
+        if (full)
+            fullPushes++;
+        if (bytesSent != sent)
+            bytesSent = sent;
+        return transmitCode == SYSTEM_ERROR_NONE;
     }
 
     // reset  display
     virtual bool reset() override
     {
+        // begin() clears the buffer, wait for the frame in flight to come back
+        if (bufferBusy())
+        {
+            FresetPending = true;
+            return true;
+        }
+
+        // display RAM is unknown after a reset
+        FshadowValid = false;
+
         // reset screen
+        bool success = true;
         WITH_LOCK(Wire)
         {
-            if (!begin(SSD1306_SWITCHCAPVCC, Fi2cAddress, true, false))
-                return false;
+            useClock();
+            success = begin(SSD1306_SWITCHCAPVCC, Fi2cAddress, true, false);
         }
-        return true;
+        releaseBuffer();
+        return success;
     }
 
     // render screen content
@@ -74,11 +311,68 @@ public:
     sdds_var(Tuint32, startup_ms, sdds::opt::saveval, 6000);
     sdds_var(Tstartup, startup, sdds::opt::readonly);
 
+    // differential pushes (only changed pages/columns)
+    sdds_var(enums::ToffOn, differential, sdds::opt::saveval, enums::ToffOn::on);
+    sdds_var(Tuint16, bytesSent, sdds::opt::readonly, 0); // bytes sent with the last push
+    sdds_var(Tuint32, fullPushes, sdds::opt::readonly, 0);
+
+    // frames rendered and pushed on the worker thread (off = inline on the main loop)
+    sdds_var(enums::ToffOn, background, sdds::opt::saveval, enums::ToffOn::on);
+    sdds_var(Tuint32, frames, sdds::opt::readonly, 0);
+    sdds_var(Tuint32, renderTime_us, sdds::opt::readonly, 0); // rendering of the last frame
+
     // constructor
+    // the bus clock is managed by ThardwareI2C (clock_kHz) so Adafruit_SSD1306 gets the same clock during and after transfers
     ThardwareOledSSD1309(
         uint8_t _width, const uint8_t _height, int8_t _rstPin,
-        uint32_t _clkDuring = 400000, uint32_t _clkAfter = 100000) : Adafruit_SSD1306(_width, _height, &Wire, _rstPin, _clkDuring, _clkAfter)
+        uint32_t _clk = 400000) : Adafruit_SSD1306(_width, _height, &Wire, _rstPin, _clk, _clk)
     {
+        // display pushes are slow and can wait
+        Fpriority = Priority::BACKGROUND;
+        clock_kHz = _clk / 1000;
+
+        // a full frame with the next push
+        on(differential)
+        {
+            FshadowValid = false;
+        };
+
+        // frame from the worker: bus telemetry and errors are handled here, on the main loop
+        on(FframeDone)
+        {
+            countClockSwitches();
+            if (FframePushed)
+            {
+                record(FframeCode, FframePush_us);
+                if (FframeFull)
+                    fullPushes++;
+                if (bytesSent != FframeSent)
+                    bytesSent = FframeSent;
+                if (FframeCode == SYSTEM_ERROR_NONE)
+                {
+                    writes++;
+                    error = Terror::none;
+                }
+                else if (error == Terror::none)
+                    error = Terror::failedWrite;
+            }
+            if (!FframePushed || FresetPending)
+            {
+                // hand the buffer back: reset if one was asked for, push (not connected, the queued write connects first)
+                FhandedBack = true;
+                bool queued = !FresetPending || queue(ThardwareI2C::Taction::reset);
+                queued = queue(ThardwareI2C::Taction::write) && queued;
+                FresetPending = false;
+                if (!queued)
+                    releaseBuffer(); // bus queue full, drop the frame (the next one is pushed)
+            }
+            else
+                Frendering = false;
+            if (renderTime_us != FframeRender_us)
+                renderTime_us = FframeRender_us;
+            frames++;
+        };
+
         // startup timer
         on(FstartupTimer)
         {
@@ -95,6 +389,7 @@ public:
             WITH_LOCK(Wire)
             {
                 ThardwareI2C::init(_i2cAddress);
+                useClock();
                 // begin with reset = true and periphBegin = false (Wire is already started separately in the I2C base class)
                 begin(SSD1306_SWITCHCAPVCC, Fi2cAddress, true, false);
             }
@@ -103,10 +398,12 @@ public:
             setTextSize(1);      // smallest text size by default
             setTextColor(WHITE); // default color
             clearDisplay();
+            FshadowValid = false;
             splash();
             FstartupTimer.start(startup_ms);
             WITH_LOCK(Wire)
             {
+                useClock();
                 display();
             }
             // for the next print
@@ -114,6 +411,45 @@ public:
         }
     }
 
+    // set the function that draws a frame (called from the worker thread, it must not touch sdds variables)
+    void renderWith(std::function<void()> _render)
+    {
+        Frender = _render;
+    }
+
+    // is a frame still being rendered or pushed? (don't change what the renderer reads until frames changes)
+    bool rendering() const
+    {
+        return Frendering;
+    }
+
+    /**
+     * @brief render and push a frame (on the worker thread unless background is off)
+     * @return false if the previous frame is still in flight
+     */
+    bool requestFrame()
+    {
+        if (Frendering || !Frender)
+            return false;
+        if (background == enums::ToffOn::on && startWorker())
+        {
+            takePushInputs();
+            Frendering = true;
+            os_semaphore_give(Fframe, false);
+            return true;
+        }
+
+        // inline
+        dtypes::uint32 start = micros();
+        Frender();
+        dtypes::uint32 render_us = micros() - start;
+        if (renderTime_us != render_us)
+            renderTime_us = render_us;
+        queue(ThardwareI2C::Taction::write);
+        frames++;
+        return true;
+    }
+
     // print bitmap
     void printBitmap(uint16_t _y, const uint8_t *_bitmap, uint16_t _w, uint16_t _h, uint16_t _xpad = 0, valign _valign = valign::TOP)
     {
@@ -151,24 +487,61 @@ public:
     // print text line
     void printLine(uint16_t _y, dtypes::string _line, uint16_t _xpad = 0, valign _valign = valign::TOP)
     {
-        printLine(_y, _line, align::LEFT, _xpad, _valign);
+        printLine(_y, _line.c_str(), align::LEFT, _xpad, _valign);
     }
 
     void printLine(uint16_t _y, dtypes::string _line, align _align, valign _valign)
     {
-        printLine(_y, _line, _align, 0, _valign);
+        printLine(_y, _line.c_str(), _align, 0, _valign);
     }
 
     void printLine(uint16_t _y, dtypes::string _line, align _align, uint16_t _xpad = 0, valign _valign = valign::TOP)
+    {
+        printLine(_y, _line.c_str(), _align, _xpad, _valign);
+    }
+
+    // print text line from a fixed buffer or literal (no heap allocation)
+    void printLine(uint16_t _y, const char *_line, uint16_t _xpad = 0, valign _valign = valign::TOP)
+    {
+        printLine(_y, _line, align::LEFT, _xpad, _valign);
+    }
+
+    void printLine(uint16_t _y, const char *_line, align _align, valign _valign)
+    {
+        printLine(_y, _line, _align, 0, _valign);
+    }
+
+    // print formatted text line (formatted into a stack buffer, no heap allocation)
+    void printLinef(uint16_t _y, uint16_t _xpad, const char *_format, ...) __attribute__((format(printf, 4, 5)))
+    {
+        char line[FlineSize];
+        va_list args;
+        va_start(args, _format);
+        vsnprintf(line, sizeof(line), _format, args);
+        va_end(args);
+        printLine(_y, line, align::LEFT, _xpad);
+    }
+
+    void printLinef(uint16_t _y, align _align, const char *_format, ...) __attribute__((format(printf, 4, 5)))
+    {
+        char line[FlineSize];
+        va_list args;
+        va_start(args, _format);
+        vsnprintf(line, sizeof(line), _format, args);
+        va_end(args);
+        printLine(_y, line, _align);
+    }
+
+    void printLine(uint16_t _y, const char *_line, align _align, uint16_t _xpad = 0, valign _valign = valign::TOP)
     {
         uint16_t x = _xpad;
         if (_align == align::CENTER)
         {
-            x = (width() - _line.length() * 6) / 2;
+            x = (width() - strlen(_line) * 6) / 2;
         }
         else if (_align == align::RIGHT)
         {
-            x = width() - _line.length() * 6 - _xpad;
+            x = width() - strlen(_line) * 6 - _xpad;
         }
         uint16_t y = _y;
         if (_valign == valign::CENTER)
@@ -21,7 +21,7 @@ public:
         EXTN,
         EXTP
     };
-    sdds_enum(UNSET, ON, OFF, DIMMED) Tvalue;
+    sdds_enum(UNSET, ON, OFF, DIMMED, PULSED) Tvalue;
 
     // 8-bit resolution
     const static uint8_t MAX = 255;
@@ -50,6 +50,12 @@ private:
     const static uint8_t FoutputModeOff = 0b00;
     const static uint8_t FoutputModeOn = 0b01;
     const static uint8_t FoutputModeDimmed = 0b10;
+    const static uint8_t FoutputModeGroup = 0b11; // individual brightness + group blinking
+
+    // group blinking (see manual Tables 9, 11, 12)
+    const static uint8_t Fmode2Blink = (1 << 5);      // DMBLNK: group control is blinking instead of dimming
+    const static dtypes::uint16 FblinkMin_ms = 42;    // GRPFREQ = 0 --> 1/24 s
+    const static dtypes::uint16 FblinkMax_ms = 10667; // GRPFREQ = 255 --> 256/24 s
 
     // default
     Driver Fdriver = Driver::DIRECT;
@@ -65,40 +71,14 @@ private:
      */
     uint8_t readRegisters(uint8_t _first, uint8_t _n, uint8_t *_values)
     {
-        // lock for thread safety
-        WITH_LOCK(Wire)
-        {
-            Wire.beginTransmission(Fi2cAddress);
-            // start at first register with autoincrement
-            Wire.write(FincrementFlagAll | _first);
-            // false = keep connection alive instead of stop
-            uint8_t transmitCode = Wire.endTransmission(false);
-            if (transmitCode != SYSTEM_ERROR_NONE)
-            {
-                Log.trace("could not read PwmDimmer register values");
-                return transmitCode;
-            }
-
-            // request to read all relevant registers
-            uint8_t request = Wire.requestFrom(Fi2cAddress, _n);
-            if (request != _n)
-            {
-                Log.trace("could not read the expected number of PwmDimmer register values");
-                return 0xff;
-            }
-
-            // read the values
-            for (int i = 0; i < _n; i++)
-            {
-                if (!Wire.available())
-                {
-                    Log.trace("could not read the expected number of PwmDimmer register values");
-                    return 0xff;
-                }
-                _values[i] = Wire.read();
-            }
-        }
-        return SYSTEM_ERROR_NONE;
+        // start at first register with autoincrement
+        const uint8_t control = FincrementFlagAll | _first;
+        uint8_t transmitCode = request(&control, 1, _values, _n);
+        if (transmitCode == 0xff)
+            Log.trace("could not read the expected number of PwmDimmer register values");
+        else if (transmitCode != SYSTEM_ERROR_NONE)
+            Log.trace("could not read PwmDimmer register values");
+        return transmitCode;
     }
 
     /**
@@ -110,29 +90,23 @@ private:
      */
     uint8_t writeRegisters(uint8_t _first, uint8_t _n, const uint8_t *_values)
     {
-        // lock for thread safety
-        WITH_LOCK(Wire)
-        {
-            // transmit configuration
-            // control: start at _first, auto-increment from there (see Fig. 10, Table 6 & 7 in datasheet)
-            Wire.beginTransmission(Fi2cAddress);
-            Wire.write(FincrementFlagAll | _first);
-            for (uint8_t i = 0; i < _n; i++)
-            {
-                Wire.write(_values[i]);
-            }
-            uint8_t transmitCode = Wire.endTransmission();
-            if (transmitCode != SYSTEM_ERROR_NONE)
-            {
-                Log.trace("could not write PwmDimmer register values");
-                return transmitCode;
-            }
-        }
-        return SYSTEM_ERROR_NONE;
+        // transmit configuration
+        // control: start at _first, auto-increment from there (see Fig. 10, Table 6 & 7 in datasheet)
+        if (_n > FregistersN)
+            _n = FregistersN;
+        uint8_t bytes[FregistersN + 1];
+        bytes[0] = FincrementFlagAll | _first;
+        for (uint8_t i = 0; i < _n; i++)
+            bytes[i + 1] = _values[i];
+        uint8_t transmitCode = transmit(bytes, _n + 1);
+        if (transmitCode != SYSTEM_ERROR_NONE)
+            Log.trace("could not write PwmDimmer register values");
+        return transmitCode;
     }
 
     /**
      * @brief write the relevant registers (first 9)
+     * only the range of registers that differs from the shadow is transmitted and read back if verification is due
      * @return error code from Wire.endTransmission() or custom error code 0xff if uint8_t request failed
      */
     bool writeConfiguration()
@@ -153,54 +127,120 @@ private:
         regs[FgrpFreqRegister] = FgrpFreqDefault;
         regs[FoutputModeRegister] = 0;
 
+        // group blinking: the chip runs the pulses by itself, no CPU or I2C traffic until the next change
+        if (blinkPeriod_ms > 0)
+        {
+            regs[Fmode2Register] |= Fmode2Blink;
+            regs[FgrpPwmRegister] = blinkDuty.value();
+            regs[FgrpFreqRegister] = blinkFrequencyRegister();
+        }
+
         // output mode
         uint8_t outputModes[4] = {
-            getOutputMode(&state1, &setpoint1),
-            getOutputMode(&state2, &setpoint2),
-            getOutputMode(&state3, &setpoint3),
-            getOutputMode(&state4, &setpoint4)};
+            getOutputMode(&state1, &setpoint1, 0),
+            getOutputMode(&state2, &setpoint2, 1),
+            getOutputMode(&state3, &setpoint3, 2),
+            getOutputMode(&state4, &setpoint4, 3)};
         regs[FoutputModeRegister] |= (outputModes[0] << 0); // state1 goes into bits 1:0
         regs[FoutputModeRegister] |= (outputModes[1] << 2); // state2 goes into bits 3:2
         regs[FoutputModeRegister] |= (outputModes[2] << 4); // state3 goes into bits 5:4
         regs[FoutputModeRegister] |= (outputModes[3] << 6); // state4 goes into bits 7:6
 
-        // write the registers
-        if (writeRegisters(Fmode1Register, FregistersN, regs) != SYSTEM_ERROR_NONE)
-            return false;
+        // which registers actually changed?
+        bool readBack = verifyDue(registerMask(Fmode1Register, FregistersN));
+        uint8_t from = Fmode1Register, to = FoutputModeRegister;
+        if (changedRange(Fmode1Register, FregistersN, regs, &from, &to))
+        {
+            // write only the changed range
+            if (writeRegisters(from, to - from + 1, regs + from) != SYSTEM_ERROR_NONE)
+                return false;
+        }
+        else if (readBack)
+        {
+            // nothing changed but verification is due --> check all registers
+            skip();
+            from = Fmode1Register;
+            to = FoutputModeRegister;
+        }
+        else
+        {
+            // nothing changed and no need to verify
+            skip(2);
+            from = to + 1;
+        }
 
-        // read them back
-        uint8_t reads[FregistersN];
-        if (readRegisters(Fmode1Register, FregistersN, reads) != SYSTEM_ERROR_NONE)
-            return false;
+        // registers that were never verified since connecting are read back too
+        if (readBack && (FverifyPending & registerMask(Fmode1Register, FregistersN)))
+        {
+            from = Fmode1Register;
+            to = FoutputModeRegister;
+        }
 
-        // compare the values
-        for (uint8_t i = 0; i < FregistersN; i++)
+        if (readBack)
         {
-            if (reads[i] != regs[i])
-            {
-                Log.trace("PwmDimmer register %d value does not match - expected: %s, received: %s",
-                          i, byteBits(regs[i]).c_str(), byteBits(reads[i]).c_str());
+            // read them back
+            uint8_t reads[FregistersN];
+            if (readRegisters(from, to - from + 1, reads + from) != SYSTEM_ERROR_NONE)
                 return false;
+
+            // compare the values
+            for (uint8_t i = from; i <= to; i++)
+            {
+                if (reads[i] != regs[i])
+                {
+                    Log.trace("PwmDimmer register %d value does not match - expected: %s, received: %s",
+                              i, byteBits(regs[i]).c_str(), byteBits(reads[i]).c_str());
+                    return false;
+                }
             }
+            verified(registerMask(from, to - from + 1));
         }
+        else if (from <= to)
+        {
+            // written but not read back
+            skip();
+        }
+
+        // update shadow
+        for (uint8_t i = from; i <= to; i++)
+            setShadow(i, regs[i]);
 
         // update sdds vars
-        setValue(&setpoint1, &state1, &value1);
-        setValue(&setpoint2, &state2, &value2);
-        setValue(&setpoint3, &state3, &value3);
-        setValue(&setpoint4, &state4, &value4);
+        setValue(&setpoint1, &state1, &value1, 0);
+        setValue(&setpoint2, &state2, &value2, 1);
+        setValue(&setpoint3, &state3, &value3, 2);
+        setValue(&setpoint4, &state4, &value4, 3);
 
         // done
         return true;
     }
 
+    // is a channel (0-3) pulsed by the group blinking?
+    bool isBlinking(uint8_t _channel)
+    {
+        return blinkPeriod_ms > 0 && ((blink.value() >> _channel) & 0x01);
+    }
+
+    // GRPFREQ register value for the blink period: period = (GRPFREQ + 1) / 24 s
+    uint8_t blinkFrequencyRegister()
+    {
+        dtypes::uint32 period = blinkPeriod_ms.value();
+        if (period < FblinkMin_ms)
+            period = FblinkMin_ms;
+        else if (period > FblinkMax_ms)
+            period = FblinkMax_ms;
+        return static_cast<uint8_t>((period * 24 + 500) / 1000 - 1);
+    }
+
     /**
      * @brief get the output mode uint8_t code for a pin state and setpoint
      */
-    uint8_t getOutputMode(enums::ToffOn *_state, Tuint8 *_setpoint)
+    uint8_t getOutputMode(enums::ToffOn *_state, Tuint8 *_setpoint, uint8_t _channel)
     {
         if (*_state == enums::ToffOn::off || _setpoint->value() == 0)
             return FoutputModeOff;
+        else if (isBlinking(_channel))
+            return FoutputModeGroup;
         else if (*_state == enums::ToffOn::on && _setpoint->value() == MAX)
             return FoutputModeOn;
         else
@@ -208,14 +248,28 @@ private:
     }
 
     // set sdds value
-    void setValue(Tuint8 *_setpoint, enums::ToffOn *_state, Tvalue *_value)
+    void setValue(Tuint8 *_setpoint, enums::ToffOn *_state, Tvalue *_value, uint8_t _channel)
     {
-        if ((*_state == enums::ToffOn::off || _setpoint->value() == 0) && *_value != Tvalue::OFF)
-            *_value = Tvalue::OFF;
-        else if (*_state == enums::ToffOn::on && _setpoint->value() >= MAX && *_value != Tvalue::ON)
-            *_value = Tvalue::ON;
-        else if (*_state == enums::ToffOn::on && _setpoint->value() < MAX && *_value != Tvalue::DIMMED)
-            *_value = Tvalue::DIMMED;
+        if (*_state == enums::ToffOn::off || _setpoint->value() == 0)
+        {
+            if (*_value != Tvalue::OFF)
+                *_value = Tvalue::OFF;
+        }
+        else if (isBlinking(_channel))
+        {
+            if (*_value != Tvalue::PULSED)
+                *_value = Tvalue::PULSED;
+        }
+        else if (*_state == enums::ToffOn::on && _setpoint->value() >= MAX)
+        {
+            if (*_value != Tvalue::ON)
+                *_value = Tvalue::ON;
+        }
+        else if (*_state == enums::ToffOn::on && _setpoint->value() < MAX)
+        {
+            if (*_value != Tvalue::DIMMED)
+                *_value = Tvalue::DIMMED;
+        }
     }
 
     // reset sdds values after disconnect
@@ -250,10 +304,15 @@ public:
     sdds_var(Tuint8, setpoint4, sdds::opt::nothing, 255);
     sdds_var(enums::ToffOn, state4);
     sdds_var(Tvalue, value4, sdds::opt::readonly);
+    sdds_var(Tuint8, blink, sdds::opt::nothing, 0);           // channels pulsed by the group blinking (bit 0 = channel 1)
+    sdds_var(Tuint16, blinkPeriod_ms, sdds::opt::nothing, 0); // group blink period (42 ms to 10.7 s, 0 = no blinking)
+    sdds_var(Tuint8, blinkDuty, sdds::opt::nothing, 128);     // group blink duty cycle (0-255)
 
     // constructor
     ThardwarePwmPCA9633()
     {
+        // fast-mode (the chip supports fast-mode plus but Device OS tops out at 400 kHz)
+        clock_kHz = 400;
 
         // connection status
         on(status)
@@ -31,22 +31,10 @@ protected:
      */
     virtual uint8_t readRegister(uint8_t *_value)
     {
-        uint8_t transmitCode = SYSTEM_ERROR_NONE;
-        // lock for thread safety
-        WITH_LOCK(Wire)
-        {
-            const uint8_t bytesRequested = 1;
-            uint8_t request = Wire.requestFrom(Fi2cAddress, bytesRequested);
-            if (request == bytesRequested && Wire.available())
-            {
-                *_value = Wire.read();
-                *_value &= 0x7F; // mask to 7 bits
-            }
-            else
-                // custom error: did not receive the expected number of bytes
-                return 0xff;
-        }
-        return SYSTEM_ERROR_NONE;
+        uint8_t transmitCode = request(nullptr, 0, _value, 1);
+        if (transmitCode == SYSTEM_ERROR_NONE)
+            *_value &= 0x7F; // mask to 7 bits
+        return transmitCode;
     }
 
     /**
@@ -55,15 +43,7 @@ protected:
      */
     virtual uint8_t writeRegister(uint8_t _value)
     {
-        uint8_t transmitCode = SYSTEM_ERROR_NONE;
-        // lock for thread safety
-        WITH_LOCK(Wire)
-        {
-            Wire.beginTransmission(Fi2cAddress);
-            Wire.write(_value);
-            transmitCode = Wire.endTransmission();
-        }
-        return transmitCode;
+        return transmit(&_value, 1);
     }
 
 private:
@@ -83,6 +63,7 @@ private:
 
         // update sdds vars
         steps = read;
+        setShadow(0, read);
 
         // everything in order
         return true;
@@ -90,14 +71,33 @@ private:
 
     /**
      * @brief writes the wiper value
+     * skips the write if the wiper is unchanged and only reads back when verification is due
      */
     bool writeWiperValue()
     {
-        uint8_t transmitCode = writeRegister(steps.value());
-        if (transmitCode != SYSTEM_ERROR_NONE)
+        bool readBack = verifyDue(registerMask(0));
+        uint8_t transmitCode;
+        if (isShadowed(0, steps.value()))
         {
-            Log.trace("could not write wiper value %d", steps.value());
-            return false;
+            // wiper already at this value
+            skip();
+        }
+        else
+        {
+            transmitCode = writeRegister(steps.value());
+            if (transmitCode != SYSTEM_ERROR_NONE)
+            {
+                Log.trace("could not write wiper value %d", steps.value());
+                return false;
+            }
+        }
+
+        // no need to read back?
+        if (!readBack)
+        {
+            skip();
+            setShadow(0, steps.value());
+            return true;
         }
 
         // read back modes to check if they match
@@ -118,6 +118,8 @@ private:
         }
 
         // everything in order
+        verified(registerMask(0));
+        setShadow(0, read);
         return true;
     }
 
@@ -153,6 +155,10 @@ public:
     // constructor
     ThardwareRheostat()
     {
+        // gain changes are time critical
+        Fpriority = Priority::URGENT;
+        clock_kHz = 400; // fast-mode (all supported rheostats)
+
         on(steps)
         {
             if (steps > maxSteps)
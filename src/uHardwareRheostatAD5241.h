@@ -18,33 +18,17 @@ protected:
     // I2C frame (instruction byte + 8-bit data byte) and an 8-bit (256-position) wiper register
     virtual uint8_t writeRegister(uint8_t _value) override
     {
-        uint8_t transmitCode = SYSTEM_ERROR_NONE;
-        // lock for thread safety
-        WITH_LOCK(Wire)
-        {
-            Wire.beginTransmission(Fi2cAddress);
-            Wire.write(RHEOSTAT_AD5241_WRITE_INSTRUCTION); // instruction byte
-            Wire.write(_value);                            // data byte (wiper position 0-255)
-            transmitCode = Wire.endTransmission();
-        }
-        return transmitCode;
+        const uint8_t bytes[] = {
+            RHEOSTAT_AD5241_WRITE_INSTRUCTION, // instruction byte
+            _value                             // data byte (wiper position 0-255)
+        };
+        return transmit(bytes, 2);
     }
 
     // read the full 8-bit wiper value (no 7-bit masking like the AD5246/MCP4017)
     virtual uint8_t readRegister(uint8_t *_value) override
     {
-        // lock for thread safety
-        WITH_LOCK(Wire)
-        {
-            const uint8_t bytesRequested = 1;
-            uint8_t request = Wire.requestFrom(Fi2cAddress, bytesRequested);
-            if (request == bytesRequested && Wire.available())
-                *_value = Wire.read(); // full 8 bits (256 positions)
-            else
-                // custom error: did not receive the expected number of bytes
-                return 0xff;
-        }
-        return SYSTEM_ERROR_NONE;
+        return request(nullptr, 0, _value, 1);
     }
 
 public:
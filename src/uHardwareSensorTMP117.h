@@ -7,17 +7,39 @@
 // hardware constants
 #define TEMPERATUER_SENSOR_I2C_ADDRESS 0x48
 
-// IO expander: TCA9534 8-channel multiplexer with 1 wire (I2C) commms
+// temperature sensor: TMP117 with on-chip averaging and conversion cycle (continuous conversion mode)
 class ThardwareSensorTMP117 : public ThardwareI2C
 {
 
+public:
+    // enumerations
+    sdds_enum(none, avg8, avg32, avg64) Taveraging;                // AVG[1:0] (samples averaged per conversion)
+    sdds_enum(ms16, ms125, ms250, ms500, s1, s4, s8, s16) Tcycle; // CONV[2:0] (conversion cycle time)
+
 private:
     // registers
     static constexpr uint8_t FpinTempRegister = 0x00; // remperature register
+    static constexpr uint8_t FconfigRegister = 0x01;  // configuration register
+
+    // configuration register bits (see Table 7-7 in datasheet)
+    static constexpr uint16_t FdataReadyFlag = 1 << 13;
+    static constexpr uint8_t FconvShift = 7;
+    static constexpr uint8_t FavgShift = 5;
+
+    // cycle times [ms] for each CONV setting without averaging and minimum cycle for each averaging setting (Table 7-7)
+    static constexpr dtypes::uint16 FcycleTimes_ms[8] = {16, 125, 250, 500, 1000, 4000, 8000, 16000};
+    static constexpr dtypes::uint16 FaveragingTimes_ms[4] = {16, 125, 500, 1000};
 
     // calculation constants
     static constexpr dtypes::float32 FtempCelsiusPerBit = 0.0078125f; // 7.8125 m Celsius per LSB
 
+    // conversion schedule: when the next conversion is done (a configuration write restarts the conversion cycle)
+    dtypes::uint32 FnextConversion_ms = 0;
+
+    // data-ready check: the flag is read with the first read after a configuration and then every FcheckInterval-th read
+    static constexpr uint8_t FcheckInterval = 16;
+    uint8_t FreadsSinceCheck = 0;
+
     // low level interactions with the chip via I2C
 
     /**
@@ -26,30 +48,27 @@ private:
      */
     uint8_t readRegister(uint8_t _register, uint16_t *_value)
     {
-        uint8_t transmitCode = SYSTEM_ERROR_NONE;
-        // lock for thread safety
-        WITH_LOCK(Wire)
-        {
-            Wire.beginTransmission(Fi2cAddress);
-            Wire.write(_register); // flag register for reading
-            // false = keep connection alive instead of stop
-            transmitCode = Wire.endTransmission(false);
-
-            // if it worked, request the uint8_t data
-            if (transmitCode != SYSTEM_ERROR_NONE)
-                return transmitCode;
-
-            const uint8_t bytesRequested = 2;
-            uint8_t request = Wire.requestFrom(Fi2cAddress, bytesRequested);
-            if (request != bytesRequested && Wire.available())
-                // custom error: did not receive the expected number of bytes
-                return 0xff;
-
-            uint8_t msb = Wire.read();
-            uint8_t lsb = Wire.read();
-            *_value = (uint16_t)((msb << 8) | lsb);
-        }
-        return SYSTEM_ERROR_NONE;
+        uint8_t bytes[2];
+        uint8_t transmitCode = request(&_register, 1, bytes, 2);
+        if (transmitCode == SYSTEM_ERROR_NONE)
+            *_value = (uint16_t)((bytes[0] << 8) | bytes[1]);
+        return transmitCode;
+    }
+
+    /**
+     * @brief write a register value (2 bytes = uint16)
+     * @return error code from Wire.endTransmission()
+     */
+    uint8_t writeRegister(uint8_t _register, uint16_t _value)
+    {
+        const uint8_t bytes[] = {_register, (uint8_t)(_value >> 8), (uint8_t)(_value & 0xff)};
+        return transmit(bytes, 3);
+    }
+
+    // conversion settings as stored in bits 9:5 of the configuration register (continuous conversion mode = 00)
+    uint8_t conversionBits()
+    {
+        return (cycle.value() << (FconvShift - FavgShift)) | averaging.value();
     }
 
     // convert raw signal to celsius
@@ -59,27 +78,143 @@ private:
         return static_cast<dtypes::float32>(raw_signed) * FtempCelsiusPerBit;
     }
 
-    // I2C read function
+    // I2C write function: conversion cycle and averaging
+    virtual bool write() override
+    {
+        if (status != enums::TconStatus::connected && !connect())
+            return false;
+
+        // already configured?
+        uint8_t bits = conversionBits();
+        if (isShadowed(FconfigRegister, bits))
+        {
+            skip();
+            return true;
+        }
+
+        uint16_t config = static_cast<uint16_t>(bits) << FavgShift;
+        if (writeRegister(FconfigRegister, config) != SYSTEM_ERROR_NONE)
+            return false;
+
+        // check it was written correctly
+        if (verifyDue(registerMask(FconfigRegister)))
+        {
+            uint16_t read = 0;
+            if (readRegister(FconfigRegister, &read) != SYSTEM_ERROR_NONE)
+                return false;
+            if (((read >> FavgShift) & 0x1F) != bits)
+            {
+                Log.trace("TMP117 configuration not written correctly: 0x%04x", read);
+                return false;
+            }
+            verified(registerMask(FconfigRegister));
+        }
+        setShadow(FconfigRegister, bits);
+        FnextConversion_ms = millis() + cycle_ms();
+        FreadsSinceCheck = FcheckInterval;
+        return true;
+    }
+
+    // I2C read function: only reads the temperature when a new conversion is done (by the schedule, the data-ready flag is a check)
     virtual bool read() override
     {
         if (status != enums::TconStatus::connected && !connect())
             return false;
 
+        // make sure the conversion settings are in place (e.g. after a reconnect)
+        if (!isShadowed(FconfigRegister, conversionBits()) && !write())
+            return false;
+
+        // conversion still running: nothing new to read (no bus traffic)
+        if (static_cast<dtypes::int32>(millis() - FnextConversion_ms) < 0)
+        {
+            notReady++;
+            return true;
+        }
+
+        // data-ready check: is the chip still converting on schedule? (the flag is cleared by reading the configuration or the temperature)
+        if (FreadsSinceCheck + 1 >= FcheckInterval)
+        {
+            uint16_t config = 0;
+            if (readRegister(FconfigRegister, &config) != SYSTEM_ERROR_NONE)
+                return false;
+            if (((config >> FavgShift) & 0x1F) != conversionBits())
+            {
+                // the chip lost its configuration (e.g. a power glitch): configure again, which restarts the conversion cycle
+                Log.trace("TMP117 configuration lost: 0x%04x", config);
+                clearShadow();
+                notReady++;
+                return write();
+            }
+            if (!(config & FdataReadyFlag))
+            {
+                // the chip's clock is behind the schedule: check again a little later
+                notReady++;
+                FnextConversion_ms = millis() + cycle_ms() / 16;
+                return true;
+            }
+            FreadsSinceCheck = 0;
+        }
+        else
+            FreadsSinceCheck++;
+
         uint16_t raw = 0;
         if (readRegister(FpinTempRegister, &raw) != SYSTEM_ERROR_NONE)
             return false;
-
         temperature_C = rawToC(raw);
+
+        // next conversion (see readCycle_ms())
+        FnextConversion_ms = millis() + readCycle_ms();
         return true;
     }
 
 public:
     // sdds vars
     sdds_var(Tfloat32, temperature_C, sdds::opt::readonly, Tfloat32::nan());
+    sdds_var(Taveraging, averaging, sdds::opt::saveval, Taveraging::avg64);
+    sdds_var(Tcycle, cycle, sdds::opt::saveval, Tcycle::s4);
+    sdds_var(Tuint32, notReady, sdds::opt::readonly, 0); // reads before a new conversion was done
 
     // constructor
     ThardwareSensorTMP117()
     {
+        // fast-mode
+        clock_kHz = 400;
+
+        // update the configuration
+        on(averaging)
+        {
+            if (status == enums::TconStatus::connected)
+                action = ThardwareI2C::Taction::write;
+        };
+
+        on(cycle)
+        {
+            if (status == enums::TconStatus::connected)
+                action = ThardwareI2C::Taction::write;
+        };
+    }
+
+    // time between conversions [ms] (averaging can make it longer than the configured cycle)
+    dtypes::uint32 cycle_ms()
+    {
+        dtypes::uint16 cycleTime = FcycleTimes_ms[cycle.value()];
+        dtypes::uint16 averagingTime = FaveragingTimes_ms[averaging.value()];
+        return (averagingTime > cycleTime) ? averagingTime : cycleTime;
+    }
+
+    // time between reads [ms]: the conversion cycle with a small margin that keeps the reads behind the chip's clock
+    // (the reads drift against the conversions and now and then skip one, the data-ready check catches a chip that is slower still)
+    dtypes::uint32 readCycle_ms()
+    {
+        return cycle_ms() + cycle_ms() / 16;
+    }
+
+    // time until the next conversion can be read [ms] (if one can be read now: the one after it)
+    dtypes::uint32 untilNextConversion_ms()
+    {
+        dtypes::int32 wait = static_cast<dtypes::int32>(FnextConversion_ms - millis());
+        return (wait > 0) ? wait : readCycle_ms();
     }
 
     // default i2c address in init
@@ -87,4 +222,8 @@ public:
     {
         ThardwareI2C::init(_i2cAddress);
     }
-};
\ No newline at end of file
+};
+
+// static tables
+constexpr dtypes::uint16 ThardwareSensorTMP117::FcycleTimes_ms[];
+constexpr dtypes::uint16 ThardwareSensorTMP117::FaveragingTimes_ms[];
\ No newline at end of file
@@ -7,7 +7,9 @@
 #include "uComponentOpticalDensity.h"
 #include "uComponentLights.h"
 #include "uComponentEnvironment.h"
-#include "symbols.h"
+#include "uComponentHistory.h"
+#include "uComponentFlashLog.h"
+#include "uMicroLoggerScreen.h"
 
 /**
  * @brief
@@ -23,6 +25,7 @@ public:
     using TlightsEvent = TcomponentLights::Tevent;
     using TstirrerEvent = TcomponentStirrer::Tevent;
     using TstirrerStatus = TcomponentStirrer::Tstatus;
+    using TprotocolStatus = TcomponentStirrer::Tprotocol::Tstatus;
     using TodStatus = TcomponentOpticalDensity::Tstatus;
     using TodError = TcomponentOpticalDensity::Terror;
     using Tdisplay = ThardwareDisplay;
@@ -31,152 +34,189 @@ public:
 private:
     // timers
     Ttimer FvortexTimer;
-    Ttimer FdisplayTimer;
-
-    // display update function
-    void refreshDisplay()
+    Ttimer FdisplayTimer;   // next (rate limited) redraw
+    Ttimer FcountdownTimer; // slow periodic redraw of the countdown fields
+
+    // what the display shows (redrawn region by region, only when something in a region changes)
+    using Tscreen = TmicroLoggerScreen;
+    Tscreen Fscreen;
+    dtypes::uint8 Fdirty = Tscreen::ALL;
+    bool FdisplayStarted = false;
+    dtypes::TtickCount FlastRefresh = 0;
+
+    // which page is up (full redraw when it changes)
+    Tscreen::Tpage Fpage = Tscreen::Tpage::MAIN;
+
+    // OD sparkline columns (see Tscreen), scaled to the OD range of the readings it shows
+    dtypes::uint8 Fplot[Tscreen::plotWidth];
+    dtypes::float32 FplotMin = 0;
+    dtypes::float32 FplotMax = 0;
+    bool FplotAll = true;
+    dtypes::uint8 FplotFrom = Tscreen::plotNone; // first column changed since the last frame
+    dtypes::uint8 FplotTo = 0;
+
+    // stirrer speed while stirring (reads usually pause the stirrer)
+    dtypes::uint16 FstirSpeed = 0;
+
+    // stirrer speed as the display shows it (rounded so the tachometer jitter does not redraw the screen)
+    static constexpr dtypes::uint16 FshownSpeedStep_rpm = 10;
+    dtypes::uint16 FshownSpeed_rpm = 0;
+    static dtypes::uint16 shownSpeed(dtypes::uint16 _rpm)
     {
-        hardware().display.clearDisplay();
-        hardware().display.setCursor(0, 0);
-        char buf[16]; // snprintf buffer
-
-        // wifi?
-        if (particleSystem().internet == TparticleSystem::TinternetStatus::connected)
-            hardware().display.drawIcon(wifi_icon, wifi_icon_width);
-        else
-            hardware().display.drawIcon(no_wifi_icon, no_wifi_icon_width);
+        return (_rpm + FshownSpeedStep_rpm / 2) / FshownSpeedStep_rpm * FshownSpeedStep_rpm;
+    }
 
-        // publishing? (don't show the "not publishing", it's not as informative)
-        if (particleSystem().publishing.record == TonOff::ON)
-            hardware().display.drawIcon(publishing_icon, publishing_icon_width);
+    /**
+     * @brief mark display regions dirty and schedule a redraw (at most once every minRefresh_ms)
+     */
+    void markDirty(dtypes::uint8 _regions)
+    {
+        Fdirty |= _regions;
+        if (!FdisplayStarted || FdisplayTimer.running())
+            return;
+        dtypes::TtickCount since = millis() - FlastRefresh;
+        dtypes::TtickCount min = hardware().display.minRefresh_ms;
+        FdisplayTimer.start((since < min) ? min - since : 0);
+    }
 
-        // device name
-        if (particleSystem().name == "")
-            hardware().display.printLine(Tdisplay::headerY, "connecting...");
-        else
-            hardware().display.printLine(Tdisplay::headerY, particleSystem().name);
+    // copy a string into a snapshot field
+    template <size_t N>
+    static void copy(char (&_to)[N], const char *_from)
+    {
+        strncpy(_to, _from, N - 1);
+        _to[N - 1] = 0;
+    }
 
-        // enough power?
+    // take the display snapshot on the main loop (the frame worker never reads sdds variables)
+    void snapshot()
+    {
+        Tscreen::Tpage page = (history.sparkline == enums::ToffOn::on) ? Tscreen::Tpage::TREND : Tscreen::Tpage::MAIN;
         if (environment.powerReq_V > environment.power_V)
+            page = Tscreen::Tpage::NO_POWER;
+        else if (device == enums::TconStatus::disconnected)
+            page = Tscreen::Tpage::DISCONNECTED;
+        if (page != Fpage || page == Tscreen::Tpage::NO_POWER || page == Tscreen::Tpage::DISCONNECTED)
         {
-            hardware().display.drawIcon(alert_icon, alert_icon_width);
-            hardware().display.printLine(Tdisplay::line2Y, "not enough power!", Tdisplay::align::CENTER);
-            hardware().display.printLine(Tdisplay::line4Y, "connect to 24V supply", Tdisplay::align::CENTER);
-            return;
+            Fpage = page;
+            Fdirty = Tscreen::ALL;
         }
+        Tscreen::Tsnapshot &frame = Fscreen.frame;
+        frame.dirty = Fdirty;
+        frame.page = page;
+
+        // header
+        frame.wifi = (particleSystem().internet == TparticleSystem::TinternetStatus::connected);
+        frame.publishing = (particleSystem().publishing.record == TonOff::ON);
+        frame.alert = (device == enums::TconStatus::disconnected || sensor.error != TodError::none || stirrer.status == TstirrerStatus::error || environment.error != TtempError::none || lights.status == TlightsStatus::error || lights.fan.status == TlightsStatus::error);
+        copy(frame.name, particleSystem().name.c_str());
+
+        // optical density
+        frame.zeroValid = (sensor.zero.valid == enums::TnoYes::yes);
+        frame.odNan = sensor.reading.OD.isNan();
+        frame.od = sensor.reading.OD.value();
+        frame.saturation = sensor.reading.saturation_ppt.value();
+        frame.odError = sensor.error.value();
+        frame.odStatus = sensor.status.value();
+        copy(frame.nextRead, sensor.reading.nextRead.c_str());
+
+        // stirrer
+        frame.stirrerStatus = stirrer.status.value();
+        frame.stirrerEvent = stirrer.event.value();
+        frame.protocol = (stirrer.protocol.status == TprotocolStatus::running);
+        FshownSpeed_rpm = shownSpeed(stirrer.speed_rpm.value());
+        frame.speed = FshownSpeed_rpm;
+        frame.setpoint = stirrer.setpoint_rpm.value();
+        frame.segment = stirrer.protocol.segment.value();
+        frame.segmentsN = stirrer.protocol.segmentsN.value();
+
+        // power and temperature
+        frame.power = environment.power_V.value();
+        frame.temperature = environment.temperature_C.value();
+        frame.tempError = (environment.error != TtempError::none);
+
+        // lights and fan
+        frame.lightsStatus = lights.status.value();
+        frame.lightsState = lights.state.value();
+        frame.lightsEvent = lights.event.value();
+        frame.intensity = lights.intensity_percent.value();
+        frame.pulsePeriod = lights.pulsePeriod_ms.value();
+        frame.countdown = lights.nextTransition(frame.lightsInfo, sizeof(frame.lightsInfo));
+        if (!frame.countdown)
+            copy(frame.lightsInfo, lights.scheduleInfo.c_str());
+        frame.fanStatus = lights.fan.status.value();
+        frame.fanState = lights.fan.state.value();
+        frame.fanDuty = lights.fan.duty_percent.value();
+
+        // publish
+        copy(frame.nextPublish, particleSystem().publishing.nextGlobalPublish.c_str());
+
+        // OD sparkline
+        memcpy(frame.plot, Fplot, sizeof(Fplot));
+        frame.plotAll = FplotAll || (FplotFrom == Tscreen::plotNone);
+        frame.plotFrom = FplotFrom;
+        frame.plotTo = FplotTo;
+        FplotAll = false;
+        FplotFrom = Tscreen::plotNone;
+    }
 
-        // device connected? --> print message if not
-        if (device == enums::TconStatus::disconnected)
-        {
-            hardware().display.drawIcon(alert_icon, alert_icon_width);
-            hardware().display.printLine(Tdisplay::line3Y, "connect to reader", Tdisplay::align::CENTER);
-            return;
-        }
-
-        // alert if here are any issues
-        if (device == enums::TconStatus::disconnected || sensor.error != TodError::none || stirrer.status == TstirrerStatus::error || environment.error != TtempError::none || lights.status == TlightsStatus::error || lights.fan.status == TlightsStatus::error)
-            hardware().display.drawIcon(alert_icon, alert_icon_width);
-
-        // optical density -left
-        if (sensor.zero.valid == enums::TnoYes::yes)
-        {
-            if (!sensor.reading.OD.isNan())
-                if (sensor.reading.OD.value() > -0.0005 && sensor.reading.OD.value() < 0.0005) // basically zero
-                    snprintf(buf, sizeof(buf), "OD:0.000");
-                else
-                    snprintf(buf, sizeof(buf), "OD:%.3f", sensor.reading.OD.value());
-            else
-                snprintf(buf, sizeof(buf), "OD:no data");
-            hardware().display.printLine(Tdisplay::line1Y, buf);
-        }
-        else if (sensor.status == TodStatus::waiting)
-            hardware().display.printLine(Tdisplay::line1Y, "Zero ready");
-        else
-            hardware().display.printLine(Tdisplay::line1Y, "SAT:" + sensor.reading.saturation_ppt.to_string());
-
-        // optical density - right
-        if (sensor.error != TodError::none)
-            hardware().display.printLine(Tdisplay::line1Y, sensor.error.to_string(), Tdisplay::offsetX);
-        else if (sensor.zero.valid != enums::TnoYes::yes && sensor.status == TodStatus::idle)
-            hardware().display.printLine(Tdisplay::line1Y, "zero me", Tdisplay::offsetX);
-        else if (sensor.zero.valid != enums::TnoYes::yes && sensor.status == TodStatus::waiting)
-            hardware().display.printLine(Tdisplay::line1Y, dtypes::string("in ") + sensor.reading.nextRead.c_str(), Tdisplay::offsetX);
-        else if (sensor.zero.valid == enums::TnoYes::yes && sensor.status == TodStatus::idle)
-            hardware().display.printLine(Tdisplay::line1Y, dtypes::string("in ") + sensor.reading.nextRead.c_str(), Tdisplay::offsetX);
-        else
-            hardware().display.printLine(Tdisplay::line1Y, sensor.status.to_string(), Tdisplay::offsetX);
-
-        // stirrer speed
-        if (stirrer.status == TstirrerStatus::off)
-            hardware().display.printLine(Tdisplay::line2Y, "RPM:off");
-        else
-            hardware().display.printLine(Tdisplay::line2Y, "RPM:" + stirrer.speed_rpm.to_string());
-
-        // stirrer event
-        if (stirrer.event != TstirrerEvent::none)
-            hardware().display.printLine(Tdisplay::line2Y, stirrer.event.to_string(), Tdisplay::offsetX);
-        else
-            hardware().display.printLine(Tdisplay::line2Y, "SP:" + stirrer.setpoint_rpm.to_string() + "rpm", Tdisplay::offsetX);
-
-        // power
-        snprintf(buf, sizeof(buf), "PWR:%.1fV", environment.power_V.value());
-        hardware().display.printLine(Tdisplay::line3Y, buf);
+    // sparkline height of an OD value
+    dtypes::uint8 plotY(dtypes::float32 _od)
+    {
+        if (std::isnan(_od))
+            return Tscreen::plotNone;
+        dtypes::float32 y = (_od - FplotMin) / (FplotMax - FplotMin) * (Tscreen::plotHeight - 1);
+        return static_cast<dtypes::uint8>((y < 0) ? 0 : (y > Tscreen::plotHeight - 1) ? Tscreen::plotHeight - 1 : y + 0.5f);
+    }
 
-        // temperature
-        if (environment.error != TtempError::none)
-            hardware().display.printLine(Tdisplay::line3Y, "Temp:error", Tdisplay::offsetX);
-        else
+    // fit the sparkline to the readings it shows and redo all columns
+    void rescalePlot()
+    {
+        const TcomponentHistory::Tdata &data = history.data();
+        dtypes::uint16 n = (data.size() < Tscreen::plotWidth - 1) ? data.size() : Tscreen::plotWidth - 1;
+        FplotMin = Tfloat32::nan();
+        FplotMax = Tfloat32::nan();
+        for (dtypes::uint16 i = 0; i < n; i++)
         {
-            snprintf(buf, sizeof(buf), "Temp:%.1fC", environment.temperature_C.value());
-            hardware().display.printLine(Tdisplay::line3Y, buf, Tdisplay::offsetX);
+            dtypes::float32 od = data.at(i).OD();
+            if (std::isnan(od))
+                continue;
+            if (std::isnan(FplotMin) || od < FplotMin)
+                FplotMin = od;
+            if (std::isnan(FplotMax) || od > FplotMax)
+                FplotMax = od;
         }
 
-        // light status
-        if (lights.status == TlightsStatus::on)
-            hardware().display.printLine(Tdisplay::line4Y, "Light:" + lights.intensity_percent.to_string() + "%");
-        else if (lights.status == TlightsStatus::off)
-            hardware().display.printLine(Tdisplay::line4Y, "Light:off");
-        else if (lights.status == TlightsStatus::error)
-            hardware().display.printLine(Tdisplay::line4Y, "Light:ERR");
-
-        // light state
-        if (lights.event != TlightsEvent::none)
-            hardware().display.printLine(Tdisplay::line4Y, lights.event.to_string(), Tdisplay::offsetX);
-        else if (lights.state == TlightsState::on)
-            hardware().display.printLine(Tdisplay::line4Y, "always on", Tdisplay::offsetX);
-        else if (lights.state == TlightsState::off)
-            hardware().display.printLine(Tdisplay::line4Y, "always off", Tdisplay::offsetX);
-        else if (lights.state == TlightsState::schedule)
-            hardware().display.printLine(Tdisplay::line4Y, lights.scheduleInfo.c_str(), Tdisplay::offsetX);
-
-        // fan status
-        if (lights.fan.status == TlightsStatus::on)
-            hardware().display.printLine(Tdisplay::line5Y, "Fan:on");
-        else if (lights.fan.status == TlightsStatus::off)
-            hardware().display.printLine(Tdisplay::line5Y, "Fan:off");
-        else if (lights.fan.status == TlightsStatus::error)
-            hardware().display.printLine(Tdisplay::line5Y, "Fan:ERR");
-
-        // fan state
-        if (lights.fan.state == TfanState::on)
-            hardware().display.printLine(Tdisplay::line5Y, "always on", Tdisplay::offsetX);
-        else if (lights.fan.state == TfanState::off)
-            hardware().display.printLine(Tdisplay::line5Y, "always off", Tdisplay::offsetX);
-        else if (lights.fan.state == TfanState::withLight)
-            hardware().display.printLine(Tdisplay::line5Y, "with light", Tdisplay::offsetX);
-
-        // data information
-        hardware().display.printLine(Tdisplay::line6Y, "Publish:");
-        if (particleSystem().publishing.record == TonOff::ON)
-        {
-            hardware().display.printLine(Tdisplay::line6Y, dtypes::string("in ") + particleSystem().publishing.nextGlobalPublish.c_str(), Tdisplay::offsetX);
-        }
+        // some headroom (and at least 0.01 OD so noise doesn't fill the plot)
+        dtypes::float32 margin = (FplotMax - FplotMin) * 0.1f;
+        if (FplotMax - FplotMin + 2 * margin < 0.01f)
+            margin = (0.01f - (FplotMax - FplotMin)) / 2;
+        FplotMin -= margin;
+        FplotMax += margin;
+
+        memset(Fplot, Tscreen::plotNone, sizeof(Fplot));
+        for (dtypes::uint16 i = 0; i < n; i++)
+            Fplot[(data.total() - 1 - i) % Tscreen::plotWidth] = plotY(data.at(i).OD());
+        FplotAll = true;
+    }
+
+    // add the newest reading to the sparkline (only its column and the gap after it change, unless it's off scale)
+    void plotReading()
+    {
+        const TcomponentHistory::Tdata &data = history.data();
+        dtypes::float32 od = data.at(0).OD();
+        if (!std::isnan(od) && (!(FplotMax > FplotMin) || od < FplotMin || od > FplotMax))
+            rescalePlot();
         else
         {
-            hardware().display.printLine(Tdisplay::line6Y, "off", Tdisplay::offsetX);
+            dtypes::uint8 x = (data.total() - 1) % Tscreen::plotWidth;
+            dtypes::uint8 gap = (x + 1) % Tscreen::plotWidth;
+            Fplot[x] = plotY(od);
+            Fplot[gap] = Tscreen::plotNone;
+            if (FplotFrom == Tscreen::plotNone)
+                FplotFrom = x;
+            FplotTo = gap;
         }
-
-        hardware().display.drawLayoutLines();
+        markDirty(Tscreen::TREND);
     }
 
 public:
@@ -189,6 +229,8 @@ public:
     sdds_var(TcomponentStirrer, stirrer);
     sdds_var(TcomponentLights, lights);
     sdds_var(TcomponentEnvironment, environment);
+    sdds_var(TcomponentHistory, history);
+    sdds_var(TcomponentFlashLog, flashLog);
 
     TmicroLogger()
     {
@@ -196,6 +238,9 @@ public:
         // make sure hardware is initalized
         hardware();
 
+        // no readings in the sparkline yet
+        memset(Fplot, Tscreen::plotNone, sizeof(Fplot));
+
         // set references for OD component to be able to pause the others
         sensor.setStirrer(&stirrer);
         sensor.setLights(&lights);
@@ -238,16 +283,193 @@ public:
         {
             if (hardware().display.startup == Tdisplay::Tstartup::complete)
             {
-                FdisplayTimer.start(0);
+                FdisplayStarted = true;
+                markDirty(Tscreen::ALL);
+                FcountdownTimer.start(hardware().display.refresh_ms);
             }
         };
 
-        // regular display refresh
+        // frames are drawn from a snapshot by the display's frame worker
+        hardware().display.renderWith([this]()
+                                      { Fscreen.render(hardware().display); });
+
+        // redraw what changed (if the last frame is still in flight, the next one is taken when it's done)
         on(FdisplayTimer)
         {
-            refreshDisplay();
-            hardware().display.action = Tdisplay::Taction::write;
-            FdisplayTimer.start(hardware().display.refresh_ms);
+            if (hardware().display.rendering())
+                return;
+            snapshot();
+            if (hardware().display.requestFrame())
+            {
+                Fdirty = 0;
+                FlastRefresh = millis();
+            }
+        };
+
+        // frame done, anything that changed in the meantime is next
+        on(hardware().display.frames)
+        {
+            if (Fdirty)
+                markDirty(0);
+        };
+
+        // countdowns (next read, light transition, next publish) only need a slow refresh
+        on(FcountdownTimer)
+        {
+            markDirty(Tscreen::countdowns);
+            FcountdownTimer.start(hardware().display.refresh_ms);
+        };
+
+        // header (and the alert icon)
+        on(device)
+        {
+            markDirty(Tscreen::ALL);
+        };
+        on(particleSystem().internet)
+        {
+            markDirty(Tscreen::HEADER);
+        };
+        on(particleSystem().name)
+        {
+            markDirty(Tscreen::HEADER);
+        };
+        on(particleSystem().publishing.record)
+        {
+            markDirty(Tscreen::HEADER | Tscreen::PUBLISH);
+        };
+        on(sensor.error)
+        {
+            markDirty(Tscreen::HEADER | Tscreen::OD);
+        };
+        on(stirrer.status)
+        {
+            markDirty(Tscreen::HEADER | Tscreen::STIRRER);
+        };
+        on(environment.error)
+        {
+            markDirty(Tscreen::HEADER | Tscreen::ENVIRONMENT);
+        };
+        on(lights.status)
+        {
+            markDirty(Tscreen::HEADER | Tscreen::LIGHTS);
+        };
+        on(lights.fan.status)
+        {
+            markDirty(Tscreen::HEADER | Tscreen::FAN);
+        };
+
+        // optical density
+        on(sensor.status)
+        {
+            markDirty(Tscreen::OD);
+        };
+        on(sensor.zero.valid)
+        {
+            markDirty(Tscreen::OD);
+        };
+        on(sensor.reading.OD)
+        {
+            markDirty(Tscreen::OD);
+        };
+        on(sensor.reading.saturation_ppt)
+        {
+            markDirty(Tscreen::OD);
+        };
+
+        // stirrer
+        on(stirrer.speed_rpm)
+        {
+            if (shownSpeed(stirrer.speed_rpm.value()) != FshownSpeed_rpm)
+                markDirty(Tscreen::STIRRER);
+        };
+        on(stirrer.setpoint_rpm)
+        {
+            markDirty(Tscreen::STIRRER);
+        };
+        on(stirrer.event)
+        {
+            markDirty(Tscreen::STIRRER);
+        };
+        on(stirrer.protocol.status)
+        {
+            markDirty(Tscreen::STIRRER);
+        };
+        on(stirrer.protocol.segment)
+        {
+            markDirty(Tscreen::STIRRER);
+        };
+
+        // power and temperature (the power also decides which screen is up)
+        on(environment.power_V)
+        {
+            markDirty(Tscreen::ENVIRONMENT);
+        };
+        on(environment.powerReq_V)
+        {
+            markDirty(Tscreen::ENVIRONMENT);
+        };
+        on(environment.temperature_C)
+        {
+            markDirty(Tscreen::ENVIRONMENT);
+        };
+
+        // lights and fan
+        on(lights.state)
+        {
+            markDirty(Tscreen::LIGHTS);
+        };
+        on(lights.event)
+        {
+            markDirty(Tscreen::LIGHTS);
+        };
+        on(lights.intensity_percent)
+        {
+            markDirty(Tscreen::LIGHTS);
+        };
+        on(lights.scheduleInfo)
+        {
+            markDirty(Tscreen::LIGHTS);
+        };
+        on(lights.pulsePeriod_ms)
+        {
+            markDirty(Tscreen::LIGHTS);
+        };
+        on(lights.fan.state)
+        {
+            markDirty(Tscreen::FAN);
+        };
+        on(lights.fan.duty_percent)
+        {
+            markDirty(Tscreen::FAN);
+        };
+
+        // history, flash log and OD sparkline (ODSd is set right after OD with every read)
+        on(stirrer.speed_rpm)
+        {
+            if (stirrer.event == TstirrerEvent::none)
+                FstirSpeed = stirrer.speed_rpm.value();
+        };
+        on(sensor.reading.ODSd)
+        {
+            dtypes::uint16 speed = (stirrer.state == enums::ToffOn::on) ? FstirSpeed : 0;
+            history.add(sensor.reading.OD.value(), sensor.reading.ODSd.value(), environment.temperature_C.value(), speed);
+            flashLog.add(sensor.reading.OD.value(), sensor.reading.ODSd.value(), environment.temperature_C.value(), speed, environment.power_V.value());
+            plotReading();
+        };
+        on(history.records)
+        {
+            // cleared
+            if (history.records == 0)
+            {
+                memset(Fplot, Tscreen::plotNone, sizeof(Fplot));
+                FplotMin = FplotMax = 0;
+                FplotAll = true;
+                markDirty(Tscreen::TREND);
+            }
+        };
+        on(history.sparkline)
+        {
+            markDirty(Tscreen::ALL);
         };
     }
 };
@@ -0,0 +1,371 @@
+#pragma once
+
+#include "uTypedef.h"
+#include "uHardwareDisplay.h"
+#include "uComponentStirrer.h"
+#include "uComponentOpticalDensity.h"
+#include "uComponentLights.h"
+#include "uComponentEnvironment.h"
+#include "symbols.h"
+
+/**
+ * @brief the micrologger screen: a snapshot of everything it shows and how it's drawn
+ * (drawing never reads sdds variables, so it runs on the display's frame worker or in the display test program)
+ */
+class TmicroLoggerScreen
+{
+
+public:
+    // enumerations
+    using TfanState = TcomponentLights::Tfan::Tstate;
+    using TlightsState = TcomponentLights::Tstate;
+    using TlightsStatus = TcomponentLights::Tstatus;
+    using TlightsEvent = TcomponentLights::Tevent;
+    using TstirrerEvent = TcomponentStirrer::Tevent;
+    using TstirrerStatus = TcomponentStirrer::Tstatus;
+    using TodStatus = TcomponentOpticalDensity::Tstatus;
+    using TodError = TcomponentOpticalDensity::Terror;
+    using Tdisplay = ThardwareDisplay;
+
+    // display regions (redrawn only when something they show changes)
+    enum Tregion : dtypes::uint8
+    {
+        HEADER = 1 << 0,
+        OD = 1 << 1,
+        STIRRER = 1 << 2,
+        ENVIRONMENT = 1 << 3,
+        LIGHTS = 1 << 4,
+        FAN = 1 << 5,
+        PUBLISH = 1 << 6,
+        TREND = 1 << 7,
+        ALL = 0xff
+    };
+    static constexpr dtypes::uint8 countdowns = OD | LIGHTS | PUBLISH; // regions with countdowns
+
+    // which page is up
+    enum class Tpage
+    {
+        MAIN,
+        TREND,
+        NO_POWER,
+        DISCONNECTED
+    };
+
+    // OD sparkline below the OD line (one column per reading, drawn as a sweep with a gap after the newest
+    // column so a new reading only changes two columns)
+    static constexpr dtypes::uint8 plotWidth = 128;
+    static constexpr dtypes::uint8 plotTop = Tdisplay::line2Y;
+    static constexpr dtypes::uint8 plotHeight = 64 - plotTop;
+    static constexpr dtypes::uint8 plotNone = 0xff;
+
+    // everything the screen shows
+    struct Tsnapshot
+    {
+        dtypes::uint8 dirty;
+        Tpage page;
+
+        // header
+        bool wifi;
+        bool publishing;
+        bool alert;
+        char name[32];
+
+        // optical density
+        bool zeroValid;
+        bool odNan;
+        dtypes::float32 od;
+        int saturation;
+        TodError::e odError;
+        TodStatus::e odStatus;
+        char nextRead[12];
+
+        // stirrer
+        TstirrerStatus::e stirrerStatus;
+        TstirrerEvent::e stirrerEvent;
+        bool protocol;
+        int speed;
+        int setpoint;
+        int segment;
+        int segmentsN;
+
+        // power and temperature
+        dtypes::float32 power;
+        dtypes::float32 temperature;
+        bool tempError;
+
+        // lights and fan
+        TlightsStatus::e lightsStatus;
+        TlightsState::e lightsState;
+        TlightsEvent::e lightsEvent;
+        int intensity;
+        int pulsePeriod;
+        bool countdown;
+        char lightsInfo[16];
+        TlightsStatus::e fanStatus;
+        TfanState::e fanState;
+        int fanDuty;
+
+        // publish
+        char nextPublish[12];
+
+        // OD sparkline
+        dtypes::uint8 plot[plotWidth]; // height of each column above the bottom of the plot (plotNone = no data)
+        bool plotAll;                  // redraw all columns (e.g. after a rescale)
+        dtypes::uint8 plotFrom;        // otherwise redraw from this column
+        dtypes::uint8 plotTo;          // ... to this one (wrapping around)
+    } frame;
+
+    // draw the snapshot
+    void render(Tdisplay &_display)
+    {
+        if (frame.dirty == ALL)
+            _display.clearDisplay();
+        _display.setCursor(0, 0);
+
+        // header
+        if (frame.dirty & HEADER)
+        {
+            _display.clearRegion(0, Tdisplay::dividerY);
+            renderHeader(_display);
+        }
+
+        // full screen messages
+        if (frame.page == Tpage::NO_POWER)
+        {
+            _display.drawIcon(alert_icon, alert_icon_width);
+            _display.printLine(Tdisplay::line2Y, "not enough power!", Tdisplay::align::CENTER);
+            _display.printLine(Tdisplay::line4Y, "connect to 24V supply", Tdisplay::align::CENTER);
+            return;
+        }
+        if (frame.page == Tpage::DISCONNECTED)
+        {
+            _display.drawIcon(alert_icon, alert_icon_width);
+            _display.printLine(Tdisplay::line3Y, "connect to reader", Tdisplay::align::CENTER);
+            return;
+        }
+
+        // OD trend
+        if (frame.page == Tpage::TREND)
+        {
+            if (frame.dirty & OD)
+            {
+                _display.clearRegion(Tdisplay::line1Y, Tdisplay::line2Y - Tdisplay::line1Y);
+                renderLine(_display, OD);
+            }
+            if (frame.dirty & TREND)
+                renderPlot(_display);
+            _display.drawLine(0, Tdisplay::dividerY, _display.width(), Tdisplay::dividerY, 1);
+            return;
+        }
+
+        // lines
+        const uint16_t lines[] = {Tdisplay::line1Y, Tdisplay::line2Y, Tdisplay::line3Y, Tdisplay::line4Y, Tdisplay::line5Y, Tdisplay::line6Y};
+        for (dtypes::uint8 i = 0; i < 6; i++)
+        {
+            dtypes::uint8 region = OD << i;
+            if (!(frame.dirty & region))
+                continue;
+            _display.clearRegion(lines[i], Tdisplay::line2Y - Tdisplay::line1Y);
+            renderLine(_display, region);
+        }
+        _display.drawLayoutLines();
+    }
+
+private:
+    // enum names for the display, in enum order (to_string() would put a String on the heap with every redraw)
+    static constexpr const char *FodErrors[] = {"none", "saturated", "failedGain", "failedZero", "failedRead"};
+    static constexpr const char *FodStatuses[] = {"idle", "reading", "optimizing", "waiting", "zeroing"};
+    static constexpr const char *FstirrerEvents[] = {"none", "paused", "vortexing", "recovering"};
+    static constexpr const char *FlightsEvents[] = {"none", "paused"};
+    template <size_t N>
+    static const char *name(const char *const (&_names)[N], int _value)
+    {
+        return (_value >= 0 && static_cast<size_t>(_value) < N) ? _names[_value] : "?";
+    }
+
+    // header: icons and device name
+    void renderHeader(Tdisplay &_display)
+    {
+        // wifi?
+        if (frame.wifi)
+            _display.drawIcon(wifi_icon, wifi_icon_width);
+        else
+            _display.drawIcon(no_wifi_icon, no_wifi_icon_width);
+
+        // publishing? (don't show the "not publishing", it's not as informative)
+        if (frame.publishing)
+            _display.drawIcon(publishing_icon, publishing_icon_width);
+
+        // device name
+        if (frame.name[0] == 0)
+            _display.printLine(Tdisplay::headerY, "connecting...");
+        else
+            _display.printLine(Tdisplay::headerY, frame.name);
+
+        // alert if here are any issues (the full screen messages draw their own)
+        if (frame.alert && frame.page != Tpage::NO_POWER && frame.page != Tpage::DISCONNECTED)
+            _display.drawIcon(alert_icon, alert_icon_width);
+    }
+
+    // one line of the main screen
+    void renderLine(Tdisplay &_display, dtypes::uint8 _region)
+    {
+        char buf[16]; // snprintf buffer
+
+        if (_region == OD)
+        {
+            // optical density -left
+            if (frame.zeroValid)
+            {
+                if (!frame.odNan)
+                    if (frame.od > -0.0005 && frame.od < 0.0005) // basically zero
+                        snprintf(buf, sizeof(buf), "OD:0.000");
+                    else
+                        snprintf(buf, sizeof(buf), "OD:%.3f", frame.od);
+                else
+                    snprintf(buf, sizeof(buf), "OD:no data");
+                _display.printLine(Tdisplay::line1Y, buf);
+            }
+            else if (frame.odStatus == TodStatus::waiting)
+                _display.printLine(Tdisplay::line1Y, "Zero ready");
+            else
+                _display.printLinef(Tdisplay::line1Y, 0, "SAT:%d", frame.saturation);
+
+            // optical density - right
+            if (frame.odError != TodError::none)
+                _display.printLine(Tdisplay::line1Y, name(FodErrors, frame.odError), Tdisplay::offsetX);
+            else if (!frame.zeroValid && frame.odStatus == TodStatus::idle)
+                _display.printLine(Tdisplay::line1Y, "zero me", Tdisplay::offsetX);
+            else if (!frame.zeroValid && frame.odStatus == TodStatus::waiting)
+                _display.printLinef(Tdisplay::line1Y, Tdisplay::offsetX, "in %s", frame.nextRead);
+            else if (frame.zeroValid && frame.odStatus == TodStatus::idle)
+                _display.printLinef(Tdisplay::line1Y, Tdisplay::offsetX, "in %s", frame.nextRead);
+            else
+                _display.printLine(Tdisplay::line1Y, name(FodStatuses, frame.odStatus), Tdisplay::offsetX);
+        }
+        else if (_region == STIRRER)
+        {
+            // stirrer speed
+            if (frame.stirrerStatus == TstirrerStatus::off)
+                _display.printLine(Tdisplay::line2Y, "RPM:off");
+            else
+                _display.printLinef(Tdisplay::line2Y, 0, "RPM:%d", frame.speed);
+
+            // stirrer event
+            if (frame.stirrerEvent != TstirrerEvent::none)
+                _display.printLine(Tdisplay::line2Y, name(FstirrerEvents, frame.stirrerEvent), Tdisplay::offsetX);
+            else if (frame.protocol)
+                _display.printLinef(Tdisplay::line2Y, Tdisplay::offsetX, "PRG:%d/%d", frame.segment, frame.segmentsN);
+            else
+                _display.printLinef(Tdisplay::line2Y, Tdisplay::offsetX, "SP:%drpm", frame.setpoint);
+        }
+        else if (_region == ENVIRONMENT)
+        {
+            // power
+            snprintf(buf, sizeof(buf), "PWR:%.1fV", frame.power);
+            _display.printLine(Tdisplay::line3Y, buf);
+
+            // temperature
+            if (frame.tempError)
+                _display.printLine(Tdisplay::line3Y, "Temp:error", Tdisplay::offsetX);
+            else
+            {
+                snprintf(buf, sizeof(buf), "Temp:%.1fC", frame.temperature);
+                _display.printLine(Tdisplay::line3Y, buf, Tdisplay::offsetX);
+            }
+        }
+        else if (_region == LIGHTS)
+        {
+            // light status
+            if (frame.lightsStatus == TlightsStatus::on)
+                _display.printLinef(Tdisplay::line4Y, 0, "Light:%d%%", frame.intensity);
+            else if (frame.lightsStatus == TlightsStatus::off)
+                _display.printLine(Tdisplay::line4Y, "Light:off");
+            else if (frame.lightsStatus == TlightsStatus::error)
+                _display.printLine(Tdisplay::line4Y, "Light:ERR");
+
+            // light state
+            if (frame.lightsEvent != TlightsEvent::none)
+                _display.printLine(Tdisplay::line4Y, name(FlightsEvents, frame.lightsEvent), Tdisplay::offsetX);
+            else if (frame.lightsState == TlightsState::on)
+                _display.printLine(Tdisplay::line4Y, "always on", Tdisplay::offsetX);
+            else if (frame.lightsState == TlightsState::off)
+                _display.printLine(Tdisplay::line4Y, "always off", Tdisplay::offsetX);
+            else if (frame.lightsState == TlightsState::schedule || frame.lightsState == TlightsState::program)
+                _display.printLine(Tdisplay::line4Y, frame.lightsInfo, Tdisplay::offsetX); // countdown or schedule info
+            else if (frame.lightsState == TlightsState::pulse)
+                _display.printLinef(Tdisplay::line4Y, Tdisplay::offsetX, "pulse %dms", frame.pulsePeriod);
+        }
+        else if (_region == FAN)
+        {
+            // fan status
+            if (frame.fanStatus == TlightsStatus::on)
+                _display.printLine(Tdisplay::line5Y, "Fan:on");
+            else if (frame.fanStatus == TlightsStatus::off)
+                _display.printLine(Tdisplay::line5Y, "Fan:off");
+            else if (frame.fanStatus == TlightsStatus::error)
+                _display.printLine(Tdisplay::line5Y, "Fan:ERR");
+
+            // fan state
+            if (frame.fanState == TfanState::on)
+                _display.printLine(Tdisplay::line5Y, "always on", Tdisplay::offsetX);
+            else if (frame.fanState == TfanState::off)
+                _display.printLine(Tdisplay::line5Y, "always off", Tdisplay::offsetX);
+            else if (frame.fanState == TfanState::withLight)
+                _display.printLine(Tdisplay::line5Y, "with light", Tdisplay::offsetX);
+            else if (frame.fanState == TfanState::regulate)
+                _display.printLinef(Tdisplay::line5Y, Tdisplay::offsetX, "reg %d%%", frame.fanDuty);
+        }
+        else if (_region == PUBLISH)
+        {
+            // data information
+            _display.printLine(Tdisplay::line6Y, "Publish:");
+            if (frame.publishing)
+            {
+                _display.printLinef(Tdisplay::line6Y, Tdisplay::offsetX, "in %s", frame.nextPublish);
+            }
+            else
+            {
+                _display.printLine(Tdisplay::line6Y, "off", Tdisplay::offsetX);
+            }
+        }
+    }
+
+    // sparkline columns that changed (all of them with a full redraw)
+    void renderPlot(Tdisplay &_display)
+    {
+        if (frame.plotAll || frame.dirty == ALL)
+        {
+            for (dtypes::uint8 x = 0; x < plotWidth; x++)
+                renderColumn(_display, x);
+            return;
+        }
+        for (dtypes::uint8 x = frame.plotFrom;; x = (x + 1) % plotWidth)
+        {
+            renderColumn(_display, x);
+            if (x == frame.plotTo)
+                break;
+        }
+    }
+
+    // one sparkline column, connected to the column on its left
+    void renderColumn(Tdisplay &_display, dtypes::uint8 _x)
+    {
+        _display.drawFastVLine(_x, plotTop, plotHeight, 0);
+        dtypes::uint8 y = frame.plot[_x];
+        if (y == plotNone)
+            return;
+        dtypes::uint8 left = (_x > 0) ? frame.plot[_x - 1] : plotNone;
+        if (left == plotNone)
+            left = y;
+        dtypes::uint8 low = (left < y) ? left : y;
+        dtypes::uint8 high = (left < y) ? y : left;
+        _display.drawFastVLine(_x, plotTop + plotHeight - 1 - high, high - low + 1, 1);
+    }
+};
+
+// define the static name tables (name() binds them to a reference)
+constexpr const char *TmicroLoggerScreen::FodErrors[];
+constexpr const char *TmicroLoggerScreen::FodStatuses[];
+constexpr const char *TmicroLoggerScreen::FstirrerEvents[];
+constexpr const char *TmicroLoggerScreen::FlightsEvents[];
@@ -0,0 +1,295 @@
+// this program renders the micrologger screen for a matrix of device states on the reader board display,
+// times each render path and dumps every frame as a plain PBM image over serial
+// (save the serial output between the "P1" header and the end marker to a .pbm file to view it,
+// the frame hashes can be compared between builds to catch layout changes)
+#include "Particle.h"
+#include "uTypedef.h"
+#include "uHardwareDisplay.h"
+#include "uMicroLoggerScreen.h"
+
+// manual mode, no wifi
+SYSTEM_MODE(MANUAL);
+
+// log handler
+SerialLogHandler logHandler(LOG_LEVEL_TRACE);
+
+// self-describing data structure (SDDS) tree
+class TsddsTree : public TmenuHandle
+{
+private:
+    using Tscreen = TmicroLoggerScreen;
+    Tscreen Fscreen;
+
+    // device states to render (and their names for the output)
+    sdds_enum(running, disconnected, noPower, zeroing, optimizing, scheduled, errors, trend) Tstate;
+    static constexpr const char *Fstates[] = {"running", "disconnected", "noPower", "zeroing", "optimizing", "scheduled", "errors", "trend"};
+
+    // PBM characters per line
+    static constexpr dtypes::uint16 FpbmLine = 64;
+
+    // a running device (zeroed, stirring, lights on with a countdown, fan regulating)
+    void fill(Tstate::e _state)
+    {
+        Tscreen::Tsnapshot &frame = Fscreen.frame;
+        frame.dirty = Tscreen::ALL;
+        frame.page = Tscreen::Tpage::MAIN;
+        frame.wifi = true;
+        frame.publishing = true;
+        frame.alert = false;
+        strcpy(frame.name, "micrologger-test");
+        frame.zeroValid = true;
+        frame.odNan = false;
+        frame.od = 0.523;
+        frame.saturation = 512;
+        frame.odError = Tscreen::TodError::none;
+        frame.odStatus = Tscreen::TodStatus::idle;
+        strcpy(frame.nextRead, "1m45s");
+        frame.stirrerStatus = Tscreen::TstirrerStatus::running;
+        frame.stirrerEvent = Tscreen::TstirrerEvent::none;
+        frame.protocol = false;
+        frame.speed = 1198;
+        frame.setpoint = 1200;
+        frame.segment = 0;
+        frame.segmentsN = 0;
+        frame.power = 24.1;
+        frame.temperature = 30.2;
+        frame.tempError = false;
+        frame.lightsStatus = Tscreen::TlightsStatus::on;
+        frame.lightsState = Tscreen::TlightsState::on;
+        frame.lightsEvent = Tscreen::TlightsEvent::none;
+        frame.intensity = 80;
+        frame.pulsePeriod = 0;
+        frame.countdown = false;
+        strcpy(frame.lightsInfo, "");
+        frame.fanStatus = Tscreen::TlightsStatus::on;
+        frame.fanState = Tscreen::TfanState::regulate;
+        frame.fanDuty = 45;
+        strcpy(frame.nextPublish, "18m02s");
+        memset(frame.plot, Tscreen::plotNone, sizeof(frame.plot));
+        frame.plotAll = true;
+
+        // differences from the running device
+        if (_state == Tstate::disconnected)
+        {
+            frame.page = Tscreen::Tpage::DISCONNECTED;
+            frame.alert = true;
+        }
+        else if (_state == Tstate::noPower)
+        {
+            frame.page = Tscreen::Tpage::NO_POWER;
+            frame.power = 11.9;
+        }
+        else if (_state == Tstate::zeroing)
+        {
+            frame.zeroValid = false;
+            frame.odStatus = Tscreen::TodStatus::zeroing;
+            frame.saturation = 387;
+        }
+        else if (_state == Tstate::optimizing)
+        {
+            frame.zeroValid = false;
+            frame.odStatus = Tscreen::TodStatus::optimizing;
+            frame.saturation = 951;
+        }
+        else if (_state == Tstate::scheduled)
+        {
+            frame.lightsState = Tscreen::TlightsState::schedule;
+            frame.countdown = true;
+            strcpy(frame.lightsInfo, "off 2h15m");
+            frame.protocol = true;
+            frame.segment = 2;
+            frame.segmentsN = 5;
+        }
+        else if (_state == Tstate::errors)
+        {
+            frame.alert = true;
+            frame.wifi = false;
+            frame.odError = Tscreen::TodError::saturated;
+            frame.stirrerStatus = Tscreen::TstirrerStatus::error;
+            frame.stirrerEvent = Tscreen::TstirrerEvent::recovering;
+            frame.tempError = true;
+            frame.lightsStatus = Tscreen::TlightsStatus::error;
+            frame.fanStatus = Tscreen::TlightsStatus::error;
+        }
+        else if (_state == Tstate::trend)
+        {
+            // OD sparkline of a growth curve with the sweep two thirds across
+            frame.page = Tscreen::Tpage::TREND;
+            const dtypes::uint8 newest = Tscreen::plotWidth * 2 / 3;
+            for (dtypes::uint8 x = 0; x < Tscreen::plotWidth; x++)
+            {
+                dtypes::uint8 age = (newest + Tscreen::plotWidth - x) % Tscreen::plotWidth;
+                dtypes::float32 growth = 1.0f / (1.0f + expf((age - 60.0f) / 12.0f));
+                frame.plot[x] = static_cast<dtypes::uint8>(growth * (Tscreen::plotHeight - 1) + 0.5f);
+            }
+            frame.plot[(newest + 1) % Tscreen::plotWidth] = Tscreen::plotNone;
+        }
+    }
+
+    // average render time of the given regions
+    dtypes::uint32 timeRender(dtypes::uint8 _regions)
+    {
+        dtypes::uint32 total = 0;
+        for (dtypes::uint16 i = 0; i < repeats; i++)
+        {
+            Fscreen.frame.dirty = _regions;
+            dtypes::uint32 start = micros();
+            Fscreen.render(display);
+            total += micros() - start;
+        }
+        return total / repeats;
+    }
+
+    // FNV-1a hash of the frame buffer
+    dtypes::uint32 hash()
+    {
+        const uint8_t *buffer = display.getBuffer();
+        dtypes::uint32 h = 2166136261UL;
+        for (dtypes::uint16 i = 0; i < display.width() * ((display.height() + 7) / 8); i++)
+            h = (h ^ buffer[i]) * 16777619UL;
+        return h;
+    }
+
+    // frame buffer as a plain PBM image (rows are split to keep lines under 70 characters)
+    void dump(Tstate::e _state)
+    {
+        const uint8_t *buffer = display.getBuffer();
+        const dtypes::uint16 w = display.width();
+        char line[FpbmLine + 1];
+        line[FpbmLine] = 0;
+        Serial.printlnf("P1\n# %s\n%d %d", Fstates[_state], w, display.height());
+        for (dtypes::uint16 y = 0; y < display.height(); y++)
+        {
+            for (dtypes::uint16 x = 0; x < w; x++)
+            {
+                line[x % FpbmLine] = (buffer[x + (y / 8) * w] & (1 << (y & 7))) ? '1' : '0';
+                if (x % FpbmLine == FpbmLine - 1)
+                    Serial.println(line);
+            }
+        }
+        Serial.println("# end");
+    }
+
+    // render, time and dump one state
+    void run(Tstate::e _state)
+    {
+        fill(_state);
+        dtypes::uint32 full_us = timeRender(Tscreen::ALL);
+        if (Fscreen.frame.page == Tscreen::Tpage::TREND)
+        {
+            // a new reading only redraws two columns
+            Fscreen.frame.plotAll = false;
+            Fscreen.frame.plotFrom = Tscreen::plotWidth * 2 / 3;
+            Fscreen.frame.plotTo = Fscreen.frame.plotFrom + 1;
+            dtypes::uint32 column_us = timeRender(Tscreen::TREND);
+            Fscreen.frame.plotAll = true;
+            dtypes::uint32 plot_us = timeRender(Tscreen::TREND);
+            Log.info("%s: full %dus, new reading %dus, whole plot %dus", Fstates[_state], (int)full_us, (int)column_us, (int)plot_us);
+        }
+        else if (Fscreen.frame.page == Tscreen::Tpage::MAIN)
+        {
+            // single regions
+            dtypes::uint32 header_us = timeRender(Tscreen::HEADER);
+            dtypes::uint32 od_us = timeRender(Tscreen::OD);
+            dtypes::uint32 stirrer_us = timeRender(Tscreen::STIRRER);
+            dtypes::uint32 environment_us = timeRender(Tscreen::ENVIRONMENT);
+            dtypes::uint32 lights_us = timeRender(Tscreen::LIGHTS);
+            dtypes::uint32 fan_us = timeRender(Tscreen::FAN);
+            dtypes::uint32 publish_us = timeRender(Tscreen::PUBLISH);
+            Log.info("%s: full %dus, header %dus, OD %dus, stirrer %dus, environment %dus, lights %dus, fan %dus, publish %dus",
+                     Fstates[_state], (int)full_us, (int)header_us, (int)od_us, (int)stirrer_us, (int)environment_us, (int)lights_us, (int)fan_us, (int)publish_us);
+        }
+        else
+        {
+            Log.info("%s: full %dus", Fstates[_state], (int)full_us);
+        }
+
+        // what's on the display
+        timeRender(Tscreen::ALL);
+        Log.info("%s: frame hash %08x", Fstates[_state], (unsigned int)hash());
+        if (dumpFrames == enums::ToffOn::on)
+            dump(_state);
+    }
+
+public:
+    // the reader board display
+    sdds_var(ThardwareDisplay, display);
+
+    // testing vars
+    sdds_enum(___, renderAll) Taction;
+    sdds_var(Taction, action);
+    sdds_var(Tstate, state); // shown on the display
+    sdds_var(Tuint16, repeats, sdds::opt::nothing, 20);
+    sdds_var(enums::ToffOn, dumpFrames, sdds::opt::nothing, enums::ToffOn::on);
+
+    // constructor
+    TsddsTree()
+    {
+        // the display worker draws whatever was filled in last
+        display.renderWith([this]()
+                           { Fscreen.render(display); });
+
+        // render the whole matrix
+        on(action)
+        {
+            if (action == Taction::renderAll)
+            {
+                if (display.rendering())
+                {
+                    Log.warn("frame in flight, try again");
+                }
+                else
+                {
+                    for (int s = Tstate::running; s <= Tstate::trend; s++)
+                        run(static_cast<Tstate::e>(s));
+                    fill(state.value());
+                    display.requestFrame();
+                }
+                action = Taction::___;
+            }
+        };
+
+        // show a state
+        on(state)
+        {
+            if (display.rendering())
+            {
+                Log.warn("frame in flight, try again");
+                return;
+            }
+            fill(state.value());
+            display.requestFrame();
+        };
+
+        // frames pushed by the display worker
+        on(display.frames)
+        {
+            Log.trace("frame %d: render %dus, %d bytes sent", (int)display.frames.Fvalue, (int)display.renderTime_us.Fvalue, (int)display.bytesSent.Fvalue);
+        };
+
+        // start with the matrix once the splash screen is done
+        on(display.startup)
+        {
+            if (display.startup == ThardwareDisplay::Tstartup::complete)
+                action = Taction::renderAll;
+        };
+    };
+
+} sddsTree;
+
+// serial spike for communication via serial (with baud rate)
+#include "uSerialSpike.h"
+TserialSpike serialSpike(sddsTree, 115200);
+
+// setup
+void setup()
+{
+    sddsTree.display.init(10000);
+}
+
+// loop
+void loop()
+{
+    // handle all events
+    TtaskHandler::handleEvents();
+}
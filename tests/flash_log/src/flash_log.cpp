@@ -0,0 +1,128 @@
+// this program benchmarks the flash log (append throughput, sync time) and checks its recovery paths
+// (segment rotation, a torn record at the end, locating records by time)
+// NOTE: it erases the log in /log, don't run it on a device with readings that were not backfilled
+#include "Particle.h"
+#include "uTypedef.h"
+#include "flashLog.h"
+
+// manual mode, no wifi
+SYSTEM_MODE(MANUAL);
+
+// log handler
+SerialLogHandler logHandler(LOG_LEVEL_TRACE);
+
+// self-describing data structure (SDDS) tree
+class TsddsTree : public TmenuHandle
+{
+private:
+    TflashLog Flog;
+
+    // a record with a reading-like time (one every 2 minutes)
+    TflashRecord record(dtypes::uint32 _i)
+    {
+        TflashRecord r = {};
+        r.time = 1700000000 + _i * 120;
+        r.od = 0.001f * _i;
+        r.odSd = 0.0012f;
+        r.temperature_C = 30.2f;
+        r.speed_rpm = 1200;
+        r.power_cV = 2410;
+        return r;
+    }
+
+    // append n records and report the throughput
+    void benchmark()
+    {
+        dtypes::uint16 repaired = 0;
+        Flog.mount(repaired);
+        Flog.erase();
+        dtypes::uint32 bytes = 0;
+        dtypes::uint32 worst = 0;
+        dtypes::uint32 start = millis();
+        for (dtypes::uint32 i = 0; i < records; i++)
+        {
+            TflashRecord r = record(i);
+            dtypes::uint32 t = micros();
+            bytes += Flog.append(r);
+            t = micros() - t;
+            if (t > worst)
+                worst = t;
+        }
+        dtypes::uint32 elapsed = millis() - start;
+        appendTime_us = (records > 0) ? elapsed * 1000 / records : 0;
+        maxAppendTime_us = worst;
+        Log.info("%d records (%d bytes) in %d ms: %d us per append (max %d us), %d records/s, %d segments",
+                 (int)records.Fvalue, (int)bytes, (int)elapsed, (int)appendTime_us.Fvalue, (int)worst,
+                 (elapsed > 0) ? (int)(records * 1000 / elapsed) : 0, Flog.segments());
+    }
+
+    // torn record at the end and lookups after remounting
+    void recovery()
+    {
+        // partial record (what a power cut mid-write leaves)
+        dtypes::uint32 next = Flog.nextSeq();
+        TflashRecord last;
+        if (next == 0 || Flog.read(next - 1, &last, 1) != 1)
+        {
+            Log.error("recovery: run the benchmark first");
+            return;
+        }
+        Flog.append(last);
+        const TflashLog::Tsegment &newest = Flog.segment(Flog.segments() - 1);
+        char path[TflashLog::pathSize];
+        TflashLog::segmentPath(path, newest.id);
+        truncate(path, (newest.count - 1) * sizeof(TflashRecord) + sizeof(TflashRecord) / 2);
+
+        // remount
+        TflashLog log;
+        dtypes::uint16 repaired = 0;
+        bool mounted = log.mount(repaired);
+        bool intact = log.nextSeq() == next;
+        Log.info("recovery: mounted %s, %d torn record(s) cut off, next record %s", mounted ? "yes" : "no", repaired, intact ? "as before" : "WRONG");
+
+        // locate by time
+        dtypes::uint32 target = log.oldestSeq() + (log.nextSeq() - log.oldestSeq()) / 2;
+        dtypes::uint32 start = micros();
+        dtypes::uint32 found = log.find(record(target).time);
+        Log.info("find: record %d for record %d's time (%s) in %d us", (int)found, (int)target, (found == target) ? "ok" : "WRONG", (int)(micros() - start));
+    }
+
+public:
+    // testing vars
+    sdds_enum(___, benchmark, recovery) Taction;
+    sdds_var(Taction, action);
+    sdds_var(Tuint32, records, sdds::opt::nothing, 2000); // records to append (more than recordsPerSegment x maxSegments rotates)
+    sdds_var(Tuint32, appendTime_us, sdds::opt::readonly, 0);
+    sdds_var(Tuint32, maxAppendTime_us, sdds::opt::readonly, 0);
+
+    // constructor
+    TsddsTree()
+    {
+        on(action)
+        {
+            if (action == Taction::benchmark)
+                benchmark();
+            else if (action == Taction::recovery)
+                recovery();
+            if (action != Taction::___)
+                action = Taction::___;
+        };
+    };
+
+} sddsTree;
+
+// serial spike for communication via serial (with baud rate)
+#include "uSerialSpike.h"
+TserialSpike serialSpike(sddsTree, 115200);
+
+// setup
+void setup()
+{
+}
+
+// loop
+void loop()
+{
+    // handle all events
+    TtaskHandler::handleEvents();
+}
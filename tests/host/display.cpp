@@ -0,0 +1,322 @@
+// host test of the micrologger screen: renders the device states of the display test program (tests/display)
+// into the display's memory framebuffer, compares each frame with its golden image (golden/<state>.pbm),
+// times each render path and checks that pushes leave the display RAM matching the frame
+// and that neither renders nor pushes allocate from the heap (operator new is counted)
+// (HOST_GOLDEN=update writes the golden images instead, make goldens)
+#include "Particle.h"
+#include "chips.h"
+#include "hostTest.h"
+#include "uHardwareDisplay.h"
+#include "uMicroLoggerScreen.h"
+#include <chrono>
+#include <new>
+#include <string>
+
+// heap allocations through operator new (String, std::string, new)
+static uint32_t heapAllocations = 0;
+
+void *operator new(size_t _n)
+{
+    heapAllocations++;
+    void *p = malloc(_n > 0 ? _n : 1);
+    if (p == nullptr)
+        throw std::bad_alloc();
+    return p;
+}
+
+void operator delete(void *_p) noexcept
+{
+    free(_p);
+}
+
+void operator delete(void *_p, size_t) noexcept
+{
+    free(_p);
+}
+
+using Tscreen = TmicroLoggerScreen;
+using Taction = ThardwareI2C::Taction;
+
+// chip and drivers
+TvirtualSSD1306 oled;
+ThardwareDisplay display;
+Tscreen screen;
+
+// device states (same as the display test program)
+enum Tstate
+{
+    running,
+    disconnected,
+    noPower,
+    zeroing,
+    optimizing,
+    scheduled,
+    errors,
+    trend,
+    statesN
+};
+const char *states[] = {"running", "disconnected", "noPower", "zeroing", "optimizing", "scheduled", "errors", "trend"};
+
+// PBM characters per line (same as the display test program's dumps, so those can be checked in as golden images)
+const uint16_t pbmLine = 64;
+
+// timing repeats per render path
+const uint16_t repeats = 200;
+
+// a running device (zeroed, stirring, lights on, fan regulating) and the differences for each state
+void fill(Tstate _state)
+{
+    Tscreen::Tsnapshot &frame = screen.frame;
+    frame.dirty = Tscreen::ALL;
+    frame.page = Tscreen::Tpage::MAIN;
+    frame.wifi = true;
+    frame.publishing = true;
+    frame.alert = false;
+    strcpy(frame.name, "micrologger-test");
+    frame.zeroValid = true;
+    frame.odNan = false;
+    frame.od = 0.523;
+    frame.saturation = 512;
+    frame.odError = Tscreen::TodError::none;
+    frame.odStatus = Tscreen::TodStatus::idle;
+    strcpy(frame.nextRead, "1m45s");
+    frame.stirrerStatus = Tscreen::TstirrerStatus::running;
+    frame.stirrerEvent = Tscreen::TstirrerEvent::none;
+    frame.protocol = false;
+    frame.speed = 1198;
+    frame.setpoint = 1200;
+    frame.segment = 0;
+    frame.segmentsN = 0;
+    frame.power = 24.1;
+    frame.temperature = 30.2;
+    frame.tempError = false;
+    frame.lightsStatus = Tscreen::TlightsStatus::on;
+    frame.lightsState = Tscreen::TlightsState::on;
+    frame.lightsEvent = Tscreen::TlightsEvent::none;
+    frame.intensity = 80;
+    frame.pulsePeriod = 0;
+    frame.countdown = false;
+    strcpy(frame.lightsInfo, "");
+    frame.fanStatus = Tscreen::TlightsStatus::on;
+    frame.fanState = Tscreen::TfanState::regulate;
+    frame.fanDuty = 45;
+    strcpy(frame.nextPublish, "18m02s");
+    memset(frame.plot, Tscreen::plotNone, sizeof(frame.plot));
+    frame.plotAll = true;
+
+    if (_state == disconnected)
+    {
+        frame.page = Tscreen::Tpage::DISCONNECTED;
+        frame.alert = true;
+    }
+    else if (_state == noPower)
+    {
+        frame.page = Tscreen::Tpage::NO_POWER;
+        frame.power = 11.9;
+    }
+    else if (_state == zeroing)
+    {
+        frame.zeroValid = false;
+        frame.odStatus = Tscreen::TodStatus::zeroing;
+        frame.saturation = 387;
+    }
+    else if (_state == optimizing)
+    {
+        frame.zeroValid = false;
+        frame.odStatus = Tscreen::TodStatus::optimizing;
+        frame.saturation = 951;
+    }
+    else if (_state == scheduled)
+    {
+        frame.lightsState = Tscreen::TlightsState::schedule;
+        frame.countdown = true;
+        strcpy(frame.lightsInfo, "off 2h15m");
+        frame.protocol = true;
+        frame.segment = 2;
+        frame.segmentsN = 5;
+    }
+    else if (_state == errors)
+    {
+        frame.alert = true;
+        frame.wifi = false;
+        frame.odError = Tscreen::TodError::saturated;
+        frame.stirrerStatus = Tscreen::TstirrerStatus::error;
+        frame.stirrerEvent = Tscreen::TstirrerEvent::recovering;
+        frame.tempError = true;
+        frame.lightsStatus = Tscreen::TlightsStatus::error;
+        frame.fanStatus = Tscreen::TlightsStatus::error;
+    }
+    else if (_state == trend)
+    {
+        // OD sparkline of a growth curve with the sweep two thirds across
+        frame.page = Tscreen::Tpage::TREND;
+        const uint8_t newest = Tscreen::plotWidth * 2 / 3;
+        for (uint8_t x = 0; x < Tscreen::plotWidth; x++)
+        {
+            uint8_t age = (newest + Tscreen::plotWidth - x) % Tscreen::plotWidth;
+            float growth = 1.0f / (1.0f + expf((age - 60.0f) / 12.0f));
+            frame.plot[x] = static_cast<uint8_t>(growth * (Tscreen::plotHeight - 1) + 0.5f);
+        }
+        frame.plot[(newest + 1) % Tscreen::plotWidth] = Tscreen::plotNone;
+    }
+}
+
+// average render time of the given regions [us]
+double timeRender(uint8_t _regions)
+{
+    auto start = std::chrono::steady_clock::now();
+    for (uint16_t i = 0; i < repeats; i++)
+    {
+        screen.frame.dirty = _regions;
+        screen.render(display);
+    }
+    return std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count() / repeats;
+}
+
+// frame buffer as a plain PBM image
+std::string pbm(Tstate _state)
+{
+    const uint8_t *buffer = display.getBuffer();
+    const uint16_t w = display.width();
+    std::string image = std::string("P1\n# ") + states[_state] + "\n" + std::to_string(w) + " " + std::to_string(display.height()) + "\n";
+    for (uint16_t y = 0; y < display.height(); y++)
+    {
+        for (uint16_t x = 0; x < w; x++)
+        {
+            image += (buffer[x + (y / 8) * w] & (1 << (y & 7))) ? '1' : '0';
+            if (x % pbmLine == pbmLine - 1)
+                image += '\n';
+        }
+    }
+    return image;
+}
+
+std::string readFile(const std::string &_path)
+{
+    std::string content;
+    FILE *file = fopen(_path.c_str(), "r");
+    if (file == nullptr)
+        return content;
+    char buf[1024];
+    size_t n;
+    while ((n = fread(buf, 1, sizeof(buf), file)) > 0)
+        content.append(buf, n);
+    fclose(file);
+    return content;
+}
+
+bool writeFile(const std::string &_path, const std::string &_content)
+{
+    FILE *file = fopen(_path.c_str(), "w");
+    if (file == nullptr)
+        return false;
+    bool ok = fwrite(_content.data(), 1, _content.size(), file) == _content.size();
+    fclose(file);
+    return ok;
+}
+
+// pixels that differ between two PBM images (-1 if they can't be compared)
+int pixelDifference(const std::string &_a, const std::string &_b)
+{
+    // pixels start after the third line
+    auto pixels = [](const std::string &_image)
+    {
+        std::string bits;
+        size_t pos = 0;
+        for (int line = 0; line < 3 && pos != std::string::npos; line++)
+            pos = _image.find('\n', pos) + 1;
+        for (; pos < _image.size() && pos != std::string::npos; pos++)
+        {
+            if (_image[pos] == '0' || _image[pos] == '1')
+                bits += _image[pos];
+        }
+        return bits;
+    };
+    std::string a = pixels(_a), b = pixels(_b);
+    if (a.size() != b.size())
+        return -1;
+    int n = 0;
+    for (size_t i = 0; i < a.size(); i++)
+        n += a[i] != b[i];
+    return n;
+}
+
+// render, time and compare one state
+void run(Tstate _state, bool _update)
+{
+    section(states[_state]);
+    fill(_state);
+    double full_us = timeRender(Tscreen::ALL);
+    if (screen.frame.page == Tscreen::Tpage::TREND)
+    {
+        // a new reading only redraws two columns
+        screen.frame.plotAll = false;
+        screen.frame.plotFrom = Tscreen::plotWidth * 2 / 3;
+        screen.frame.plotTo = screen.frame.plotFrom + 1;
+        double column_us = timeRender(Tscreen::TREND);
+        screen.frame.plotAll = true;
+        double plot_us = timeRender(Tscreen::TREND);
+        printf("  full %.1fus, new reading %.1fus, whole plot %.1fus\n", full_us, column_us, plot_us);
+    }
+    else if (screen.frame.page == Tscreen::Tpage::MAIN)
+    {
+        printf("  full %.1fus, header %.1fus, OD %.1fus, stirrer %.1fus, environment %.1fus, lights %.1fus, fan %.1fus, publish %.1fus\n",
+               full_us, timeRender(Tscreen::HEADER), timeRender(Tscreen::OD), timeRender(Tscreen::STIRRER), timeRender(Tscreen::ENVIRONMENT),
+               timeRender(Tscreen::LIGHTS), timeRender(Tscreen::FAN), timeRender(Tscreen::PUBLISH));
+    }
+    else
+        printf("  full %.1fus\n", full_us);
+
+    // what's on the display
+    uint32_t allocations = heapAllocations;
+    screen.frame.dirty = Tscreen::ALL;
+    screen.render(display);
+    check(heapAllocations == allocations, "render allocates nothing (%u allocations)", (unsigned)(heapAllocations - allocations));
+    std::string image = pbm(_state);
+    std::string golden = std::string("golden/") + states[_state] + ".pbm";
+    if (_update)
+    {
+        check(writeFile(golden, image), "golden image %s written", golden.c_str());
+        return;
+    }
+    std::string expected = readFile(golden);
+    if (!check(!expected.empty(), "golden image %s exists (make goldens)", golden.c_str()))
+        return;
+    if (!check(image == expected, "frame matches %s (%d pixels differ, see build/%s.pbm)", golden.c_str(),
+               pixelDifference(image, expected), states[_state]))
+        writeFile(std::string("build/") + states[_state] + ".pbm", image);
+}
+
+// pushes: the display RAM holds the frame
+void testPush()
+{
+    section("push: full frame, then only what changed");
+    display.background = enums::ToffOn::off;
+    fill(running);
+    screen.render(display);
+    uint32_t allocations = heapAllocations;
+    display.action = Taction::write;
+    check(display.status == enums::TconStatus::connected && display.error == ThardwareI2C::Terror::none, "display connects and writes");
+    check(memcmp(oled.ram, display.getBuffer(), sizeof(oled.ram)) == 0, "display RAM holds the frame");
+    uint16_t full = display.bytesSent;
+
+    screen.frame.od = 0.611;
+    screen.frame.dirty = Tscreen::OD;
+    screen.render(display);
+    display.action = Taction::write;
+    check(memcmp(oled.ram, display.getBuffer(), sizeof(oled.ram)) == 0, "display RAM holds the changed frame");
+    check(display.bytesSent < full / 4, "only the OD line is sent (%u of %u bytes)", (unsigned)display.bytesSent, (unsigned)full);
+    check(heapAllocations == allocations, "render and pushes allocate nothing (%u allocations)", (unsigned)(heapAllocations - allocations));
+}
+
+int main()
+{
+    const char *golden = getenv("HOST_GOLDEN");
+    bool update = golden != nullptr && strcmp(golden, "update") == 0;
+    virtualI2C().attach(DISPLAY_I2C_ADDRESS, oled);
+    display.init(10203);
+    for (int s = running; s < statesN; s++)
+        run(static_cast<Tstate>(s), update);
+    testPush();
+    return report();
+}
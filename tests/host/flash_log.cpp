@@ -0,0 +1,267 @@
+// host test and benchmark of the flash log (flashLog.h only uses POSIX file calls, so it runs on Linux)
+// the file calls are wrapped at link time (see the Makefile): /log is redirected to a temporary directory
+// and every byte that goes through write() is counted, so the bytes per record include the metadata files
+// (syscall bytes: what the file system programs and erases in flash blocks underneath is not modelled)
+#include "Particle.h"
+#include "hostTest.h"
+#include "flashLog.h"
+#include <chrono>
+#include <filesystem>
+#include <vector>
+
+// --- wrapped file calls ---
+
+static char hostRoot[64];
+
+struct ThostFileStats
+{
+    uint64_t bytes = 0;  // syscall bytes (through write())
+    uint32_t writes = 0; // write() calls
+    uint32_t syncs = 0;  // fsync() calls
+};
+static ThostFileStats fileStats;
+
+// /log/... to <temporary directory>/log/...
+static const char *hostPath(const char *_path, char (&_buf)[128])
+{
+    if (strncmp(_path, "/log", 4) != 0)
+        return _path;
+    snprintf(_buf, sizeof(_buf), "%s%s", hostRoot, _path);
+    return _buf;
+}
+
+extern "C"
+{
+    int __real_open(const char *_path, int _flags, ...);
+    int __real_mkdir(const char *_path, mode_t _mode);
+    DIR *__real_opendir(const char *_path);
+    int __real_unlink(const char *_path);
+    int __real_stat(const char *_path, struct stat *_info);
+    int __real_truncate(const char *_path, off_t _size);
+    int __real_rename(const char *_from, const char *_to);
+    ssize_t __real_write(int _fd, const void *_data, size_t _n);
+    int __real_fsync(int _fd);
+
+    int __wrap_open(const char *_path, int _flags, ...)
+    {
+        mode_t mode = 0;
+        if (_flags & O_CREAT)
+        {
+            va_list args;
+            va_start(args, _flags);
+            mode = va_arg(args, int);
+            va_end(args);
+        }
+        char buf[128];
+        return __real_open(hostPath(_path, buf), _flags, mode);
+    }
+
+    int __wrap_mkdir(const char *_path, mode_t _mode)
+    {
+        char buf[128];
+        return __real_mkdir(hostPath(_path, buf), _mode);
+    }
+
+    DIR *__wrap_opendir(const char *_path)
+    {
+        char buf[128];
+        return __real_opendir(hostPath(_path, buf));
+    }
+
+    int __wrap_unlink(const char *_path)
+    {
+        char buf[128];
+        return __real_unlink(hostPath(_path, buf));
+    }
+
+    int __wrap_stat(const char *_path, struct stat *_info)
+    {
+        char buf[128];
+        return __real_stat(hostPath(_path, buf), _info);
+    }
+
+    int __wrap_truncate(const char *_path, off_t _size)
+    {
+        char buf[128];
+        return __real_truncate(hostPath(_path, buf), _size);
+    }
+
+    int __wrap_rename(const char *_from, const char *_to)
+    {
+        char from[128], to[128];
+        return __real_rename(hostPath(_from, from), hostPath(_to, to));
+    }
+
+    ssize_t __wrap_write(int _fd, const void *_data, size_t _n)
+    {
+        ssize_t n = __real_write(_fd, _data, _n);
+        if (n > 0)
+            fileStats.bytes += n;
+        fileStats.writes++;
+        return n;
+    }
+
+    int __wrap_fsync(int _fd)
+    {
+        fileStats.syncs++;
+        return __real_fsync(_fd);
+    }
+}
+
+// --- helpers ---
+
+static const uint32_t startTime = 1700000000; // unix time of the first record
+
+static TflashRecord reading(uint32_t _i)
+{
+    TflashRecord record = {};
+    record.time = startTime + _i * 60;
+    record.speed_rpm = 900;
+    record.od = 0.1f + _i * 0.001f;
+    record.odSd = 0.002f;
+    record.temperature_C = 37.0f;
+    record.power_cV = 1200;
+    record.flags = (_i % 4 == 0) ? TflashRecord::OFFLINE : 0;
+    return record;
+}
+
+static double seconds(std::chrono::steady_clock::time_point _start)
+{
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - _start).count();
+}
+
+static std::string segmentFile(const TflashLog &_log, uint8_t _i)
+{
+    char path[TflashLog::pathSize];
+    TflashLog::segmentPath(path, _log.segment(_i).id);
+    return std::string(hostRoot) + path;
+}
+
+// overwrite part of a segment file
+static void damage(const std::string &_file, off_t _offset, size_t _n)
+{
+    std::vector<uint8_t> junk(_n, 0x5a);
+    int fd = __real_open(_file.c_str(), O_WRONLY);
+    pwrite(fd, junk.data(), junk.size(), _offset);
+    close(fd);
+}
+
+// --- tests ---
+
+static const uint32_t capacity = TflashLog::recordsPerSegment * TflashLog::maxSegments;
+
+void testAppend()
+{
+    section("append: throughput and syscall bytes");
+    TflashLog log;
+    uint16_t repaired = 0;
+    check(log.mount(repaired) && repaired == 0, "empty log mounts");
+    check(log.boot() == 1, "first boot (%u)", log.boot());
+
+    const uint32_t n = capacity + TflashLog::recordsPerSegment / 2;
+    fileStats = ThostFileStats();
+    uint32_t failed = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (uint32_t i = 0; i < n; i++)
+    {
+        TflashRecord record = reading(i);
+        if (log.append(record) != sizeof(TflashRecord))
+            failed++;
+    }
+    double elapsed = seconds(start);
+    check(failed == 0, "all appends succeed (%u failed)", (unsigned)failed);
+    check(log.nextSeq() == n, "records are numbered 0..%u (next %u)", (unsigned)(n - 1), (unsigned)log.nextSeq());
+    check(log.segments() == TflashLog::maxSegments, "segments are bounded (%u)", log.segments());
+    check(log.nextSeq() - log.oldestSeq() == capacity - TflashLog::recordsPerSegment / 2, "oldest segment rotated out (%u records kept)",
+          (unsigned)(log.nextSeq() - log.oldestSeq()));
+
+    // every record once, plus the next record number (8 byte value) for every new segment
+    uint32_t segmentsStarted = (n + TflashLog::recordsPerSegment - 1) / TflashLog::recordsPerSegment;
+    uint64_t expected = static_cast<uint64_t>(n) * sizeof(TflashRecord) + segmentsStarted * 8;
+    check(fileStats.bytes == expected, "syscall bytes %llu (expected %llu)", (unsigned long long)fileStats.bytes, (unsigned long long)expected);
+    check(fileStats.syncs == n + segmentsStarted, "one sync per record and segment (%u)", (unsigned)fileStats.syncs);
+    printf("  %u appends in %.3f s: %.0f records/s, %.2f syscall bytes per record, %u syncs\n", (unsigned)n, elapsed, n / elapsed,
+           static_cast<double>(fileStats.bytes) / n, (unsigned)fileStats.syncs);
+
+    section("read: sequential batches and find by time");
+    TflashRecord batch[16];
+    uint32_t valid = 0;
+    start = std::chrono::steady_clock::now();
+    for (uint32_t seq = log.oldestSeq(); seq < log.nextSeq();)
+    {
+        uint16_t read = log.read(seq, batch, 16);
+        if (read == 0)
+            break;
+        valid += read;
+        seq += read;
+    }
+    elapsed = seconds(start);
+    check(valid == log.nextSeq() - log.oldestSeq(), "all kept records read back (%u)", (unsigned)valid);
+    printf("  %u records read in %.3f s: %.0f records/s\n", (unsigned)valid, elapsed, valid / elapsed);
+
+    uint32_t seq = log.oldestSeq() + 1234;
+    check(log.find(startTime + seq * 60) == seq, "record found by its time");
+    check(log.find(startTime + seq * 60 - 30) == seq, "first record after a time");
+    check(log.find(0) == log.oldestSeq() && log.find(startTime + n * 60) == log.nextSeq(), "times outside the log");
+}
+
+void testRepair()
+{
+    section("mount: torn tail is cut off");
+    {
+        TflashLog log;
+        uint16_t repaired = 0;
+        log.mount(repaired);
+        std::string newest = segmentFile(log, log.segments() - 1);
+        int fd = __real_open(newest.c_str(), O_WRONLY | O_APPEND);
+        __real_write(fd, "torn", 4);
+        close(fd);
+    }
+    TflashLog log;
+    uint16_t repaired = 0;
+    uint32_t next = capacity + TflashLog::recordsPerSegment / 2;
+    check(log.mount(repaired) && repaired == 1, "partial record dropped (%u)", repaired);
+    check(log.nextSeq() == next && log.boot() == 3, "numbering continues (%u), boots are counted (%u)", (unsigned)log.nextSeq(), log.boot());
+
+    section("mount: oldest segment with a corrupt first record");
+    uint32_t oldest = log.oldestSeq();
+    damage(segmentFile(log, 0), 0, sizeof(TflashRecord));
+    TflashLog log2;
+    log2.mount(repaired);
+    check(log2.oldestSeq() == oldest, "numbered from its second record (%u, expected %u)", (unsigned)log2.oldestSeq(), (unsigned)oldest);
+    TflashRecord record;
+    check(log2.read(oldest, &record, 1) == 0 && log2.read(oldest + 1, &record, 1) == 1 && record.seq == oldest + 1, "only the damaged record is lost");
+
+    section("mount: unreadable oldest segment is dropped");
+    damage(segmentFile(log2, 0), 0, TflashLog::recordsPerSegment * sizeof(TflashRecord));
+    TflashLog log3;
+    log3.mount(repaired);
+    check(repaired == TflashLog::recordsPerSegment, "its records count as corrupted (%u)", repaired);
+    check(log3.segments() == TflashLog::maxSegments - 1 && log3.oldestSeq() == oldest + TflashLog::recordsPerSegment, "next segment is the oldest (%u)",
+          (unsigned)log3.oldestSeq());
+    check(log3.nextSeq() == next, "numbering unchanged (%u)", (unsigned)log3.nextSeq());
+
+    section("erase: numbering survives an empty log");
+    log3.erase();
+    check(log3.segments() == 0 && log3.oldestSeq() == next && log3.nextSeq() == next, "empty, next record %u", (unsigned)log3.nextSeq());
+    TflashLog log4;
+    log4.mount(repaired);
+    check(log4.segments() == 0 && log4.nextSeq() == next, "next record after a restart %u (expected %u)", (unsigned)log4.nextSeq(), (unsigned)next);
+    TflashRecord first = reading(0);
+    log4.append(first);
+    check(first.seq == next && log4.oldestSeq() == next, "first record after erasing continues the numbering (%u)", (unsigned)first.seq);
+}
+
+int main()
+{
+    snprintf(hostRoot, sizeof(hostRoot), "/tmp/flash_log.XXXXXX");
+    if (mkdtemp(hostRoot) == nullptr)
+    {
+        perror("mkdtemp");
+        return 1;
+    }
+    testAppend();
+    testRepair();
+    std::filesystem::remove_all(hostRoot);
+    return report();
+}
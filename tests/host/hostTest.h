@@ -0,0 +1,49 @@
+/**
+ * Minimal checks for the host tests: check() logs failures, report() returns the exit code.
+ */
+#pragma once
+
+#include <cstdio>
+#include <cstdarg>
+
+inline int &hostFailures()
+{
+    static int failures = 0;
+    return failures;
+}
+
+inline int &hostChecks()
+{
+    static int checks = 0;
+    return checks;
+}
+
+// check a condition, the message describes what is expected
+inline bool check(bool _ok, const char *_fmt, ...) __attribute__((format(printf, 2, 3)));
+inline bool check(bool _ok, const char *_fmt, ...)
+{
+    hostChecks()++;
+    if (_ok)
+        return true;
+    hostFailures()++;
+    va_list args;
+    va_start(args, _fmt);
+    fprintf(stderr, "FAILED: ");
+    vfprintf(stderr, _fmt, args);
+    fputc('\n', stderr);
+    va_end(args);
+    return false;
+}
+
+// start a group of checks
+inline void section(const char *_name)
+{
+    printf("- %s\n", _name);
+}
+
+// summary and exit code
+inline int report()
+{
+    printf("%d checks, %d failed\n", hostChecks(), hostFailures());
+    return hostFailures() > 0 ? 1 : 0;
+}
@@ -0,0 +1,436 @@
+// host test of the I2C drivers against register models of the reader board chips on a virtual bus
+// (shadowed writes and read-back verification, retries, bus recovery, delta writes, data-ready reads, rheostat frames,
+// injected latency, the bus queue) and a benchmark of the bus traffic per OD read cycle
+#include "Particle.h"
+#include "chips.h"
+#include "hostTest.h"
+#include "uHardwareIOExpanderTCA9534.h"
+#include "uHardwarePwmPCA9633.h"
+#include "uHardwareRheostatAD5241.h"
+#include "uHardwareRheostatAD5246.h"
+#include "uHardwareRheostatMCP4017.h"
+#include "uHardwareSensorTMP117.h"
+#include "uMultask.h"
+
+using Taction = ThardwareI2C::Taction;
+using Terror = ThardwareI2C::Terror;
+using Tmode = ThardwareIOExpander::Tmode;
+using Tvalue = ThardwareIOExpander::Tvalue;
+using Tverify = ThardwareI2C::Tverify;
+using Toutcome = ThardwareI2C::Toutcome;
+const enums::TconStatus::e connected = enums::TconStatus::connected;
+
+// chips
+TvirtualTCA9534 tca;
+TvirtualPCA9633 pca;
+TvirtualTMP117 tmp;
+TvirtualRheostat7 mcp;
+TvirtualRheostat7 ad5246(true);
+TvirtualAD5241 ad5241;
+
+// drivers
+ThardwareIOExpander expander;
+ThardwarePwmPCA9633 dimmer;
+ThardwareSensorTMP117 temperature;
+ThardwareRheostatMCP4017 dpot1;
+ThardwareRheostatAD5246 dpot2;
+ThardwareRheostatAD5241 dpot3;
+
+// switch the beam pin and write
+void toggle()
+{
+    expander.pin1 = (expander.pin1 == Tmode::OUTPUT_ON) ? Tmode::OUTPUT_OFF : Tmode::OUTPUT_ON;
+    expander.action = Taction::write;
+}
+
+void testExpander()
+{
+    const uint8_t address = IOEXPANDER_I2C_ADDRESS;
+
+    section("TCA9534: connect and verified write");
+    expander.init();
+    char summary[32];
+    expander.summarize(summary, sizeof(summary));
+    check(strcmp(summary, "20:0/0/-/0") == 0, "summary without transactions has no p90, got %s", summary);
+    expander.action = Taction::connect;
+    check(expander.status == connected, "expander connects");
+    expander.pin1 = Tmode::OUTPUT_ON;
+    expander.pin2 = Tmode::OUTPUT_OFF;
+    expander.action = Taction::write;
+    check(expander.error == Terror::none, "write succeeds");
+    check(tca.regs[TvirtualTCA9534::configRegister] == 0xfc, "pins 1 and 2 are outputs (config 0x%02x)", tca.regs[TvirtualTCA9534::configRegister]);
+    check(tca.regs[TvirtualTCA9534::outputRegister] == 0x01, "pin 1 high, pin 2 low (output 0x%02x)", tca.regs[TvirtualTCA9534::outputRegister]);
+    check(tca.registerReads[TvirtualTCA9534::configRegister] == 1 && tca.registerReads[TvirtualTCA9534::outputRegister] == 1,
+          "first write after connecting reads back both registers (config %u, output %u)",
+          (unsigned)tca.registerReads[TvirtualTCA9534::configRegister], (unsigned)tca.registerReads[TvirtualTCA9534::outputRegister]);
+    check(expander.value1 == Tvalue::ON && expander.value2 == Tvalue::OFF, "output values are updated");
+
+    section("TCA9534: shadow skips unchanged writes");
+    uint32_t transactions = tca.writes + tca.reads;
+    uint32_t skipped = expander.skipped;
+    expander.action = Taction::write;
+    check(tca.writes + tca.reads == transactions, "identical write does not touch the bus");
+    check(expander.skipped > skipped, "skipped transactions are counted");
+
+    section("TCA9534: periodic verification counts device writes");
+    expander.verifyInterval = 3;
+    uint32_t reads = tca.registerReads[TvirtualTCA9534::outputRegister];
+    for (uint8_t i = 0; i < 6; i++)
+        toggle();
+    check(tca.registerReads[TvirtualTCA9534::outputRegister] == reads + 2, "every third write is read back (%u of 6)",
+          (unsigned)(tca.registerReads[TvirtualTCA9534::outputRegister] - reads));
+
+    section("TCA9534: retry after a NACK");
+    virtualI2C().fail(address, TvirtualI2C::addressNack);
+    toggle();
+    check(expander.error == Terror::none && expander.status == connected, "write succeeds on the second attempt");
+    check(expander.retries == 1, "one retry (%u)", (unsigned)expander.retries);
+
+    section("TCA9534: retries exhausted");
+    virtualI2C().fail(address, TvirtualI2C::dataNack, expander.maxAttempts);
+    toggle();
+    check(expander.error == Terror::failedWrite, "error after %d attempts", expander.maxAttempts.value());
+    check(expander.status != connected && expander.disconnects == 1, "device disconnects");
+    expander.action = Taction::connect;
+    expander.action = Taction::write;
+    check(expander.status == connected && expander.error == Terror::none, "reconnects and writes");
+    check(tca.regs[TvirtualTCA9534::outputRegister] == (expander.pin1 == Tmode::OUTPUT_ON ? 0x01 : 0x00), "output register matches after reconnecting");
+
+    section("TCA9534: read-back catches a corrupted write");
+    expander.verify = Tverify::always;
+    virtualI2C().corrupt(address, 0x80);
+    toggle();
+    check(expander.error == Terror::failedWrite, "mismatch is reported");
+    check(tca.regs[TvirtualTCA9534::outputRegister] & 0x80, "chip holds the corrupted value");
+    expander.action = Taction::connect;
+    expander.action = Taction::write;
+    check(expander.error == Terror::none && !(tca.regs[TvirtualTCA9534::outputRegister] & 0x80), "rewritten after reconnecting");
+    expander.verify = Tverify::periodic;
+
+    section("TCA9534: bus recovery releases a stuck SDA");
+    virtualI2C().holdSda(3);
+    toggle();
+    check(expander.error == Terror::none, "write succeeds after the recovery");
+    check(expander.recoveries == 1 && i2cBus().busRecoveries == 1 && i2cBus().stuckBus == 0, "one successful recovery (%u, %u, %u)",
+          (unsigned)expander.recoveries, (unsigned)i2cBus().busRecoveries, (unsigned)i2cBus().stuckBus);
+    check(!virtualI2C().sdaHeld(), "SDA released");
+
+    section("TCA9534: bus stuck for good");
+    virtualI2C().holdSda(20);
+    toggle();
+    check(expander.error == Terror::failedWrite, "write fails");
+    check(i2cBus().stuckBus > 0, "stuck bus is counted (%u)", (unsigned)i2cBus().stuckBus);
+    virtualI2C().holdSda(0);
+    expander.action = Taction::connect;
+    check(expander.status == connected, "reconnects once the bus is free");
+
+    section("TCA9534: input pins");
+    expander.pin8 = Tmode::INPUT;
+    tca.pins = 0x00;
+    expander.action = Taction::read;
+    check(expander.value8 == Tvalue::LOW, "input low");
+    tca.pins = 0x80;
+    expander.action = Taction::read;
+    check(expander.value8 == Tvalue::HIGH, "input high");
+}
+
+void testDimmer()
+{
+    section("PCA9633: configuration write");
+    dimmer.init(ThardwarePwmPCA9633::Driver::EXTN);
+    check(dimmer.status == connected && dimmer.error == Terror::none, "dimmer connects and writes on init");
+    check(pca.regs[TvirtualPCA9633::mode1] == 0x01, "normal mode (MODE1 0x%02x)", pca.regs[TvirtualPCA9633::mode1]);
+    check(pca.regs[TvirtualPCA9633::mode2] == 0x15, "inverted outputs for NMOS drivers (MODE2 0x%02x)", pca.regs[TvirtualPCA9633::mode2]);
+    check(pca.regs[TvirtualPCA9633::ledOut] == 0x00, "all channels off");
+
+    section("PCA9633: delta writes");
+    dimmer.state2 = enums::ToffOn::on;
+    dimmer.action = Taction::write;
+    check(pca.lastFirst == TvirtualPCA9633::ledOut && pca.lastN == 1, "only LEDOUT is written (%d+%d)", pca.lastFirst, pca.lastN);
+    check(pca.output(1) == 1, "channel 2 fully on");
+    dimmer.setpoint3 = 100;
+    dimmer.state3 = enums::ToffOn::on;
+    dimmer.action = Taction::write;
+    check(pca.lastFirst == TvirtualPCA9633::pwm0 + 2 && pca.lastN == 5, "PWM2 to LEDOUT written in one range (%d+%d)", pca.lastFirst, pca.lastN);
+    check(pca.regs[TvirtualPCA9633::pwm0 + 2] == 100 && pca.output(2) == 2, "channel 3 dimmed");
+
+    section("PCA9633: group blinking");
+    dimmer.blink = 0b0001;
+    dimmer.blinkPeriod_ms = 1000;
+    dimmer.blinkDuty = 64;
+    dimmer.state1 = enums::ToffOn::on;
+    dimmer.action = Taction::write;
+    check(pca.regs[TvirtualPCA9633::mode2] & 0x20, "group blinking enabled");
+    check(pca.regs[TvirtualPCA9633::grpFreq] == 23 && pca.regs[TvirtualPCA9633::grpPwm] == 64, "1 s period at 25%% duty (GRPFREQ %d, GRPPWM %d)",
+          pca.regs[TvirtualPCA9633::grpFreq], pca.regs[TvirtualPCA9633::grpPwm]);
+    check(pca.output(0) == 3 && dimmer.value1 == ThardwarePwmPCA9633::Tvalue::PULSED, "channel 1 pulsed");
+
+    section("PCA9633: short read-back is retried");
+    dimmer.verify = Tverify::always;
+    uint32_t retries = dimmer.retries;
+    virtualI2C().fail(DIMMER_I2C_ADDRESS, TvirtualI2C::shortRead);
+    dimmer.setpoint4 = 10;
+    dimmer.state4 = enums::ToffOn::on;
+    dimmer.action = Taction::write;
+    check(dimmer.error == Terror::none && dimmer.retries == retries + 1, "write verified after one retry");
+}
+
+// reads at the driver's schedule from a chip with a slow clock, returns the reads of a conversion that was already read
+uint8_t slowChipReads(float _clockError, uint8_t _reads)
+{
+    tmp.clockError = _clockError;
+    uint8_t repeated = 0;
+    for (uint8_t i = 0; i < _reads; i++)
+    {
+        tmp.temperature_C = 20.0f + i * 0.5f; // every conversion has its own temperature
+        dtypes::float32 last = temperature.temperature_C.value();
+        uint32_t notReady = temperature.notReady;
+        delay(temperature.untilNextConversion_ms());
+        temperature.action = Taction::read;
+        if (temperature.notReady == notReady && temperature.temperature_C.value() == last)
+            repeated++;
+    }
+    tmp.clockError = 0;
+    return repeated;
+}
+
+void testTemperature()
+{
+    section("TMP117: configuration");
+    temperature.init();
+    temperature.action = Taction::connect;
+    temperature.action = Taction::write;
+    uint16_t config = tmp.regs[TvirtualTMP117::configRegister];
+    check(((config >> 7) & 0x07) == ThardwareSensorTMP117::Tcycle::s4 && ((config >> 5) & 0x03) == ThardwareSensorTMP117::Taveraging::avg64,
+          "4 s cycle with 64x averaging (config 0x%04x)", config);
+    check(tmp.cycle_ms() == temperature.cycle_ms(), "driver and chip agree on the cycle (%u ms)", (unsigned)tmp.cycle_ms());
+
+    section("TMP117: reads only new conversions");
+    TvirtualI2C &bus = virtualI2C();
+    const uint32_t registerRead = 2; // pointer write + read
+    uint32_t transactions = bus.transactions;
+    temperature.action = Taction::read;
+    check(temperature.notReady == 1 && std::isnan(temperature.temperature_C.value()) && bus.transactions == transactions,
+          "no conversion yet, nothing read");
+    check(temperature.untilNextConversion_ms() == temperature.cycle_ms(), "next conversion in one cycle (%u ms)",
+          (unsigned)temperature.untilNextConversion_ms());
+    delay(temperature.cycle_ms());
+    transactions = bus.transactions;
+    temperature.action = Taction::read;
+    check(fabs(temperature.temperature_C - 25.0f) < 0.01f, "25 C after the first cycle (%.3f)", temperature.temperature_C.value());
+    check(bus.transactions == transactions + 2 * registerRead, "first read checks the data-ready flag (%u transactions)",
+          (unsigned)(bus.transactions - transactions));
+    tmp.temperature_C = 37.2f;
+    transactions = bus.transactions;
+    temperature.action = Taction::read;
+    check(temperature.notReady == 2 && fabs(temperature.temperature_C - 25.0f) < 0.01f && bus.transactions == transactions,
+          "same conversion is not read twice");
+    delay(temperature.untilNextConversion_ms());
+    temperature.action = Taction::read;
+    check(fabs(temperature.temperature_C - 37.2f) < 0.01f, "37.2 C after the next cycle (%.3f)", temperature.temperature_C.value());
+    check(bus.transactions == transactions + registerRead, "only the temperature is read (%u transactions)", (unsigned)(bus.transactions - transactions));
+
+    section("TMP117: the data-ready check");
+    transactions = bus.transactions;
+    uint8_t repeated = slowChipReads(0, 16);
+    check(repeated == 0 && bus.transactions - transactions == 17 * registerRead, "16 new conversions in 17 register reads (%u)",
+          (unsigned)((bus.transactions - transactions) / registerRead));
+    repeated = slowChipReads(0.05f, 48);
+    check(repeated == 0, "the read cycle's margin covers a chip 5%% slow (%u conversions read twice)", (unsigned)repeated);
+    uint32_t notReady = temperature.notReady;
+    uint8_t reads = 0;
+    while (reads < 32 && temperature.notReady == notReady)
+    {
+        // the chip's conversion restarts every third of a cycle, it never finishes one
+        uint32_t wait = temperature.untilNextConversion_ms();
+        const uint8_t restart[] = {TvirtualTMP117::configRegister, static_cast<uint8_t>(tmp.regs[TvirtualTMP117::configRegister] >> 8),
+                                   static_cast<uint8_t>(tmp.regs[TvirtualTMP117::configRegister] & 0xfc)};
+        for (uint8_t i = 0; i < 3; i++)
+        {
+            delay(wait / 3);
+            tmp.receive(restart, sizeof(restart));
+        }
+        delay(wait - 3 * (wait / 3));
+        temperature.action = Taction::read;
+        reads++;
+    }
+    check(temperature.notReady > notReady && reads <= 17, "a chip that stops converting is caught by the check (after %u reads)",
+          (unsigned)reads);
+    uint32_t writes = tmp.configWrites;
+    tmp.regs[TvirtualTMP117::configRegister] = 0x0220; // power-on reset
+    for (uint8_t i = 0; i < 16 && tmp.configWrites == writes; i++)
+    {
+        delay(temperature.untilNextConversion_ms());
+        temperature.action = Taction::read;
+    }
+    check(tmp.configWrites == writes + 1 && tmp.cycle_ms() == temperature.cycle_ms() && temperature.error == Terror::none,
+          "a lost configuration is written again");
+
+    section("TMP117: new cycle is written");
+    writes = tmp.configWrites;
+    temperature.cycle = ThardwareSensorTMP117::Tcycle::s1;
+    check(tmp.configWrites == writes + 1 && tmp.cycle_ms() == 1000, "1 s cycle (%u ms)", (unsigned)tmp.cycle_ms());
+}
+
+void testRheostats()
+{
+    section("MCP4017: 7-bit wiper in a single byte frame");
+    dpot1.init(ThardwareRheostat::Resistance::R100k);
+    check(dpot1.status == connected && dpot1.error == Terror::none && mcp.wiper == 0, "connects and writes the wiper on init (%u)", mcp.wiper);
+    dpot1.steps = 100;
+    dpot1.action = Taction::write;
+    check(mcp.wiper == 100 && dpot1.resistance_Ohm == 78740, "wiper 100 of 127 (%u, %u Ohm)", mcp.wiper, (unsigned)dpot1.resistance_Ohm.value());
+    dpot1.steps = 200;
+    check(dpot1.steps == 127, "steps are limited to 7 bits (%u)", dpot1.steps.value());
+    mcp.wiper = 42;
+    dpot1.action = Taction::read;
+    check(dpot1.steps == 42, "wiper is read back (%u)", dpot1.steps.value());
+
+    section("AD5246: undefined bit 7 is masked in the read-back");
+    dpot2.init(ThardwareRheostat::Resistance::R100k);
+    dpot2.verify = Tverify::always;
+    dpot2.steps = 90;
+    dpot2.action = Taction::write;
+    check(ad5246.wiper == 90 && dpot2.error == Terror::none, "write verified although bit 7 reads 1 (wiper %u)", ad5246.wiper);
+    dpot2.action = Taction::read;
+    check(dpot2.steps == 90, "read masks bit 7 (%u)", dpot2.steps.value());
+
+    section("AD5241: instruction and data byte, 8-bit wiper");
+    dpot3.init(ThardwareRheostat::Resistance::R1M);
+    dpot3.verify = Tverify::always;
+    dpot3.steps = 200;
+    dpot3.action = Taction::write;
+    check(ad5241.wiper == 200 && ad5241.instruction == 0 && !ad5241.shutdown && dpot3.error == Terror::none,
+          "two byte frame writes all 8 bits (wiper %u, instruction 0x%02x)", ad5241.wiper, ad5241.instruction);
+    uint32_t writes = ad5241.wiperWrites;
+    dpot3.verify = Tverify::periodic;
+    dpot3.action = Taction::write;
+    check(ad5241.wiperWrites == writes, "unchanged wiper is not rewritten");
+}
+
+void testLatency()
+{
+    section("latency injection: slow transactions show in the telemetry");
+    char summary[32];
+    uint32_t start = micros();
+    virtualI2C().latency(TEMPERATUER_SENSOR_I2C_ADDRESS, 3000);
+    delay(temperature.cycle_ms());
+    temperature.action = Taction::read;
+    virtualI2C().latency(TEMPERATUER_SENSOR_I2C_ADDRESS, 0);
+    temperature.summarize(summary, sizeof(summary));
+    unsigned long maxLatency = strtoul(strrchr(summary, '/') + 1, nullptr, 10);
+    check(maxLatency >= 3000 && micros() - start >= temperature.cycle_ms() * 1000 + 3000, "max latency %lu us (%s)", maxLatency, summary);
+    check(temperature.error == Terror::none, "slow reads still succeed");
+    temperature.summarize(summary, sizeof(summary));
+    check(strcmp(summary, "48:0/0/-/0") == 0, "the next summary window starts from zero (%s)", summary);
+    temperature.closeTelemetryWindow();
+    check(temperature.closeTelemetryWindow() == 0 && temperature.telemetry.transactions == 0 && temperature.telemetry.maxLatency_us == 0,
+          "the next telemetry window starts from zero");
+}
+
+// bus traffic of one OD read cycle: beam on, gain, beam off, temperature
+struct Ttraffic
+{
+    uint32_t transactions;
+    uint64_t bytes;
+    uint64_t busy_us;
+};
+
+Ttraffic readCycle(uint8_t _gain)
+{
+    TvirtualI2C &bus = virtualI2C();
+    Ttraffic before = {bus.transactions, bus.bytes, bus.busy_us};
+    expander.pin1 = Tmode::OUTPUT_ON;
+    expander.writeOutputs();
+    dpot1.steps = _gain;
+    dpot1.action = Taction::write;
+    dpot3.steps = _gain;
+    dpot3.action = Taction::write;
+    expander.pin1 = Tmode::OUTPUT_OFF;
+    expander.writeOutputs();
+    delay(temperature.cycle_ms());
+    temperature.action = Taction::read;
+    return Ttraffic{bus.transactions - before.transactions, bus.bytes - before.bytes, bus.busy_us - before.busy_us};
+}
+
+void benchmarkReadCycle()
+{
+    section("benchmark: bus traffic per OD read cycle (beam on, gain, beam off, temperature)");
+    const uint8_t cycles = 20;
+    const Tverify::e modes[] = {Tverify::periodic, Tverify::always};
+    uint32_t transactions[2];
+    for (uint8_t m = 0; m < 2; m++)
+    {
+        expander.verify = modes[m];
+        dpot1.verify = modes[m];
+        dpot3.verify = modes[m];
+        Ttraffic total = {0, 0, 0};
+        for (uint8_t i = 0; i < cycles; i++)
+        {
+            // gain changes every other cycle
+            Ttraffic t = readCycle((i / 2) % 2 ? 60 : 70);
+            total.transactions += t.transactions;
+            total.bytes += t.bytes;
+            total.busy_us += t.busy_us;
+        }
+        transactions[m] = total.transactions;
+        printf("  verify %-8s %.1f transactions, %.1f bytes, %.0f us bus time per cycle\n", m == 0 ? "periodic" : "always",
+               static_cast<double>(total.transactions) / cycles, static_cast<double>(total.bytes) / cycles, static_cast<double>(total.busy_us) / cycles);
+    }
+    expander.verify = Tverify::periodic;
+    dpot1.verify = Tverify::periodic;
+    dpot3.verify = Tverify::periodic;
+    check(transactions[0] < transactions[1], "periodic verification saves transactions (%u vs %u)", (unsigned)transactions[0], (unsigned)transactions[1]);
+}
+
+// run the bus pump until the queue is empty
+void pump()
+{
+    for (uint8_t i = 0; i < 64 && i2cBus().queueDepth > 0; i++)
+    {
+        hostRunTimers();
+        TtaskHandler::handleEvents();
+    }
+}
+
+void testQueue()
+{
+    section("bus queue: outcome of queued actions");
+    expander.pin1 = (expander.pin1 == Tmode::OUTPUT_ON) ? Tmode::OUTPUT_OFF : Tmode::OUTPUT_ON;
+    check(expander.queue(Taction::write), "write is queued");
+    pump();
+    check(expander.completed == Taction::write && expander.outcome == Toutcome::success, "write completes with success (%s)", expander.outcome.c_str());
+    uint32_t failed = i2cBus().failed;
+    virtualI2C().fail(IOEXPANDER_I2C_ADDRESS, TvirtualI2C::dataNack, expander.maxAttempts);
+    expander.pin1 = (expander.pin1 == Tmode::OUTPUT_ON) ? Tmode::OUTPUT_OFF : Tmode::OUTPUT_ON;
+    expander.queue(Taction::write);
+    pump();
+    check(expander.completed == Taction::write && expander.outcome == Toutcome::failed && i2cBus().failed == failed + 1, "failed write is reported (%s)",
+          expander.outcome.c_str());
+    expander.action = Taction::connect;
+    check(expander.status == connected, "expander reconnects");
+
+    section("bus queue: full device table");
+    uint8_t added = 0;
+    while (added < 32 && i2cBus().add(&dimmer))
+        added++;
+    check(added < 32, "add() reports the full table (after %u more devices)", (unsigned)added);
+}
+
+int main()
+{
+    virtualI2C().attach(IOEXPANDER_I2C_ADDRESS, tca);
+    virtualI2C().attach(DIMMER_I2C_ADDRESS, pca);
+    virtualI2C().attach(TEMPERATUER_SENSOR_I2C_ADDRESS, tmp);
+    virtualI2C().attach(RHEOSTAT_MCP4017_I2C_ADDRESS, mcp);
+    virtualI2C().attach(RHEOSTAT_AD5246_I2C_ADDRESS, ad5246);
+    virtualI2C().attach(RHEOSTAT_AD5241_I2C_ADDRESS, ad5241);
+    testExpander();
+    testDimmer();
+    testTemperature();
+    testRheostats();
+    testLatency();
+    benchmarkReadCycle();
+    testQueue();
+    return report();
+}
@@ -0,0 +1,370 @@
+/**
+ * Host stand-in for Adafruit_GFX + Adafruit_SSD1306: draws into the same memory framebuffer
+ * (SSD1306 page layout: one byte = 8 vertical pixels, buffer[x + (y / 8) * width], bit y % 8)
+ * with the same pixel rules as the library (Bresenham lines, transparent bitmaps, the classic 6x8 font
+ * with a transparent background), so frames rendered on the host match the frames on the display.
+ * Commands and display() go out on the virtual I2C bus like on the device.
+ */
+#pragma once
+
+#include "Particle.h"
+#include <utility>
+
+#define SSD1306_BLACK 0
+#define SSD1306_WHITE 1
+#define SSD1306_INVERSE 2
+#define BLACK SSD1306_BLACK
+#define WHITE SSD1306_WHITE
+#define INVERSE SSD1306_INVERSE
+
+#define SSD1306_SWITCHCAPVCC 0x02
+#define SSD1306_EXTERNALVCC 0x01
+#define SSD1306_SETSTARTLINE 0x40
+#define SSD1306_COLUMNADDR 0x21
+#define SSD1306_PAGEADDR 0x22
+#define SSD1306_DISPLAYOFF 0xAE
+#define SSD1306_DISPLAYON 0xAF
+
+// classic 5x7 font (glcdfont), printable ASCII only
+static const uint8_t hostFont[][5] = {
+    {0x00, 0x00, 0x00, 0x00, 0x00}, {0x00, 0x00, 0x5F, 0x00, 0x00}, {0x00, 0x07, 0x00, 0x07, 0x00}, {0x14, 0x7F, 0x14, 0x7F, 0x14}, // ' ' ! " #
+    {0x24, 0x2A, 0x7F, 0x2A, 0x12}, {0x23, 0x13, 0x08, 0x64, 0x62}, {0x36, 0x49, 0x56, 0x20, 0x50}, {0x00, 0x08, 0x07, 0x03, 0x00}, // $ % & '
+    {0x00, 0x1C, 0x22, 0x41, 0x00}, {0x00, 0x41, 0x22, 0x1C, 0x00}, {0x2A, 0x1C, 0x7F, 0x1C, 0x2A}, {0x08, 0x08, 0x3E, 0x08, 0x08}, // ( ) * +
+    {0x00, 0x80, 0x70, 0x30, 0x00}, {0x08, 0x08, 0x08, 0x08, 0x08}, {0x00, 0x00, 0x60, 0x60, 0x00}, {0x20, 0x10, 0x08, 0x04, 0x02}, // , - . /
+    {0x3E, 0x51, 0x49, 0x45, 0x3E}, {0x00, 0x42, 0x7F, 0x40, 0x00}, {0x72, 0x49, 0x49, 0x49, 0x46}, {0x21, 0x41, 0x49, 0x4D, 0x33}, // 0 1 2 3
+    {0x18, 0x14, 0x12, 0x7F, 0x10}, {0x27, 0x45, 0x45, 0x45, 0x39}, {0x3C, 0x4A, 0x49, 0x49, 0x31}, {0x41, 0x21, 0x11, 0x09, 0x07}, // 4 5 6 7
+    {0x36, 0x49, 0x49, 0x49, 0x36}, {0x46, 0x49, 0x49, 0x29, 0x1E}, {0x00, 0x00, 0x14, 0x00, 0x00}, {0x00, 0x40, 0x34, 0x00, 0x00}, // 8 9 : ;
+    {0x00, 0x08, 0x14, 0x22, 0x41}, {0x14, 0x14, 0x14, 0x14, 0x14}, {0x00, 0x41, 0x22, 0x14, 0x08}, {0x02, 0x01, 0x59, 0x09, 0x06}, // < = > ?
+    {0x3E, 0x41, 0x5D, 0x59, 0x4E}, {0x7C, 0x12, 0x11, 0x12, 0x7C}, {0x7F, 0x49, 0x49, 0x49, 0x36}, {0x3E, 0x41, 0x41, 0x41, 0x22}, // @ A B C
+    {0x7F, 0x41, 0x41, 0x41, 0x3E}, {0x7F, 0x49, 0x49, 0x49, 0x41}, {0x7F, 0x09, 0x09, 0x09, 0x01}, {0x3E, 0x41, 0x41, 0x51, 0x73}, // D E F G
+    {0x7F, 0x08, 0x08, 0x08, 0x7F}, {0x00, 0x41, 0x7F, 0x41, 0x00}, {0x20, 0x40, 0x41, 0x3F, 0x01}, {0x7F, 0x08, 0x14, 0x22, 0x41}, // H I J K
+    {0x7F, 0x40, 0x40, 0x40, 0x40}, {0x7F, 0x02, 0x1C, 0x02, 0x7F}, {0x7F, 0x04, 0x08, 0x10, 0x7F}, {0x3E, 0x41, 0x41, 0x41, 0x3E}, // L M N O
+    {0x7F, 0x09, 0x09, 0x09, 0x06}, {0x3E, 0x41, 0x51, 0x21, 0x5E}, {0x7F, 0x09, 0x19, 0x29, 0x46}, {0x26, 0x49, 0x49, 0x49, 0x32}, // P Q R S
+    {0x03, 0x01, 0x7F, 0x01, 0x03}, {0x3F, 0x40, 0x40, 0x40, 0x3F}, {0x1F, 0x20, 0x40, 0x20, 0x1F}, {0x3F, 0x40, 0x38, 0x40, 0x3F}, // T U V W
+    {0x63, 0x14, 0x08, 0x14, 0x63}, {0x03, 0x04, 0x78, 0x04, 0x03}, {0x61, 0x59, 0x49, 0x4D, 0x43}, {0x00, 0x7F, 0x41, 0x41, 0x41}, // X Y Z [
+    {0x02, 0x04, 0x08, 0x10, 0x20}, {0x00, 0x41, 0x41, 0x41, 0x7F}, {0x04, 0x02, 0x01, 0x02, 0x04}, {0x40, 0x40, 0x40, 0x40, 0x40}, // \ ] ^ _
+    {0x00, 0x03, 0x07, 0x08, 0x00}, {0x20, 0x54, 0x54, 0x78, 0x40}, {0x7F, 0x28, 0x44, 0x44, 0x38}, {0x38, 0x44, 0x44, 0x44, 0x28}, // ` a b c
+    {0x38, 0x44, 0x44, 0x28, 0x7F}, {0x38, 0x54, 0x54, 0x54, 0x18}, {0x00, 0x08, 0x7E, 0x09, 0x02}, {0x18, 0xA4, 0xA4, 0x9C, 0x78}, // d e f g
+    {0x7F, 0x08, 0x04, 0x04, 0x78}, {0x00, 0x44, 0x7D, 0x40, 0x00}, {0x20, 0x40, 0x40, 0x3D, 0x00}, {0x7F, 0x10, 0x28, 0x44, 0x00}, // h i j k
+    {0x00, 0x41, 0x7F, 0x40, 0x00}, {0x7C, 0x04, 0x78, 0x04, 0x78}, {0x7C, 0x08, 0x04, 0x04, 0x78}, {0x38, 0x44, 0x44, 0x44, 0x38}, // l m n o
+    {0xFC, 0x18, 0x24, 0x24, 0x18}, {0x18, 0x24, 0x24, 0x18, 0xFC}, {0x7C, 0x08, 0x04, 0x04, 0x08}, {0x48, 0x54, 0x54, 0x54, 0x24}, // p q r s
+    {0x04, 0x04, 0x3F, 0x44, 0x24}, {0x3C, 0x40, 0x40, 0x20, 0x7C}, {0x1C, 0x20, 0x40, 0x20, 0x1C}, {0x3C, 0x40, 0x30, 0x40, 0x3C}, // t u v w
+    {0x44, 0x28, 0x10, 0x28, 0x44}, {0x4C, 0x90, 0x90, 0x90, 0x7C}, {0x44, 0x64, 0x54, 0x4C, 0x44}, {0x00, 0x08, 0x36, 0x41, 0x00}, // x y z {
+    {0x00, 0x00, 0x77, 0x00, 0x00}, {0x00, 0x41, 0x36, 0x08, 0x00}, {0x02, 0x01, 0x02, 0x04, 0x02}                                   // | } ~
+};
+
+class Adafruit_GFX
+{
+protected:
+    int16_t _width;
+    int16_t _height;
+    int16_t cursor_x = 0;
+    int16_t cursor_y = 0;
+    uint16_t textcolor = 0xffff;
+    uint16_t textbgcolor = 0xffff;
+    uint8_t textsize_x = 1;
+    uint8_t textsize_y = 1;
+    bool wrap = true;
+
+public:
+    Adafruit_GFX(int16_t _w, int16_t _h) : _width(_w), _height(_h) {}
+    virtual ~Adafruit_GFX() {}
+
+    virtual void drawPixel(int16_t _x, int16_t _y, uint16_t _color) = 0;
+
+    virtual void drawFastVLine(int16_t _x, int16_t _y, int16_t _h, uint16_t _color)
+    {
+        for (int16_t i = 0; i < _h; i++)
+            drawPixel(_x, _y + i, _color);
+    }
+
+    virtual void drawFastHLine(int16_t _x, int16_t _y, int16_t _w, uint16_t _color)
+    {
+        for (int16_t i = 0; i < _w; i++)
+            drawPixel(_x + i, _y, _color);
+    }
+
+    virtual void fillRect(int16_t _x, int16_t _y, int16_t _w, int16_t _h, uint16_t _color)
+    {
+        for (int16_t i = _x; i < _x + _w; i++)
+            drawFastVLine(i, _y, _h, _color);
+    }
+
+    virtual void fillScreen(uint16_t _color)
+    {
+        fillRect(0, 0, _width, _height, _color);
+    }
+
+    // Bresenham (straight lines go to the fast line functions)
+    virtual void drawLine(int16_t _x0, int16_t _y0, int16_t _x1, int16_t _y1, uint16_t _color)
+    {
+        if (_x0 == _x1)
+        {
+            if (_y0 > _y1)
+                std::swap(_y0, _y1);
+            drawFastVLine(_x0, _y0, _y1 - _y0 + 1, _color);
+            return;
+        }
+        if (_y0 == _y1)
+        {
+            if (_x0 > _x1)
+                std::swap(_x0, _x1);
+            drawFastHLine(_x0, _y0, _x1 - _x0 + 1, _color);
+            return;
+        }
+        bool steep = abs(_y1 - _y0) > abs(_x1 - _x0);
+        if (steep)
+        {
+            std::swap(_x0, _y0);
+            std::swap(_x1, _y1);
+        }
+        if (_x0 > _x1)
+        {
+            std::swap(_x0, _x1);
+            std::swap(_y0, _y1);
+        }
+        int16_t dx = _x1 - _x0;
+        int16_t dy = abs(_y1 - _y0);
+        int16_t err = dx / 2;
+        int16_t ystep = (_y0 < _y1) ? 1 : -1;
+        for (; _x0 <= _x1; _x0++)
+        {
+            if (steep)
+                drawPixel(_y0, _x0, _color);
+            else
+                drawPixel(_x0, _y0, _color);
+            err -= dy;
+            if (err < 0)
+            {
+                _y0 += ystep;
+                err += dx;
+            }
+        }
+    }
+
+    // 1 bit bitmap, rows padded to bytes, MSB first, 0 bits are transparent
+    void drawBitmap(int16_t _x, int16_t _y, const uint8_t _bitmap[], int16_t _w, int16_t _h, uint16_t _color)
+    {
+        int16_t byteWidth = (_w + 7) / 8;
+        uint8_t b = 0;
+        for (int16_t j = 0; j < _h; j++, _y++)
+        {
+            for (int16_t i = 0; i < _w; i++)
+            {
+                if (i & 7)
+                    b <<= 1;
+                else
+                    b = _bitmap[j * byteWidth + i / 8];
+                if (b & 0x80)
+                    drawPixel(_x + i, _y, _color);
+            }
+        }
+    }
+
+    void drawChar(int16_t _x, int16_t _y, unsigned char _c, uint16_t _color, uint16_t _bg, uint8_t _size)
+    {
+        if (_x >= _width || _y >= _height || (_x + 6 * _size - 1) < 0 || (_y + 8 * _size - 1) < 0)
+            return;
+        const uint8_t *glyph = (_c >= 0x20 && _c <= 0x7e) ? hostFont[_c - 0x20] : hostFont[0];
+        for (int8_t i = 0; i < 5; i++)
+        {
+            uint8_t line = glyph[i];
+            for (int8_t j = 0; j < 8; j++, line >>= 1)
+            {
+                if (line & 1)
+                    fillRect(_x + i * _size, _y + j * _size, _size, _size, _color);
+                else if (_bg != _color)
+                    fillRect(_x + i * _size, _y + j * _size, _size, _size, _bg);
+            }
+        }
+        if (_bg != _color)
+            fillRect(_x + 5 * _size, _y, _size, 8 * _size, _bg);
+    }
+
+    size_t write(uint8_t _c)
+    {
+        if (_c == '\n')
+        {
+            cursor_x = 0;
+            cursor_y += textsize_y * 8;
+        }
+        else if (_c != '\r')
+        {
+            if (wrap && (cursor_x + textsize_x * 6 > _width))
+            {
+                cursor_x = 0;
+                cursor_y += textsize_y * 8;
+            }
+            drawChar(cursor_x, cursor_y, _c, textcolor, textbgcolor, textsize_x);
+            cursor_x += textsize_x * 6;
+        }
+        return 1;
+    }
+
+    size_t print(const char *_s)
+    {
+        size_t n = 0;
+        while (*_s)
+            n += write(static_cast<uint8_t>(*_s++));
+        return n;
+    }
+
+    size_t print(const String &_s)
+    {
+        return print(_s.c_str());
+    }
+
+    void setCursor(int16_t _x, int16_t _y)
+    {
+        cursor_x = _x;
+        cursor_y = _y;
+    }
+
+    void setTextColor(uint16_t _c)
+    {
+        textcolor = textbgcolor = _c; // transparent background
+    }
+
+    void setTextColor(uint16_t _c, uint16_t _bg)
+    {
+        textcolor = _c;
+        textbgcolor = _bg;
+    }
+
+    void setTextSize(uint8_t _s)
+    {
+        textsize_x = textsize_y = (_s > 0) ? _s : 1;
+    }
+
+    void setTextWrap(bool _w)
+    {
+        wrap = _w;
+    }
+
+    int16_t width() const
+    {
+        return _width;
+    }
+
+    int16_t height() const
+    {
+        return _height;
+    }
+
+    int16_t getCursorX() const
+    {
+        return cursor_x;
+    }
+
+    int16_t getCursorY() const
+    {
+        return cursor_y;
+    }
+};
+
+class Adafruit_SSD1306 : public Adafruit_GFX
+{
+protected:
+    TwoWire *wire;
+    uint8_t *buffer = nullptr;
+    int8_t i2caddr = 0x3C;
+    uint32_t wireClk;
+    uint32_t restoreClk;
+
+    void ssd1306_command1(uint8_t _c)
+    {
+        wire->beginTransmission(i2caddr);
+        wire->write(static_cast<uint8_t>(0x00)); // command stream
+        wire->write(_c);
+        wire->endTransmission();
+    }
+
+    void ssd1306_commandList(const uint8_t *_c, uint8_t _n)
+    {
+        wire->beginTransmission(i2caddr);
+        wire->write(static_cast<uint8_t>(0x00)); // command stream
+        for (uint8_t i = 0; i < _n; i++)
+        {
+            if (wire->write(_c[i]) == 0)
+            {
+                // buffer full, start a new transmission
+                wire->endTransmission();
+                wire->beginTransmission(i2caddr);
+                wire->write(static_cast<uint8_t>(0x00));
+                wire->write(_c[i]);
+            }
+        }
+        wire->endTransmission();
+    }
+
+public:
+    Adafruit_SSD1306(uint8_t _w, uint8_t _h, TwoWire *_twi, int8_t _rst_pin = -1, uint32_t _clkDuring = 400000, uint32_t _clkAfter = 100000)
+        : Adafruit_GFX(_w, _h), wire(_twi), wireClk(_clkDuring), restoreClk(_clkAfter) {}
+
+    ~Adafruit_SSD1306()
+    {
+        free(buffer);
+    }
+
+    // allocates the buffer (once), clears it and sends the init sequence
+    bool begin(uint8_t _switchvcc = SSD1306_SWITCHCAPVCC, uint8_t _i2caddr = 0x3C, bool _reset = true, bool _periphBegin = true)
+    {
+        if (!buffer && !(buffer = static_cast<uint8_t *>(malloc(_width * ((_height + 7) / 8)))))
+            return false;
+        clearDisplay();
+        i2caddr = _i2caddr;
+        if (_periphBegin)
+            wire->begin();
+        const uint8_t init[] = {SSD1306_DISPLAYOFF, 0xD5, 0x80, 0xA8, static_cast<uint8_t>(_height - 1), 0xD3, 0x00, SSD1306_SETSTARTLINE,
+                                0x8D, static_cast<uint8_t>(_switchvcc == SSD1306_EXTERNALVCC ? 0x10 : 0x14), 0x20, 0x00, 0xA1, 0xC8, SSD1306_DISPLAYON};
+        ssd1306_commandList(init, sizeof(init));
+        return true;
+    }
+
+    // full frame: window over the whole display, then the buffer in chunks
+    void display()
+    {
+        const uint8_t window[] = {SSD1306_PAGEADDR, 0, 0xff, SSD1306_COLUMNADDR, 0, static_cast<uint8_t>(_width - 1)};
+        ssd1306_commandList(window, sizeof(window));
+        uint16_t n = _width * ((_height + 7) / 8);
+        for (uint16_t i = 0; i < n;)
+        {
+            wire->beginTransmission(i2caddr);
+            wire->write(static_cast<uint8_t>(0x40)); // data stream
+            for (uint8_t j = 1; j < 32 && i < n; j++)
+                wire->write(buffer[i++]);
+            wire->endTransmission();
+        }
+    }
+
+    void clearDisplay()
+    {
+        memset(buffer, 0, _width * ((_height + 7) / 8));
+    }
+
+    void drawPixel(int16_t _x, int16_t _y, uint16_t _color) override
+    {
+        if (_x < 0 || _x >= _width || _y < 0 || _y >= _height)
+            return;
+        uint8_t &byte = buffer[_x + (_y / 8) * _width];
+        uint8_t bit = 1 << (_y & 7);
+        if (_color == SSD1306_WHITE)
+            byte |= bit;
+        else if (_color == SSD1306_BLACK)
+            byte &= ~bit;
+        else if (_color == SSD1306_INVERSE)
+            byte ^= bit;
+    }
+
+    bool getPixel(int16_t _x, int16_t _y) const
+    {
+        if (_x < 0 || _x >= _width || _y < 0 || _y >= _height)
+            return false;
+        return buffer[_x + (_y / 8) * _width] & (1 << (_y & 7));
+    }
+
+    uint8_t *getBuffer()
+    {
+        return buffer;
+    }
+};
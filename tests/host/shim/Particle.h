@@ -0,0 +1,646 @@
+/**
+ * Host stand-in for the parts of the Device OS API used by the drivers.
+ * Time is virtual: millis()/micros() only move when the code waits (delay, delayMicroseconds),
+ * when a bus transaction takes time on the virtual I2C bus, or when a test calls hostAdvance_us().
+ * Wire talks to the chip models attached to the virtual bus (see virtualI2C.h).
+ */
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cstdarg>
+#include <cmath>
+#include <string>
+#include <functional>
+#include <vector>
+#include <chrono>
+#include <ctime>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+
+using namespace std::chrono_literals;
+typedef uint8_t byte;
+typedef unsigned int uint;
+typedef uint32_t system_tick_t;
+
+// --- time ---
+
+inline uint64_t &hostTime_us()
+{
+    static uint64_t now_us = 0;
+    return now_us;
+}
+
+inline void hostAdvance_us(uint64_t _us)
+{
+    hostTime_us() += _us;
+}
+
+inline uint32_t millis() { return static_cast<uint32_t>(hostTime_us() / 1000); }
+inline uint32_t micros() { return static_cast<uint32_t>(hostTime_us()); }
+inline void delay(uint32_t _ms) { hostAdvance_us(static_cast<uint64_t>(_ms) * 1000); }
+inline void delayMicroseconds(uint32_t _us) { hostAdvance_us(_us); }
+
+// --- random numbers (deterministic, same sequence for the same seed) ---
+
+inline uint32_t &hostRandomState()
+{
+    static uint32_t state = 1;
+    return state;
+}
+
+inline void randomSeed(unsigned int _seed)
+{
+    hostRandomState() = _seed ? _seed : 1;
+}
+
+inline int32_t random(int32_t _max)
+{
+    if (_max <= 0)
+        return 0;
+    // xorshift32
+    uint32_t &x = hostRandomState();
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    return static_cast<int32_t>(x % static_cast<uint32_t>(_max));
+}
+
+inline int32_t random(int32_t _min, int32_t _max)
+{
+    return (_max > _min) ? _min + random(_max - _min) : _min;
+}
+
+// --- system ---
+
+#define SYSTEM_ERROR_NONE 0
+#define SYSTEM_MODE(x)
+#define SYSTEM_THREAD(x)
+#define PROGMEM
+#define CLOCK_SPEED_100KHZ 100000
+#define CLOCK_SPEED_400KHZ 400000
+
+// Device OS style scoped lock: WITH_LOCK(Wire) { ... }
+#define WITH_LOCK(_lock) for (bool _locked = ((_lock).lock(), true); _locked; (_lock).unlock(), _locked = false)
+
+// no interrupts on the host, atomic blocks just run
+#define ATOMIC_BLOCK() for (bool _atomic = true; _atomic; _atomic = false)
+#define SINGLE_THREADED_BLOCK() ATOMIC_BLOCK()
+
+#ifndef TRUE
+#define TRUE 1
+#define FALSE 0
+#endif
+
+/**
+ * @brief system information (free memory comes from the host allocation counters, see hostHeap())
+ */
+struct ThostHeap
+{
+    uint64_t allocations = 0;
+    uint64_t frees = 0;
+    int64_t bytes = 0;
+};
+
+inline ThostHeap &hostHeap()
+{
+    static ThostHeap heap;
+    return heap;
+}
+
+class SystemClass
+{
+public:
+    uint32_t freeMemory()
+    {
+        const int64_t total = 128 * 1024;
+        return static_cast<uint32_t>(total - hostHeap().bytes);
+    }
+    uint32_t millis() { return static_cast<uint32_t>(hostTime_us() / 1000); }
+};
+inline SystemClass System;
+
+// --- threads (the display renders on a worker thread) ---
+
+typedef uint8_t os_thread_prio_t;
+#define OS_THREAD_PRIORITY_DEFAULT 2
+#define CONCURRENT_WAIT_FOREVER ((system_tick_t)-1)
+
+class Thread
+{
+private:
+    std::thread Fthread;
+
+public:
+    Thread(const char *_name, std::function<void()> _function, os_thread_prio_t _priority = OS_THREAD_PRIORITY_DEFAULT, size_t _stack = 0)
+        : Fthread(_function)
+    {
+        Fthread.detach();
+    }
+};
+
+struct ThostSemaphore
+{
+    std::mutex mutex;
+    std::condition_variable ready;
+    unsigned count;
+    unsigned max;
+};
+typedef ThostSemaphore *os_semaphore_t;
+
+inline int os_semaphore_create(os_semaphore_t *_semaphore, unsigned _max, unsigned _initial)
+{
+    *_semaphore = new ThostSemaphore();
+    (*_semaphore)->count = _initial;
+    (*_semaphore)->max = _max;
+    return 0;
+}
+
+inline int os_semaphore_take(os_semaphore_t _semaphore, system_tick_t _timeout, bool _reserved)
+{
+    std::unique_lock<std::mutex> lock(_semaphore->mutex);
+    if (_timeout == CONCURRENT_WAIT_FOREVER)
+        _semaphore->ready.wait(lock, [_semaphore]()
+                               { return _semaphore->count > 0; });
+    else if (!_semaphore->ready.wait_for(lock, std::chrono::milliseconds(_timeout), [_semaphore]()
+                                         { return _semaphore->count > 0; }))
+        return 1;
+    _semaphore->count--;
+    return 0;
+}
+
+inline int os_semaphore_give(os_semaphore_t _semaphore, bool _reserved)
+{
+    {
+        std::lock_guard<std::mutex> lock(_semaphore->mutex);
+        if (_semaphore->count < _semaphore->max)
+            _semaphore->count++;
+    }
+    _semaphore->ready.notify_one();
+    return 0;
+}
+
+class Timer;
+
+// all software timers (hostRunTimers() fires the ones that are due)
+inline std::vector<Timer *> &hostTimers()
+{
+    static std::vector<Timer *> timers;
+    return timers;
+}
+
+/**
+ * @brief Device OS software timer (on the host it fires when a test calls fire() or hostRunTimers())
+ */
+class Timer
+{
+private:
+    std::function<void()> Fcallback;
+    unsigned Fperiod_ms;
+    bool FoneShot;
+    bool Factive = false;
+    uint64_t Fdue_us = 0; // next period end in virtual time
+
+    bool activate()
+    {
+        Fdue_us = hostTime_us() + static_cast<uint64_t>(Fperiod_ms) * 1000;
+        return Factive = true;
+    }
+
+public:
+    Timer(unsigned _period_ms, std::function<void()> _callback, bool _oneShot = false)
+        : Fcallback(_callback), Fperiod_ms(_period_ms), FoneShot(_oneShot)
+    {
+        hostTimers().push_back(this);
+    }
+
+    template <typename T>
+    Timer(unsigned _period_ms, void (T::*_callback)(), T &_instance, bool _oneShot = false)
+        : Timer(_period_ms, std::bind(_callback, &_instance), _oneShot) {}
+
+    ~Timer()
+    {
+        std::vector<Timer *> &timers = hostTimers();
+        for (size_t i = 0; i < timers.size(); i++)
+        {
+            if (timers[i] == this)
+            {
+                timers.erase(timers.begin() + i);
+                break;
+            }
+        }
+    }
+
+    bool start(unsigned _block = 0) { return activate(); }
+    bool stop(unsigned _block = 0) { return !(Factive = false); }
+    bool reset(unsigned _block = 0) { return activate(); }
+    bool changePeriod(unsigned _period_ms, unsigned _block = 0)
+    {
+        Fperiod_ms = _period_ms;
+        return activate();
+    }
+    bool isActive() const { return Factive; }
+
+    // virtual time of the next period end
+    uint64_t due_us() const { return Fdue_us; }
+
+    void fire()
+    {
+        if (!Factive)
+            return;
+        if (FoneShot)
+            Factive = false;
+        else
+            Fdue_us += static_cast<uint64_t>(Fperiod_ms) * 1000;
+        Fcallback();
+    }
+};
+
+// fire the timers whose period ended (once each, in the order they were created)
+inline void hostRunTimers()
+{
+    std::vector<Timer *> &timers = hostTimers();
+    for (size_t i = 0; i < timers.size(); i++)
+    {
+        if (timers[i]->isActive() && timers[i]->due_us() <= hostTime_us())
+            timers[i]->fire();
+    }
+}
+
+// --- pins (SDA and SCL are routed to the virtual I2C bus) ---
+
+enum PinMode
+{
+    INPUT,
+    OUTPUT,
+    INPUT_PULLUP,
+    INPUT_PULLDOWN,
+    OUTPUT_OPEN_DRAIN
+};
+enum
+{
+    LOW = 0,
+    HIGH = 1
+};
+enum
+{
+    D0 = 0, D1, D2, D3, D4, D5, D6, D7, D8, D9, D10,
+    A0 = 11, A1, A2, A3, A4, A5
+};
+#define SDA D0
+#define SCL D1
+
+void pinMode(uint16_t _pin, PinMode _mode);
+void digitalWrite(uint16_t _pin, uint8_t _value);
+int32_t digitalRead(uint16_t _pin);
+
+// analog pins read what the test sets (12 bit), PWM outputs keep the last value
+inline uint16_t *hostAnalog()
+{
+    static uint16_t values[A5 + 1] = {0};
+    return values;
+}
+
+inline int32_t analogRead(uint16_t _pin)
+{
+    return (_pin <= A5) ? hostAnalog()[_pin] : 0;
+}
+
+inline void analogWrite(uint16_t _pin, uint32_t _value, uint32_t _frequency = 0)
+{
+    if (_pin <= A5)
+        hostAnalog()[_pin] = static_cast<uint16_t>(_value);
+}
+
+inline void analogWriteResolution(uint16_t _pin, uint8_t _bits) {}
+
+// interrupts are raised by the tests (hostInterrupt())
+typedef enum
+{
+    CHANGE,
+    RISING,
+    FALLING
+} InterruptMode;
+
+inline std::function<void()> *hostInterruptHandlers()
+{
+    static std::function<void()> handlers[A5 + 1];
+    return handlers;
+}
+
+// raise the interrupt of a pin (e.g. a decoder edge)
+inline void hostInterrupt(uint16_t _pin)
+{
+    if (_pin <= A5 && hostInterruptHandlers()[_pin])
+        hostInterruptHandlers()[_pin]();
+}
+
+inline uint16_t digitalPinToInterrupt(uint16_t _pin) { return _pin; }
+inline bool attachInterrupt(uint16_t _pin, std::function<void()> _handler, InterruptMode _mode, int8_t _priority = -1, uint8_t _subpriority = 0)
+{
+    if (_pin > A5)
+        return false;
+    hostInterruptHandlers()[_pin] = _handler;
+    return true;
+}
+template <typename T>
+inline bool attachInterrupt(uint16_t _pin, void (T::*_handler)(), T *_instance, InterruptMode _mode, int8_t _priority = -1, uint8_t _subpriority = 0)
+{
+    return attachInterrupt(_pin, std::bind(_handler, _instance), _mode, _priority, _subpriority);
+}
+inline bool detachInterrupt(uint16_t _pin)
+{
+    if (_pin <= A5)
+        hostInterruptHandlers()[_pin] = nullptr;
+    return true;
+}
+
+// binary constants (B00000000 to B11111111)
+#include "binary.h"
+
+// --- strings ---
+
+class String
+{
+private:
+    std::string Fs;
+
+public:
+    String() {}
+    String(const char *_s) : Fs(_s ? _s : "") {}
+    String(const std::string &_s) : Fs(_s) {}
+    String(char _c) : Fs(1, _c) {}
+    String(int _v) : Fs(std::to_string(_v)) {}
+    String(unsigned int _v) : Fs(std::to_string(_v)) {}
+    String(long _v) : Fs(std::to_string(_v)) {}
+    String(unsigned long _v) : Fs(std::to_string(_v)) {}
+    String(double _v, int _decimals = 2)
+    {
+        char buf[32];
+        snprintf(buf, sizeof(buf), "%.*f", _decimals, _v);
+        Fs = buf;
+    }
+    const char *c_str() const { return Fs.c_str(); }
+    size_t length() const { return Fs.length(); }
+    void reserve(size_t _n) { Fs.reserve(_n); }
+    String &operator+=(const String &_s)
+    {
+        Fs += _s.Fs;
+        return *this;
+    }
+    String &operator+=(const char *_s)
+    {
+        Fs += _s;
+        return *this;
+    }
+    String &operator+=(char _c)
+    {
+        Fs += _c;
+        return *this;
+    }
+    String operator+(const String &_s) const { return String(Fs + _s.Fs); }
+    String operator+(const char *_s) const { return String(Fs + _s); }
+    bool operator==(const String &_s) const { return Fs == _s.Fs; }
+    bool operator==(const char *_s) const { return Fs == _s; }
+    bool operator!=(const String &_s) const { return Fs != _s.Fs; }
+    bool operator!=(const char *_s) const { return Fs != _s; }
+};
+inline String operator+(const char *_a, const String &_b) { return String(_a) + _b; }
+
+// --- logging (set HOST_LOG=trace|info|warn to see the driver log) ---
+
+#define LOG_LEVEL_ALL 1
+#define LOG_LEVEL_TRACE 1
+#define LOG_LEVEL_INFO 30
+#define LOG_LEVEL_WARN 40
+#define LOG_LEVEL_ERROR 50
+#define LOG_LEVEL_NONE 70
+
+class Logger
+{
+private:
+    int Flevel = -1;
+
+    int level()
+    {
+        if (Flevel < 0)
+        {
+            const char *env = getenv("HOST_LOG");
+            if (env == nullptr)
+                Flevel = LOG_LEVEL_NONE;
+            else if (strcmp(env, "trace") == 0)
+                Flevel = LOG_LEVEL_TRACE;
+            else if (strcmp(env, "info") == 0)
+                Flevel = LOG_LEVEL_INFO;
+            else
+                Flevel = LOG_LEVEL_WARN;
+        }
+        return Flevel;
+    }
+
+    void log(int _level, const char *_tag, const char *_fmt, va_list _args)
+    {
+        if (_level < level())
+            return;
+        fprintf(stderr, "%10lu [%s] ", static_cast<unsigned long>(millis()), _tag);
+        vfprintf(stderr, _fmt, _args);
+        fputc('\n', stderr);
+    }
+
+public:
+    void trace(const char *_fmt, ...) __attribute__((format(printf, 2, 3)))
+    {
+        va_list args;
+        va_start(args, _fmt);
+        log(LOG_LEVEL_TRACE, "trace", _fmt, args);
+        va_end(args);
+    }
+    void info(const char *_fmt, ...) __attribute__((format(printf, 2, 3)))
+    {
+        va_list args;
+        va_start(args, _fmt);
+        log(LOG_LEVEL_INFO, "info", _fmt, args);
+        va_end(args);
+    }
+    void warn(const char *_fmt, ...) __attribute__((format(printf, 2, 3)))
+    {
+        va_list args;
+        va_start(args, _fmt);
+        log(LOG_LEVEL_WARN, "warn", _fmt, args);
+        va_end(args);
+    }
+    void error(const char *_fmt, ...) __attribute__((format(printf, 2, 3)))
+    {
+        va_list args;
+        va_start(args, _fmt);
+        log(LOG_LEVEL_ERROR, "error", _fmt, args);
+        va_end(args);
+    }
+};
+inline Logger Log;
+
+class SerialLogHandler
+{
+public:
+    SerialLogHandler(int _level) {}
+};
+
+// --- cloud and time (offline until a test connects, the clock is invalid until a test sets it) ---
+
+class CloudClass
+{
+public:
+    bool isConnected = false;
+    bool publishFails = false;
+    uint32_t published = 0;
+    std::string lastEvent;
+    std::string lastData;
+
+    bool connected() { return isConnected; }
+    void connect() { isConnected = true; }
+    void disconnect() { isConnected = false; }
+    bool process() { return true; }
+
+    bool publish(const char *_event, const char *_data = nullptr)
+    {
+        if (!isConnected || publishFails)
+            return false;
+        published++;
+        lastEvent = _event;
+        lastData = _data ? _data : "";
+        return true;
+    }
+
+    bool publish(const String &_event, const String &_data)
+    {
+        return publish(_event.c_str(), _data.c_str());
+    }
+};
+inline CloudClass Particle;
+
+class TimeClass
+{
+public:
+    int64_t offset_s = -1; // unix time at millis() == 0 (-1 = not set)
+
+    bool isValid() { return offset_s >= 0; }
+    void setTime(uint32_t _unix) { offset_s = static_cast<int64_t>(_unix) - millis() / 1000; }
+    uint32_t now() { return isValid() ? static_cast<uint32_t>(offset_s + millis() / 1000) : millis() / 1000; }
+    int hour() { return (now() / 3600) % 24; }
+    int minute() { return (now() / 60) % 60; }
+    int second() { return now() % 60; }
+    String format(uint32_t _unix, const char *_format)
+    {
+        time_t t = _unix;
+        char buf[64];
+        strftime(buf, sizeof(buf), _format, gmtime(&t));
+        return String(buf);
+    }
+    String format(const char *_format) { return format(now(), _format); }
+};
+inline TimeClass Time;
+#define TIME_FORMAT_ISO8601_FULL "%Y-%m-%dT%H:%M:%SZ"
+
+// --- I2C ---
+
+#include "virtualI2C.h"
+
+/**
+ * @brief Wire on the virtual bus
+ * same buffering as Device OS: writes are collected until endTransmission(), requestFrom() fills the receive buffer
+ */
+class TwoWire
+{
+private:
+    static constexpr uint8_t FbufferSize = 32;
+    std::recursive_mutex Fmutex;
+    bool Fenabled = false;
+    uint32_t Fclock_Hz = CLOCK_SPEED_100KHZ;
+    uint8_t Faddress = 0;
+    uint8_t Ftx[FbufferSize];
+    uint8_t FtxN = 0;
+    uint8_t Frx[FbufferSize];
+    uint8_t FrxN = 0;
+    uint8_t FrxPos = 0;
+
+public:
+    void begin()
+    {
+        Fenabled = true;
+        virtualI2C().setClock(Fclock_Hz);
+    }
+    void end() { Fenabled = false; }
+    bool isEnabled() { return Fenabled; }
+    void setSpeed(uint32_t _clock_Hz) { Fclock_Hz = _clock_Hz; }
+    void lock() { Fmutex.lock(); }
+    void unlock() { Fmutex.unlock(); }
+
+    void beginTransmission(uint8_t _address)
+    {
+        Faddress = _address;
+        FtxN = 0;
+    }
+
+    size_t write(uint8_t _byte)
+    {
+        if (FtxN >= FbufferSize)
+            return 0;
+        Ftx[FtxN++] = _byte;
+        return 1;
+    }
+
+    size_t write(const uint8_t *_bytes, size_t _n)
+    {
+        size_t n = 0;
+        while (n < _n && write(_bytes[n]))
+            n++;
+        return n;
+    }
+
+    uint8_t endTransmission(bool _stop = true)
+    {
+        if (!Fenabled)
+            return 1;
+        return virtualI2C().write(Faddress, Ftx, FtxN, _stop);
+    }
+
+    uint8_t requestFrom(uint8_t _address, uint8_t _n, uint8_t _stop = true)
+    {
+        FrxPos = 0;
+        FrxN = 0;
+        if (!Fenabled)
+            return 0;
+        if (_n > FbufferSize)
+            _n = FbufferSize;
+        FrxN = virtualI2C().read(_address, Frx, _n);
+        return FrxN;
+    }
+
+    int available() { return FrxN - FrxPos; }
+    int read() { return (FrxPos < FrxN) ? Frx[FrxPos++] : -1; }
+};
+inline TwoWire Wire;
+
+// pins: SDA/SCL go to the virtual bus, everything else is ignored
+inline void pinMode(uint16_t _pin, PinMode _mode)
+{
+    if (_pin == SDA || _pin == SCL)
+        virtualI2C().pinMode(_pin == SDA, _mode == OUTPUT || _mode == OUTPUT_OPEN_DRAIN);
+}
+
+inline void digitalWrite(uint16_t _pin, uint8_t _value)
+{
+    if (_pin == SDA || _pin == SCL)
+        virtualI2C().digitalWrite(_pin == SDA, _value == HIGH);
+}
+
+inline int32_t digitalRead(uint16_t _pin)
+{
+    if (_pin == SDA || _pin == SCL)
+        return virtualI2C().digitalRead(_pin == SDA) ? HIGH : LOW;
+    return LOW;
+}
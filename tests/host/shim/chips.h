@@ -0,0 +1,400 @@
+/**
+ * Register models of the I2C chips on the reader board for the virtual bus (see virtualI2C.h).
+ * Power-on defaults, register pointers, auto-increment and read-only bits follow the datasheets
+ * so the drivers' writes, read-backs and shadows are exercised against the real register behavior.
+ */
+#pragma once
+
+#include "Particle.h"
+
+/**
+ * @brief TCA9534 8-bit I/O expander
+ * registers: 0 input (read-only), 1 output, 2 polarity inversion, 3 configuration (1 = input)
+ * the command byte selects the register, there is no auto-increment (repeated bytes go to the same register)
+ */
+class TvirtualTCA9534 : public TvirtualI2Cdevice
+{
+public:
+    static constexpr uint8_t inputRegister = 0x00;
+    static constexpr uint8_t outputRegister = 0x01;
+    static constexpr uint8_t polarityRegister = 0x02;
+    static constexpr uint8_t configRegister = 0x03;
+
+    uint8_t regs[4] = {0x00, 0xff, 0x00, 0xff};
+    uint8_t pins = 0xff;  // levels applied to the input pins from outside
+    uint8_t pointer = 0;
+    uint32_t registerWrites[4] = {0};
+    uint32_t registerReads[4] = {0};
+
+    // pin levels: inputs from outside, outputs from the output register
+    uint8_t levels() const
+    {
+        return (regs[configRegister] & pins) | (~regs[configRegister] & regs[outputRegister]);
+    }
+
+    bool receive(const uint8_t *_bytes, uint8_t _n) override
+    {
+        if (_n == 0)
+            return true; // address probe
+        if (_bytes[0] > configRegister)
+            return false; // invalid command
+        pointer = _bytes[0];
+        for (uint8_t i = 1; i < _n; i++)
+        {
+            if (pointer != inputRegister)
+                regs[pointer] = _bytes[i];
+            registerWrites[pointer]++;
+        }
+        return true;
+    }
+
+    void transmit(uint8_t *_bytes, uint8_t _n) override
+    {
+        for (uint8_t i = 0; i < _n; i++)
+            _bytes[i] = (pointer == inputRegister) ? (levels() ^ regs[polarityRegister]) : regs[pointer];
+        registerReads[pointer]++;
+    }
+};
+
+/**
+ * @brief PCA9633 4-channel LED driver
+ * registers 0x00-0x0c: MODE1, MODE2, PWM0-3, GRPPWM, GRPFREQ, LEDOUT, SUBADR1-3, ALLCALLADR
+ * control byte: bits 7:5 auto-increment flags, bits 3:0 register pointer
+ * MODE1 bits 7:5 read back the auto-increment flags, MODE2 bits 7:6 are reserved (read 0)
+ */
+class TvirtualPCA9633 : public TvirtualI2Cdevice
+{
+public:
+    static constexpr uint8_t registersN = 13;
+    static constexpr uint8_t mode1 = 0x00;
+    static constexpr uint8_t mode2 = 0x01;
+    static constexpr uint8_t pwm0 = 0x02;
+    static constexpr uint8_t grpPwm = 0x06;
+    static constexpr uint8_t grpFreq = 0x07;
+    static constexpr uint8_t ledOut = 0x08;
+
+    uint8_t regs[registersN] = {0x11, 0x05, 0x00, 0x00, 0x00, 0x00, 0xff, 0x00, 0x00, 0xe2, 0xe4, 0xe8, 0xe0};
+    uint8_t pointer = 0;
+    uint8_t autoIncrement = 0; // AI2:AI0 of the last control byte
+
+    // last write (for checking delta writes)
+    uint8_t lastFirst = 0;
+    uint8_t lastN = 0;
+
+    // next register for the auto-increment mode
+    uint8_t increment(uint8_t _register) const
+    {
+        switch (autoIncrement)
+        {
+        case 0b100: // all registers
+            return (_register + 1) % registersN;
+        case 0b101: // individual brightness
+            return (_register >= 0x05 || _register < 0x02) ? 0x02 : _register + 1;
+        case 0b110: // global control
+            return (_register == 0x06) ? 0x07 : 0x06;
+        case 0b111: // individual and global control
+            return (_register >= 0x07 || _register < 0x02) ? 0x02 : _register + 1;
+        default:
+            return _register;
+        }
+    }
+
+    bool receive(const uint8_t *_bytes, uint8_t _n) override
+    {
+        if (_n == 0)
+            return true; // address probe
+        autoIncrement = _bytes[0] >> 5;
+        pointer = _bytes[0] & 0x0f;
+        if (pointer >= registersN)
+            return false;
+        lastFirst = pointer;
+        lastN = _n - 1;
+        for (uint8_t i = 1; i < _n; i++)
+        {
+            if (pointer == mode1)
+                regs[mode1] = _bytes[i] & 0x1f;
+            else if (pointer == mode2)
+                regs[mode2] = _bytes[i] & 0x3f;
+            else
+                regs[pointer] = _bytes[i];
+            pointer = increment(pointer);
+        }
+        return true;
+    }
+
+    void transmit(uint8_t *_bytes, uint8_t _n) override
+    {
+        for (uint8_t i = 0; i < _n; i++)
+        {
+            _bytes[i] = (pointer == mode1) ? (regs[mode1] | (autoIncrement << 5)) : regs[pointer];
+            pointer = increment(pointer);
+        }
+    }
+
+    // output state of a channel (0 = off, 1 = on, 2 = individual, 3 = individual + group)
+    uint8_t output(uint8_t _channel) const
+    {
+        return (regs[ledOut] >> (2 * _channel)) & 0x03;
+    }
+};
+
+/**
+ * @brief MCP4017 and AD5246 7-bit rheostats (single volatile wiper register, power-on mid-scale)
+ * write: one data byte, bit 7 is ignored; read: one byte with the wiper in bits 6:0,
+ * bit 7 reads 0 on the MCP4017 and is undefined on the AD5246 (the model returns 1, the driver masks it)
+ */
+class TvirtualRheostat7 : public TvirtualI2Cdevice
+{
+public:
+    uint8_t wiper = 0x3f;
+    bool msbUndefined = false;
+    uint32_t wiperWrites = 0;
+
+    // _msbUndefined: AD5246 (bit 7 of a read is undefined)
+    TvirtualRheostat7(bool _msbUndefined = false)
+        : wiper(_msbUndefined ? 0x40 : 0x3f), msbUndefined(_msbUndefined) {}
+
+    bool receive(const uint8_t *_bytes, uint8_t _n) override
+    {
+        if (_n == 0)
+            return true; // address probe
+        if (_n > 1)
+            return false; // only one data byte per frame
+        wiper = _bytes[0] & 0x7f;
+        wiperWrites++;
+        return true;
+    }
+
+    void transmit(uint8_t *_bytes, uint8_t _n) override
+    {
+        for (uint8_t i = 0; i < _n; i++)
+            _bytes[i] = msbUndefined ? (wiper | 0x80) : wiper;
+    }
+};
+
+/**
+ * @brief AD5241 8-bit rheostat (power-on mid-scale 0x80)
+ * write: instruction byte (bit 7 RDAC select, must be 0 on the single channel AD5241, bit 6 mid-scale reset,
+ * bit 5 shutdown, bits 4:3 logic outputs) followed by the data byte; an instruction without data only
+ * executes the reset/shutdown bits; read: the 8-bit wiper
+ */
+class TvirtualAD5241 : public TvirtualI2Cdevice
+{
+public:
+    static constexpr uint8_t rdacB = 0x80;
+    static constexpr uint8_t midScaleReset = 0x40;
+    static constexpr uint8_t shutdownBit = 0x20;
+
+    uint8_t wiper = 0x80;
+    uint8_t instruction = 0;
+    bool shutdown = false;
+    uint32_t wiperWrites = 0;
+
+    bool receive(const uint8_t *_bytes, uint8_t _n) override
+    {
+        if (_n == 0)
+            return true; // address probe
+        if (_n > 2 || (_bytes[0] & rdacB))
+            return false; // one instruction and one data byte, only RDAC A
+        instruction = _bytes[0];
+        shutdown = instruction & shutdownBit;
+        if (instruction & midScaleReset)
+            wiper = 0x80;
+        else if (_n == 2)
+        {
+            wiper = _bytes[1];
+            wiperWrites++;
+        }
+        return true;
+    }
+
+    void transmit(uint8_t *_bytes, uint8_t _n) override
+    {
+        for (uint8_t i = 0; i < _n; i++)
+            _bytes[i] = wiper;
+    }
+};
+
+/**
+ * @brief TMP117 temperature sensor (continuous conversion mode)
+ * 16 bit registers (MSB first): 0x00 temperature, 0x01 configuration, 0x0f device ID
+ * configuration: bit 13 data ready (cleared by reading the configuration or temperature),
+ * bits 9:7 conversion cycle, bits 6:5 averaging, bits 11:2 writable
+ */
+class TvirtualTMP117 : public TvirtualI2Cdevice
+{
+private:
+    // cycle times [ms] for CONV and minimum cycle for AVG (datasheet Table 7-7)
+    static constexpr uint16_t FcycleTimes_ms[8] = {16, 125, 250, 500, 1000, 4000, 8000, 16000};
+    static constexpr uint16_t FaveragingTimes_ms[4] = {16, 125, 500, 1000};
+    static constexpr uint16_t FdataReady = 1 << 13;
+    static constexpr uint16_t Fwritable = 0x0ffc;
+
+    uint32_t FnextConversion_ms = 0;
+
+    // run the conversions that finished since the last access
+    void convert()
+    {
+        uint32_t now = millis();
+        while (static_cast<int32_t>(now - FnextConversion_ms) >= 0)
+        {
+            regs[temperatureRegister] = static_cast<uint16_t>(static_cast<int16_t>(lround(temperature_C / 0.0078125)));
+            regs[configRegister] |= FdataReady;
+            conversions++;
+            FnextConversion_ms += chipCycle_ms();
+        }
+    }
+
+public:
+    static constexpr uint8_t temperatureRegister = 0x00;
+    static constexpr uint8_t configRegister = 0x01;
+    static constexpr uint8_t idRegister = 0x0f;
+
+    uint16_t regs[16] = {0x8000, 0x0220, 0x6000, 0x8000, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0x0117};
+    uint8_t pointer = 0;
+    float temperature_C = 25.0f;
+    float clockError = 0; // the chip's conversion clock (0.1 = cycles take 10% longer than configured)
+    uint32_t conversions = 0;
+    uint32_t configWrites = 0;
+
+    TvirtualTMP117()
+    {
+        FnextConversion_ms = millis() + cycle_ms();
+    }
+
+    // time between conversions with the chip's clock error
+    uint32_t chipCycle_ms() const
+    {
+        return static_cast<uint32_t>(lround(cycle_ms() * (1.0f + clockError)));
+    }
+
+    // time between conversions
+    uint32_t cycle_ms() const
+    {
+        uint16_t cycle = FcycleTimes_ms[(regs[configRegister] >> 7) & 0x07];
+        uint16_t averaging = FaveragingTimes_ms[(regs[configRegister] >> 5) & 0x03];
+        return (averaging > cycle) ? averaging : cycle;
+    }
+
+    bool receive(const uint8_t *_bytes, uint8_t _n) override
+    {
+        if (_n == 0)
+            return true; // address probe
+        convert();
+        pointer = _bytes[0] & 0x0f;
+        if (_n >= 3 && pointer == configRegister)
+        {
+            uint16_t value = static_cast<uint16_t>((_bytes[1] << 8) | _bytes[2]);
+            regs[configRegister] = (regs[configRegister] & ~Fwritable) | (value & Fwritable);
+            configWrites++;
+            // a new configuration restarts the conversion cycle
+            FnextConversion_ms = millis() + chipCycle_ms();
+        }
+        return true;
+    }
+
+    void transmit(uint8_t *_bytes, uint8_t _n) override
+    {
+        convert();
+        uint16_t value = regs[pointer];
+        for (uint8_t i = 0; i < _n; i++)
+            _bytes[i] = (i % 2 == 0) ? (value >> 8) : (value & 0xff);
+        if (pointer == configRegister || pointer == temperatureRegister)
+            regs[configRegister] &= ~FdataReady;
+    }
+};
+
+constexpr uint16_t TvirtualTMP117::FcycleTimes_ms[];
+constexpr uint16_t TvirtualTMP117::FaveragingTimes_ms[];
+
+/**
+ * @brief SSD1306/SSD1309 OLED controller (horizontal addressing mode)
+ * control byte 0x00 = commands follow, 0x40 = display RAM data follows
+ * COLUMNADDR/PAGEADDR set the window, data fills it column by column and wraps to the next page
+ */
+class TvirtualSSD1306 : public TvirtualI2Cdevice
+{
+private:
+    uint8_t Fcommand[3];
+    uint8_t FcommandN = 0;
+
+    // argument bytes of the multi-byte commands
+    static uint8_t arguments(uint8_t _command)
+    {
+        switch (_command)
+        {
+        case 0x21: // COLUMNADDR
+        case 0x22: // PAGEADDR
+            return 2;
+        case 0x20: // memory mode
+        case 0x81: // contrast
+        case 0x8D: // charge pump
+        case 0xA8: // multiplex
+        case 0xD3: // display offset
+        case 0xD5: // clock divide
+        case 0xD9: // precharge
+        case 0xDA: // COM pins
+        case 0xDB: // VCOM detect
+            return 1;
+        default:
+            return 0;
+        }
+    }
+
+    void command(uint8_t _byte)
+    {
+        Fcommand[FcommandN++] = _byte;
+        if (FcommandN <= arguments(Fcommand[0]))
+            return;
+        if (Fcommand[0] == 0x21)
+        {
+            columnStart = column = Fcommand[1] & 0x7f;
+            columnEnd = Fcommand[2] & 0x7f;
+        }
+        else if (Fcommand[0] == 0x22)
+        {
+            pageStart = page = Fcommand[1] & 0x07;
+            pageEnd = Fcommand[2] & 0x07;
+        }
+        commands++;
+        FcommandN = 0;
+    }
+
+    void data(uint8_t _byte)
+    {
+        ram[page * 128 + column] = _byte;
+        dataBytes++;
+        if (column++ == columnEnd)
+        {
+            column = columnStart;
+            page = (page == pageEnd) ? pageStart : page + 1;
+        }
+    }
+
+public:
+    uint8_t ram[128 * 8] = {0};
+    uint8_t columnStart = 0, columnEnd = 127, column = 0;
+    uint8_t pageStart = 0, pageEnd = 7, page = 0;
+    uint32_t commands = 0;
+    uint32_t dataBytes = 0;
+
+    bool receive(const uint8_t *_bytes, uint8_t _n) override
+    {
+        if (_n == 0)
+            return true; // address probe
+        bool isData = _bytes[0] & 0x40;
+        for (uint8_t i = 1; i < _n; i++)
+        {
+            if (isData)
+                data(_bytes[i]);
+            else
+                command(_bytes[i]);
+        }
+        return true;
+    }
+
+    void transmit(uint8_t *_bytes, uint8_t _n) override
+    {
+        memset(_bytes, 0, _n); // status byte
+    }
+};
@@ -0,0 +1,278 @@
+/**
+ * Virtual I2C bus for host tests.
+ * Chip models (see chips.h) attach at their address and see every transaction exactly like the chip would:
+ * the bytes of a write (register pointer first) and the number of bytes of a read.
+ * Transactions take bus time at the current clock (9 bits per byte incl. ACK, plus START/STOP),
+ * so the driver telemetry and timing work as on the device.
+ * Faults are injected per address (NACKs, bus busy, short reads, corrupted bytes, extra latency e.g. from
+ * clock stretching) and the bus can be stuck with SDA held low until SCL is clocked, which is what the bus
+ * recovery in uHardwareI2C.h handles.
+ */
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+
+void hostAdvance_us(uint64_t _us);
+
+// chip model on the virtual bus
+class TvirtualI2Cdevice
+{
+public:
+    virtual ~TvirtualI2Cdevice() {}
+
+    // the master wrote these bytes (up to the STOP or repeated START), false = data not acknowledged
+    virtual bool receive(const uint8_t *_bytes, uint8_t _n) = 0;
+
+    // the master reads _n bytes
+    virtual void transmit(uint8_t *_bytes, uint8_t _n) = 0;
+
+    // transaction counts (addressed and acknowledged)
+    uint32_t writes = 0;
+    uint32_t reads = 0;
+};
+
+class TvirtualI2C
+{
+public:
+    // transaction outcomes (Wire.endTransmission() codes)
+    static constexpr uint8_t busy = 1;
+    static constexpr uint8_t addressNack = 3;
+    static constexpr uint8_t dataNack = 4;
+    static constexpr uint8_t shortRead = 0xff; // read returns fewer bytes
+
+private:
+    static constexpr uint8_t FdevicesSize = 8;
+    struct Tslot
+    {
+        uint8_t address;
+        TvirtualI2Cdevice *device;
+        uint8_t failCode;  // next failures
+        uint8_t failCount;
+        uint8_t corruptMask; // xor of the next written data byte
+        uint32_t latency_us; // added to every transaction
+    };
+    Tslot Fslots[FdevicesSize];
+    uint8_t FslotsN = 0;
+
+    uint32_t Fclock_Hz = 100000;
+
+    // stuck bus: SDA held low until SCL sees this many clock pulses
+    uint8_t FsdaHeld = 0;
+    bool FsclHigh = true;
+    bool FsdaDriven = false;
+    bool FsdaOut = true;
+
+    Tslot *find(uint8_t _address)
+    {
+        for (uint8_t i = 0; i < FslotsN; i++)
+        {
+            if (Fslots[i].address == _address)
+                return &Fslots[i];
+        }
+        return nullptr;
+    }
+
+    // bus time of a transaction
+    void busTime(uint8_t _bytes, const Tslot *_slot = nullptr)
+    {
+        // address byte + data bytes with ACK, START and STOP
+        uint32_t bits = (_bytes + 1) * 9 + 2;
+        uint64_t time_us = (static_cast<uint64_t>(bits) * 1000000 + Fclock_Hz - 1) / Fclock_Hz;
+        if (_slot)
+            time_us += _slot->latency_us;
+        bytes += _bytes + 1;
+        busy_us += time_us;
+        hostAdvance_us(time_us);
+    }
+
+    // consume a pending failure (short reads only affect reads)
+    uint8_t fault(Tslot *_slot, bool _read)
+    {
+        if (_slot == nullptr || _slot->failCount == 0 || (_slot->failCode == shortRead && !_read))
+            return 0;
+        _slot->failCount--;
+        return _slot->failCode;
+    }
+
+public:
+    // counters
+    uint32_t transactions = 0;
+    uint32_t failed = 0;
+    uint32_t sclPulses = 0;
+    uint64_t bytes = 0;   // on the bus (address and data bytes)
+    uint64_t busy_us = 0; // bus time of all transactions
+
+    // attach a chip model
+    void attach(uint8_t _address, TvirtualI2Cdevice &_device)
+    {
+        if (FslotsN < FdevicesSize)
+            Fslots[FslotsN++] = Tslot{_address, &_device, 0, 0, 0, 0};
+    }
+
+    // remove a chip (e.g. unplugged)
+    void detach(uint8_t _address)
+    {
+        for (uint8_t i = 0; i < FslotsN; i++)
+        {
+            if (Fslots[i].address == _address)
+            {
+                Fslots[i] = Fslots[--FslotsN];
+                return;
+            }
+        }
+    }
+
+    // the next _count transactions with the device fail with _code
+    void fail(uint8_t _address, uint8_t _code, uint8_t _count = 1)
+    {
+        Tslot *slot = find(_address);
+        if (slot)
+        {
+            slot->failCode = _code;
+            slot->failCount = _count;
+        }
+    }
+
+    // flip these bits in the next data byte written to the device (after the register pointer)
+    void corrupt(uint8_t _address, uint8_t _mask)
+    {
+        Tslot *slot = find(_address);
+        if (slot)
+            slot->corruptMask = _mask;
+    }
+
+    // every transaction with the device takes this much longer (e.g. clock stretching, a slow or noisy bus)
+    void latency(uint8_t _address, uint32_t _us)
+    {
+        Tslot *slot = find(_address);
+        if (slot)
+            slot->latency_us = _us;
+    }
+
+    // a slave holds SDA low until SCL is clocked _pulses times (more than 9 can't be recovered)
+    void holdSda(uint8_t _pulses)
+    {
+        FsdaHeld = _pulses;
+    }
+
+    bool sdaHeld() const
+    {
+        return FsdaHeld > 0;
+    }
+
+    void setClock(uint32_t _clock_Hz)
+    {
+        Fclock_Hz = _clock_Hz;
+    }
+
+    uint32_t clock() const
+    {
+        return Fclock_Hz;
+    }
+
+    // --- Wire side ---
+
+    uint8_t write(uint8_t _address, const uint8_t *_bytes, uint8_t _n, bool _stop)
+    {
+        transactions++;
+        if (FsdaHeld > 0)
+        {
+            failed++;
+            return busy;
+        }
+        Tslot *slot = find(_address);
+        if (slot == nullptr)
+        {
+            busTime(0);
+            failed++;
+            return addressNack;
+        }
+        uint8_t code = fault(slot, false);
+        if (code != 0)
+        {
+            busTime(0, slot);
+            failed++;
+            return code;
+        }
+        busTime(_n, slot);
+        slot->device->writes++;
+
+        // corrupted data byte
+        uint8_t bytes[32];
+        memcpy(bytes, _bytes, _n);
+        if (slot->corruptMask && _n > 1)
+        {
+            bytes[1] ^= slot->corruptMask;
+            slot->corruptMask = 0;
+        }
+        if (!slot->device->receive(bytes, _n))
+        {
+            failed++;
+            return dataNack;
+        }
+        return 0;
+    }
+
+    uint8_t read(uint8_t _address, uint8_t *_bytes, uint8_t _n)
+    {
+        transactions++;
+        Tslot *slot = find(_address);
+        uint8_t code = (FsdaHeld > 0) ? busy : fault(slot, true);
+        if (slot == nullptr || (code != 0 && code != shortRead))
+        {
+            busTime(0);
+            failed++;
+            return 0;
+        }
+        busTime(_n, slot);
+        slot->device->reads++;
+        slot->device->transmit(_bytes, _n);
+        if (code == shortRead)
+        {
+            failed++;
+            return _n > 0 ? _n - 1 : 0;
+        }
+        return _n;
+    }
+
+    // --- bit-banged pins (bus recovery) ---
+
+    void pinMode(bool _sda, bool _output)
+    {
+        if (_sda)
+            FsdaDriven = _output;
+    }
+
+    void digitalWrite(bool _sda, bool _high)
+    {
+        if (_sda)
+        {
+            FsdaOut = _high;
+            return;
+        }
+        // rising SCL edge clocks the slave that holds SDA
+        if (_high && !FsclHigh)
+        {
+            sclPulses++;
+            if (FsdaHeld > 0 && FsdaHeld <= 9)
+                FsdaHeld--;
+        }
+        FsclHigh = _high;
+    }
+
+    bool digitalRead(bool _sda)
+    {
+        if (!_sda)
+            return FsclHigh;
+        if (FsdaHeld > 0)
+            return false;
+        return FsdaDriven ? FsdaOut : true; // pull-up
+    }
+};
+
+inline TvirtualI2C &virtualI2C()
+{
+    static TvirtualI2C bus;
+    return bus;
+}
@@ -0,0 +1,151 @@
+// host test of the stirrer and its motor driver against a motor model: the PWM steps set the speed (default calibration)
+// and the model raises the decoder edges, so ramps, the speed controller and the decoupling detection run as on the device
+// (decoupling recovery: detection, ramp down to the recovery speed, hold, ramp back up)
+#include "Particle.h"
+#include "hostTest.h"
+#include "uComponentStirrer.h"
+
+using TstirEvent = TcomponentStirrer::Tevent;
+using Tstatus = TcomponentStirrer::Tstatus;
+using Terror = Thardware::TmotorError;
+
+TcomponentStirrer stirrer;
+
+// motor with a stir bar: the default calibration (segmented fit of steps vs. rpm), a decoupled bar takes the load off
+struct TmotorModel
+{
+    bool decoupled = false;
+    dtypes::float32 decoupledGain = 1.3f; // faster for the same steps without the bar
+    dtypes::uint16 recouple_rpm = 300;    // the magnet catches the bar again at or below this speed
+    dtypes::float32 nextEdge_us = -1;     // virtual time of the next decoder edge (-1 = not turning)
+    dtypes::uint16 min_rpm = 0xffff;      // slowest speed while turning (since the last reset)
+
+    dtypes::float32 rpm()
+    {
+        static const dtypes::float32 b[4] = {111.0f, 118.0f, 75.9f, 123.0f};
+        static const dtypes::float32 m[4] = {0.693f, 0.693f, 0.702f, 0.691f};
+        static const dtypes::uint16 stepMax[4] = {1000, 2000, 3000, 4000};
+        dtypes::uint16 steps = hostAnalog()[MICROLOGGER_SPEED_PIN];
+        dtypes::uint8 i = 0;
+        while (i < 3 && steps > stepMax[i])
+            i++;
+        dtypes::float32 rpm = (steps - b[i]) / m[i];
+        if (rpm < 1)
+            return 0;
+        return decoupled ? rpm * decoupledGain : rpm;
+    }
+};
+TmotorModel motor;
+
+// advance virtual time by _ms with decoder edges, software timers and sdds events
+void run(uint32_t _ms)
+{
+    const uint64_t end_us = hostTime_us() + static_cast<uint64_t>(_ms) * 1000;
+    while (hostTime_us() < end_us)
+    {
+        // decoder edges: 100 per revolution (rpm = Hz / 100 * 60)
+        dtypes::float32 rpm = motor.rpm();
+        if (motor.decoupled && rpm > 0 && rpm <= motor.recouple_rpm)
+            motor.decoupled = false;
+        if (rpm > 0 && rpm < motor.min_rpm)
+            motor.min_rpm = static_cast<dtypes::uint16>(rpm);
+        if (rpm <= 0)
+            motor.nextEdge_us = -1;
+        else if (motor.nextEdge_us < 0)
+            motor.nextEdge_us = hostTime_us() + 600000.0f / rpm;
+
+        // next thing that happens: an edge or the next millisecond
+        uint64_t next_us = (hostTime_us() / 1000 + 1) * 1000;
+        bool edge = false;
+        if (motor.nextEdge_us >= 0 && static_cast<uint64_t>(lround(motor.nextEdge_us)) <= next_us)
+        {
+            next_us = static_cast<uint64_t>(lround(motor.nextEdge_us));
+            edge = true;
+        }
+        if (next_us > hostTime_us())
+            hostAdvance_us(next_us - hostTime_us());
+        if (edge)
+        {
+            hostInterrupt(MICROLOGGER_DECODER_PIN);
+            motor.nextEdge_us += 600000.0f / rpm;
+        }
+        hostRunTimers();
+        for (uint8_t i = 0; i < 8; i++)
+            TtaskHandler::handleEvents();
+    }
+}
+
+// run until the condition holds (checked every 10 ms), false if it does not within _max_ms
+template <typename T>
+bool runUntil(T _condition, uint32_t _max_ms)
+{
+    for (uint32_t t = 0; t < _max_ms; t += 10)
+    {
+        if (_condition())
+            return true;
+        run(10);
+    }
+    return _condition();
+}
+
+bool near(dtypes::uint16 _rpm, dtypes::uint16 _target)
+{
+    return abs(static_cast<int>(_rpm) - static_cast<int>(_target)) <= _target / 50;
+}
+
+void testStart()
+{
+    section("start: ramp up to the setpoint and settle");
+    stirrer.setpoint_rpm = 1200;
+    stirrer.action = TcomponentStirrer::Taction::start;
+    check(stirrer.status == Tstatus::accelerating && hardware().motor.ramping == enums::ToffOn::on, "ramps up");
+    check(runUntil([]()
+                   { return stirrer.status == Tstatus::running; },
+                   10000),
+          "running at the setpoint");
+    run(10000);
+    check(near(stirrer.speed_rpm, 1200), "speed %u rpm", (unsigned)stirrer.speed_rpm.value());
+    check(hardware().motor.error == Terror::none && stirrer.event == TstirEvent::none, "no errors or events");
+}
+
+void testRecovery()
+{
+    section("decoupling: detected, ramp down, hold, ramp back up");
+    motor.decoupled = true;
+    check(runUntil([]()
+                   { return stirrer.event == TstirEvent::recovering; },
+                   10000),
+          "decoupling is detected (%u decouplings)", (unsigned)hardware().motor.decouplings.value());
+    check(stirrer.recoveries == 1 && stirrer.error == Terror::decoupled, "recovery starts (%u)", (unsigned)stirrer.recoveries.value());
+    motor.min_rpm = 0xffff;
+    check(runUntil([]()
+                   { return stirrer.event == TstirEvent::none; },
+                   60000),
+          "recovery finishes (event %s, status %s)", stirrer.event.c_str(), stirrer.status.c_str());
+    check(!motor.decoupled && motor.min_rpm <= stirrer.settings.recoverySpeed_rpm + 5, "bar caught at the recovery speed (slowest %u rpm)",
+          (unsigned)motor.min_rpm);
+    check(stirrer.status == Tstatus::running && stirrer.error == Terror::none && hardware().motor.error == Terror::none, "back to running without errors");
+    run(10000);
+    check(near(stirrer.speed_rpm, 1200), "back at the setpoint (%u rpm)", (unsigned)stirrer.speed_rpm.value());
+
+    section("decoupling: stop during the recovery");
+    motor.decoupled = true;
+    check(runUntil([]()
+                   { return stirrer.event == TstirEvent::recovering; },
+                   10000),
+          "second decoupling is detected");
+    stirrer.action = TcomponentStirrer::Taction::stop;
+    check(runUntil([]()
+                   { return stirrer.status == Tstatus::off; },
+                   10000),
+          "stop ramps down to off (status %s)", stirrer.status.c_str());
+    check(stirrer.event == TstirEvent::none && stirrer.error == Terror::none && motor.rpm() == 0, "no recovery left over");
+}
+
+int main()
+{
+    hardware().motor.init(MICROLOGGER_SPEED_PIN, MICROLOGGER_DECODER_PIN);
+    testStart();
+    testRecovery();
+    return report();
+}
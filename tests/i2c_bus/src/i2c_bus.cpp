@@ -0,0 +1,148 @@
+// this program exercises the I2C drivers and the bus recovery paths on a reader board
+// (faults and extra latency are injected in the I2C layer, see ThardwareI2Cbus::TfaultInjection)
+#define I2C_FAULT_INJECTION
+#include "Particle.h"
+#include "uTypedef.h"
+#include "uHardwareIOExpanderTCA9534.h"
+#include "uHardwarePwmPCA9633.h"
+#include "uHardwareRheostatMCP4017.h"
+#include "uHardwareRheostatAD5241.h"
+#include "uHardwareSensorTMP117.h"
+
+// manual mode, no wifi
+SYSTEM_MODE(MANUAL);
+
+// log handler
+SerialLogHandler logHandler(LOG_LEVEL_TRACE);
+
+// self-describing data structure (SDDS) tree
+class TsddsTree : public TmenuHandle
+{
+private:
+    Ttimer FcycleTimer;
+    Ttimer FscenarioTimer;
+
+    // totals at the last cycle
+    dtypes::uint32 Ftransactions = 0;
+    dtypes::uint32 FbusyTime_us = 0;
+    dtypes::uint16 Fcycle = 0;
+
+    // sum over all devices
+    dtypes::uint32 transactions()
+    {
+        return expander.telemetry.transactions + dimmer.telemetry.transactions + dpot1.telemetry.transactions + dpot3.telemetry.transactions + temperature.telemetry.transactions;
+    }
+
+    // configure the fault injection for a scenario
+    void configure()
+    {
+        ThardwareI2Cbus::TfaultInjection &faults = i2cBus().faults;
+        faults.latency_us = (scenario == Tscenario::latency) ? 2000 : 0;
+        faults.nack_permille = (scenario == Tscenario::nack) ? 50 : 0;
+        faults.busy_permille = (scenario == Tscenario::busy) ? 50 : 0;
+        faults.shortRead_permille = (scenario == Tscenario::shortRead) ? 50 : 0;
+        faults.bitFlip_permille = (scenario == Tscenario::bitFlip) ? 50 : 0;
+        // same fault sequence every time
+        randomSeed(seed);
+        Log.info("scenario %s (seed %d)", scenario.to_string().c_str(), seed.Fvalue);
+    }
+
+public:
+    // i2c hardware of the reader board
+    sdds_var(ThardwareIOExpander, expander);
+    sdds_var(ThardwarePwmPCA9633, dimmer);
+    sdds_var(ThardwareRheostatMCP4017, dpot1);
+    sdds_var(ThardwareRheostatAD5241, dpot3);
+    sdds_var(ThardwareSensorTMP117, temperature);
+
+    // testing vars
+    sdds_enum(none, latency, nack, busy, shortRead, bitFlip) Tscenario;
+    sdds_var(Tscenario, scenario);
+    sdds_var(enums::ToffOn, cycleScenarios, sdds::opt::nothing, enums::ToffOn::on);
+    sdds_var(Tuint32, scenarioDuration_ms, sdds::opt::nothing, 30000);
+    sdds_var(Tuint16, cycleInterval_ms, sdds::opt::nothing, 1000);
+    sdds_var(Tuint16, seed, sdds::opt::nothing, 42);
+
+    // constructor
+    TsddsTree()
+    {
+        addDescr(i2cBus());
+
+        on(scenario)
+        {
+            configure();
+        };
+
+        on(FscenarioTimer)
+        {
+            if (cycleScenarios == enums::ToffOn::on)
+            {
+                scenario = (scenario == Tscenario::bitFlip) ? Tscenario::none : static_cast<Tscenario::e>(scenario + 1);
+                FscenarioTimer.start(scenarioDuration_ms);
+            }
+        };
+
+        // one read cycle: what a reading does on the bus (beam on, gain, light, temperature, beam off)
+        on(FcycleTimer)
+        {
+            Fcycle++;
+            dpot1.steps = (Fcycle * 7) % dpot1.maxSteps;
+            dpot3.steps = (Fcycle * 13) % dpot3.maxSteps;
+            expander.pin1 = (Fcycle % 2) ? ThardwareIOExpander::Tmode::OUTPUT_ON : ThardwareIOExpander::Tmode::OUTPUT_OFF;
+            dimmer.setpoint1 = (Fcycle * 17) % 256;
+            temperature.action = ThardwareI2C::Taction::read;
+
+            // bus traffic per cycle
+            dtypes::uint32 n = transactions();
+            Log.trace("cycle %d [%s]: %lu transactions, bus %d permille, retries %lu, recoveries %lu, disconnects %lu, injected %lu",
+                      Fcycle, scenario.to_string().c_str(), n - Ftransactions, i2cBus().busy_permille.Fvalue,
+                      expander.retries + dimmer.retries + dpot1.retries + dpot3.retries + temperature.retries,
+                      i2cBus().busRecoveries.Fvalue,
+                      expander.disconnects + dimmer.disconnects + dpot1.disconnects + dpot3.disconnects + temperature.disconnects,
+                      i2cBus().faults.injected.Fvalue);
+            Ftransactions = n;
+            FcycleTimer.start(cycleInterval_ms);
+        };
+    };
+
+    // start the tests
+    void start()
+    {
+        FcycleTimer.start(cycleInterval_ms);
+        FscenarioTimer.start(scenarioDuration_ms);
+        configure();
+    }
+
+} sddsTree;
+
+// serial spike for communication via serial (with baud rate)
+#include "uSerialSpike.h"
+TserialSpike serialSpike(sddsTree, 115200);
+
+// setup
+void setup()
+{
+    // same setup as the reader board
+    sddsTree.expander.init();
+    sddsTree.dimmer.init(ThardwarePwmPCA9633::Driver::EXTN);
+    sddsTree.dpot1.init(ThardwareRheostatMCP4017::Resistance::R100k);
+    sddsTree.dpot3.init(ThardwareRheostatAD5241::Resistance::R1M);
+    sddsTree.temperature.init();
+
+    // keep everything connected
+    sddsTree.expander.autoConnect = enums::ToffOn::on;
+    sddsTree.dimmer.autoConnect = enums::ToffOn::on;
+    sddsTree.dpot1.autoConnect = enums::ToffOn::on;
+    sddsTree.dpot3.autoConnect = enums::ToffOn::on;
+    sddsTree.temperature.autoConnect = enums::ToffOn::on;
+
+    // start testing
+    sddsTree.start();
+}
+
+// loop
+void loop()
+{
+    // handle all events
+    TtaskHandler::handleEvents();
+}